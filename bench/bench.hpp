@@ -0,0 +1,76 @@
+#pragma once
+
+#include "pch.hpp"
+
+// a minimal benchmark runner: every BENCHMARK registers itself before main runs and prints its own results,
+// numbers are only comparable between runs on the same machine
+
+using Benchmark_Function = void (*)();
+
+struct Benchmark {
+    std::string_view   name;
+    Benchmark_Function function;
+};
+
+[[nodiscard]]
+std::vector<Benchmark>& GetBenchmarks();
+
+struct Benchmark_Registration {
+    Benchmark_Registration(std::string_view name, Benchmark_Function function) {
+        GetBenchmarks().push_back(Benchmark{name, function});
+    }
+};
+
+#define BENCHMARK(name)                                                         \
+    static void                   name();                                       \
+    static Benchmark_Registration name##_registration(#name, name);             \
+    static void                   name()
+
+// keeps the compiler from optimizing away a result that is otherwise unused
+template <typename T>
+void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+    // read back, so the store is not dead either
+    const volatile void* const read = sink;
+    (void)read;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// calls function repeatedly for about duration, returns the calls per second
+template <typename Function>
+[[nodiscard]]
+double MeasureRate(Function&& function, std::chrono::milliseconds duration = std::chrono::milliseconds(500)) {
+    uint64_t   calls = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto       now   = start;
+
+    // the clock is only read every 64 calls, so it does not dominate short functions
+    while (now - start < duration) {
+        for (int i = 0; i < 64; i++) {
+            function();
+        }
+        calls += 64;
+        now    = std::chrono::steady_clock::now();
+    }
+
+    return calls / std::chrono::duration<double>(now - start).count();
+}
+
+// user plus system CPU time of the whole process so far
+[[nodiscard]]
+std::chrono::microseconds ProcessCPUTime();
+
+// latency percentiles of a set of samples, sorts them
+struct Latency_Summary {
+    std::chrono::microseconds p50{0};
+    std::chrono::microseconds p99{0};
+    std::chrono::microseconds max{0};
+};
+
+[[nodiscard]]
+Latency_Summary SummarizeLatencies(std::vector<std::chrono::microseconds>& samples);
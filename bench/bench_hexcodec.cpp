@@ -0,0 +1,134 @@
+#include "bench.hpp"
+#include "hexcodec.hpp"
+#include "ndimidi.hpp"
+
+// channel messages, a typical batched frame, and sysex dumps up to a 64 KB sample dump
+constexpr size_t HEX_BENCH_SIZES[] = {3, 16, 64, 256, 4096, 65536};
+
+[[nodiscard]]
+static std::vector<uint8_t> PatternBytes(size_t count) {
+    std::vector<uint8_t> bytes(count);
+    for (size_t i = 0; i < count; i++) {
+        bytes[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    return bytes;
+}
+
+[[nodiscard]]
+static double MegabytesPerSecond(double calls_per_second, size_t bytes) {
+    return calls_per_second * bytes / 1e6;
+}
+
+// what SendMIDI did before EncodeHex: every byte formatted on its own and appended to a fresh string
+[[nodiscard]]
+static std::string FormatHex(std::span<const uint8_t> bytes) {
+    std::string hex;
+    hex.reserve(bytes.size() + 7);
+
+    for (const auto& byte : bytes) {
+        hex += std::format("{:02X}", byte);
+    }
+    return hex;
+}
+
+// EncodeHex against a plain table loop and the per-byte std::format it replaces, in input bytes per second
+BENCHMARK(hex_encode) {
+    for (const size_t size : HEX_BENCH_SIZES) {
+        const auto  bytes = PatternBytes(size);
+        std::string out(EncodedHexSize(size), '\0');
+
+        const double vector_rate = MeasureRate([&] {
+            DoNotOptimize(EncodeHex(bytes, out.data()));
+            DoNotOptimize(out);
+        });
+
+        const double table_rate = MeasureRate([&] {
+            char* dst = out.data();
+            for (const uint8_t byte : bytes) {
+                *dst++ = HEX_ENCODE_TABLE[byte][0];
+                *dst++ = HEX_ENCODE_TABLE[byte][1];
+            }
+            DoNotOptimize(out);
+        });
+
+        const double format_rate = MeasureRate([&] { DoNotOptimize(FormatHex(bytes)); });
+
+#ifdef HEXCODEC_SSE2
+        const char* variant = "SSE2";
+#else
+        const char* variant = "scalar";
+#endif
+        std::println("\t{:5} bytes: EncodeHex ({}) {:8.1f} MB/s, table loop {:8.1f} MB/s, std::format per byte {:6.1f} MB/s", size, variant,
+                     MegabytesPerSecond(vector_rate, size), MegabytesPerSecond(table_rate, size), MegabytesPerSecond(format_rate, size));
+    }
+}
+
+// DecodeHex against the plain table loop, in output bytes per second
+BENCHMARK(hex_decode) {
+    for (const size_t size : HEX_BENCH_SIZES) {
+        const auto  bytes = PatternBytes(size);
+        std::string hex(EncodedHexSize(size), '\0');
+        EncodeHex(bytes, hex.data());
+
+        std::vector<uint8_t> out(size);
+
+        const double vector_rate = MeasureRate([&] {
+            DoNotOptimize(DecodeHex(hex, out.data()));
+            DoNotOptimize(out);
+        });
+
+        const double table_rate = MeasureRate([&] {
+            bool valid = true;
+            for (size_t i = 0; i < size; i++) {
+                const uint8_t hi = HEX_DECODE_TABLE[static_cast<uint8_t>(hex[2 * i])];
+                const uint8_t lo = HEX_DECODE_TABLE[static_cast<uint8_t>(hex[2 * i + 1])];
+                valid &= ((hi | lo) & 0xF0) == 0;
+                out[i] = static_cast<uint8_t>((hi << 4) | lo);
+            }
+            DoNotOptimize(valid);
+            DoNotOptimize(out);
+        });
+
+#ifdef HEXCODEC_SSE2
+        const char* variant = "SSE2";
+#else
+        const char* variant = "scalar";
+#endif
+        std::println("\t{:5} bytes: DecodeHex ({}) {:8.1f} MB/s, table loop {:8.1f} MB/s", size, variant,
+                     MegabytesPerSecond(vector_rate, size), MegabytesPerSecond(table_rate, size));
+    }
+}
+
+// whole metadata frames as the receive path sees them: one note, a batch of 32 controllers, a 4 KB sysex dump
+BENCHMARK(parse_midi_message) {
+    const auto element = [](std::span<const uint8_t> data) {
+        std::string hex(EncodedHexSize(data.size()), '\0');
+        EncodeHex(data, hex.data());
+        return std::string(MIDI_OPEN_TAG) + hex + std::string(MIDI_CLOSE_TAG);
+    };
+
+    const uint8_t note[3] = {0x90, 0x3C, 0x64};
+
+    std::string batch;
+    for (uint8_t controller = 0; controller < 32; controller++) {
+        const uint8_t message[3] = {0xB0, controller, 0x40};
+        batch += element(message);
+    }
+
+    auto sysex    = PatternBytes(4096);
+    sysex.front() = 0xF0;
+    sysex.back()  = 0xF7;
+
+    const std::pair<const char*, std::string> frames[] = {
+        {"note",           element(note) },
+        {"32 controllers", batch         },
+        {"4 KB sysex",     element(sysex)},
+    };
+
+    MIDI_Frame frame;
+
+    for (const auto& [name, payload] : frames) {
+        const double rate = MeasureRate([&] { DoNotOptimize(NDI_MIDI_Manager::ParseMIDIMessage(payload, frame)); });
+        std::println("\t{:14}: {:10.0f} frames/s, {:8.1f} MB/s of payload", name, rate, MegabytesPerSecond(rate, payload.size()));
+    }
+}
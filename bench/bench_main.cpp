@@ -0,0 +1,62 @@
+#include "bench.hpp"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+std::vector<Benchmark>& GetBenchmarks() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+std::chrono::microseconds ProcessCPUTime() {
+#ifdef __linux__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    const auto to_us = [](const timeval& time) {
+        return std::chrono::seconds(time.tv_sec) + std::chrono::microseconds(time.tv_usec);
+    };
+    return to_us(usage.ru_utime) + to_us(usage.ru_stime);
+#elif defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+
+    const auto to_us = [](const FILETIME& time) {
+        return std::chrono::microseconds(((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10);
+    };
+    return to_us(kernel) + to_us(user);
+#else
+    return std::chrono::microseconds(0);
+#endif
+}
+
+Latency_Summary SummarizeLatencies(std::vector<std::chrono::microseconds>& samples) {
+    if (samples.empty()) {
+        return Latency_Summary();
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Latency_Summary summary;
+    summary.p50 = samples[samples.size() / 2];
+    summary.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    summary.max = samples.back();
+    return summary;
+}
+
+// runs every benchmark, or only those whose name contains the first argument
+int main(int argc, char** argv) {
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+
+    for (const auto& benchmark : GetBenchmarks()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string_view::npos) {
+            continue;
+        }
+
+        std::println("{}", benchmark.name);
+        benchmark.function();
+    }
+
+    return 0;
+}
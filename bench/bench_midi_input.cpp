@@ -0,0 +1,126 @@
+#include "bench.hpp"
+#include "send_stage.hpp"
+
+// an input backend without a device: Inject queues a message the way the ALSA and JACK input threads do, the
+// transmit loop takes it back out through the waitForMessage and getMessages that RtMidiIn forwards to, so this
+// works with the dummy API too and covers everything after the driver handed the message over
+class Injected_Input_Api : public MidiInApi {
+public:
+    // the queue size MIDI_IO_MANAGER asks RtMidiIn for
+    Injected_Input_Api() : MidiInApi(1000) {}
+
+    RtMidi::Api getCurrentApi() override {
+        return RtMidi::RTMIDI_DUMMY;
+    }
+    void openPort(unsigned int, const std::string&) override {}
+    void openVirtualPort(const std::string&) override {}
+    void closePort() override {}
+    void setClientName(const std::string&) override {}
+    void setPortName(const std::string&) override {}
+    unsigned int getPortCount() override {
+        return 0;
+    }
+    std::string getPortName(unsigned int) override {
+        return "";
+    }
+
+    // from one thread only, like the input thread of a backend
+    void Inject(std::span<const unsigned char> message) {
+        inputData_.message.bytes.assign(message.data(), message.data() + message.size());
+        if (!inputData_.queue.push(inputData_.message)) {
+            inputData_.queueOverflow("Injected_Input_Api");
+        }
+    }
+
+protected:
+    void initialize(const std::string&) override {}
+};
+
+// the transmit() input loop: wait for the input queue, drain it, push into the send stage, with the calls
+// MIDI_IO_MANAGER::WaitForMIDI and ReceiveMIDI make on an open port
+// returns the number of messages forwarded, on_forwarded sees every one right after the send stage took it
+template <typename On_Forwarded>
+static uint64_t ForwardFor(Injected_Input_Api& input, MIDI_Send_Stage& send_stage, std::chrono::milliseconds duration,
+                           On_Forwarded&& on_forwarded) {
+    MIDI_Batch batch;
+    uint64_t   forwarded = 0;
+
+    const auto end = std::chrono::steady_clock::now() + duration;
+
+    while (std::chrono::steady_clock::now() < end) {
+        if (!input.waitForMessage(50)) {
+            continue;
+        }
+
+        input.getMessages(&batch.bytes, &batch.infos, 0);
+
+        for (size_t i = 0; i < batch.Count(); i++) {
+            send_stage.Push(batch.Message(i), batch.Timecode(i));
+            on_forwarded(batch, i);
+        }
+        forwarded += batch.Count();
+    }
+    return forwarded;
+}
+
+// CPU the transmit input loop, the send stage and the NDI sender use per second while no MIDI arrives, the loop
+// blocked in the queue wait
+BENCHMARK(midi_input_idle_cpu) {
+    constexpr auto DURATION = std::chrono::milliseconds(2000);
+
+    auto             transport = CreateTransport("loopback");
+    NDI_MIDI_Manager ndi_midi_manager(transport, "Stage");
+    MIDI_Send_Stage  send_stage(ndi_midi_manager, DEFAULT_SEND_QUEUE_SIZE, Overflow_Policy::Block);
+
+    Injected_Input_Api input;
+
+    const auto cpu_before = ProcessCPUTime();
+    const auto start      = std::chrono::steady_clock::now();
+
+    DoNotOptimize(ForwardFor(input, send_stage, DURATION, [](MIDI_Batch&, size_t) {}));
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto   cpu     = ProcessCPUTime() - cpu_before;
+
+    std::println("\t{:.2f} ms CPU per idle second", cpu.count() / 1000.0 / seconds);
+}
+
+// from the input thread queuing a message until the send stage took it from the transmit loop, one message every
+// ms and bursts of 32 every ms
+BENCHMARK(midi_input_latency) {
+    constexpr size_t MESSAGES = 2048;
+
+    for (const size_t burst : {1, 32}) {
+        auto             transport = CreateTransport("loopback");
+        NDI_MIDI_Manager ndi_midi_manager(transport, "Stage");
+        MIDI_Send_Stage  send_stage(ndi_midi_manager, DEFAULT_SEND_QUEUE_SIZE, Overflow_Policy::Block);
+
+        Injected_Input_Api input;
+
+        std::jthread input_thread([&] {
+            for (size_t i = 0; i < MESSAGES; i += burst) {
+                for (size_t j = i; j < i + burst; j++) {
+                    const unsigned char note_on[3] = {0x90, static_cast<unsigned char>(j & 0x7F), 100};
+                    input.Inject(note_on);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        std::vector<std::chrono::microseconds> samples;
+        samples.reserve(MESSAGES);
+
+        const auto duration = std::chrono::milliseconds(MESSAGES / burst * 2 + 500);
+
+        ForwardFor(input, send_stage, duration, [&](MIDI_Batch& batch, size_t index) {
+            const std::chrono::steady_clock::time_point captured(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(batch.infos[index].captureTime)));
+            samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - captured));
+        });
+
+        const auto summary = SummarizeLatencies(samples);
+
+        std::println("\tbursts of {:2}: {} of {} messages, latency p50 {} us, p99 {} us, max {} us", burst, samples.size(), MESSAGES,
+                     summary.p50.count(), summary.p99.count(), summary.max.count());
+    }
+}
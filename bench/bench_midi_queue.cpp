@@ -0,0 +1,205 @@
+#include "bench.hpp"
+
+// how RtMidi queued input before MidiQueue became a lock-free ring: every slot owns a std::vector that push
+// copy-assigns and pop assigns from, the indexes are plain integers without any synchronization
+class Vector_Queue {
+public:
+    explicit Vector_Queue(size_t size) : m_ring(size) {}
+
+    bool Push(const std::vector<unsigned char>& message, double time_stamp) {
+        const size_t next = (m_back + 1) % m_ring.size();
+        if (next == m_front) {
+            return false;
+        }
+        m_ring[m_back].bytes     = message;
+        m_ring[m_back].timeStamp = time_stamp;
+        m_back                   = next;
+        return true;
+    }
+
+    bool Pop(std::vector<unsigned char>& message, double& time_stamp) {
+        if (m_front == m_back) {
+            return false;
+        }
+        message.assign(m_ring[m_front].bytes.begin(), m_ring[m_front].bytes.end());
+        time_stamp = m_ring[m_front].timeStamp;
+        m_front    = (m_front + 1) % m_ring.size();
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::vector<unsigned char> bytes;
+        double                     timeStamp = 0.0;
+    };
+
+    std::vector<Slot> m_ring;
+    size_t            m_front = 0;
+    size_t            m_back  = 0;
+};
+
+// the original queue behind a mutex, the least it takes to share it between an input thread and a reader
+class Locked_Vector_Queue {
+public:
+    explicit Locked_Vector_Queue(size_t size) : m_queue(size) {}
+
+    bool Push(const std::vector<unsigned char>& message, double time_stamp) {
+        std::lock_guard lock(m_mutex);
+        return m_queue.Push(message, time_stamp);
+    }
+
+    bool Pop(std::vector<unsigned char>& message, double& time_stamp) {
+        std::lock_guard lock(m_mutex);
+        return m_queue.Pop(message, time_stamp);
+    }
+
+private:
+    std::mutex   m_mutex;
+    Vector_Queue m_queue;
+};
+
+constexpr uint32_t QUEUE_MESSAGES = 2000000;
+constexpr size_t   QUEUE_SIZE     = 100;
+
+static void PrintRate(std::string_view name, std::chrono::steady_clock::time_point start, std::chrono::microseconds cpu_before) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto   cpu     = ProcessCPUTime() - cpu_before;
+
+    std::println("\t{:24} {:10.0f} msgs/s, {:.3f} us CPU per message", name, QUEUE_MESSAGES / seconds,
+                 cpu.count() / static_cast<double>(QUEUE_MESSAGES));
+}
+
+// note ons from an input thread to a reader through a queue of RtMidi's default size, both sides spin when they
+// have to wait so the numbers show the cost of the queue itself; the original vector queue would race on its
+// indexes here, midi_queue_burst compares against it on one thread
+BENCHMARK(midi_queue_throughput) {
+    {
+        Locked_Vector_Queue queue(QUEUE_SIZE);
+
+        const auto cpu_before = ProcessCPUTime();
+        const auto start      = std::chrono::steady_clock::now();
+
+        std::jthread producer([&] {
+            std::vector<unsigned char> message = {0x90, 60, 100};
+            for (uint32_t i = 0; i < QUEUE_MESSAGES; i++) {
+                while (!queue.Push(message, i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<unsigned char> message;
+        double                     time_stamp = 0.0;
+        for (uint32_t received = 0; received < QUEUE_MESSAGES;) {
+            if (queue.Pop(message, time_stamp)) {
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        PrintRate("locked vector queue", start, cpu_before);
+    }
+
+    for (const bool drain : {false, true}) {
+        MidiInApi::MidiQueue queue;
+        queue.allocate(QUEUE_SIZE, 4, 1024);
+
+        const auto cpu_before = ProcessCPUTime();
+        const auto start      = std::chrono::steady_clock::now();
+
+        std::jthread producer([&] {
+            const unsigned char    note_on[3] = {0x90, 60, 100};
+            MidiInApi::MidiMessage message;
+            message.bytes.assign(std::begin(note_on), std::end(note_on));
+            for (uint32_t i = 0; i < QUEUE_MESSAGES; i++) {
+                message.timeStamp = i;
+                while (!queue.push(message)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<unsigned char>         bytes;
+        std::vector<RtMidiIn::MessageInfo> info;
+        double                             time_stamp = 0.0;
+        for (uint32_t received = 0; received < QUEUE_MESSAGES;) {
+            if (drain) {
+                bytes.clear();
+                info.clear();
+                received += queue.drain(&bytes, &info, 0);
+            } else if (queue.pop(&bytes, &time_stamp)) {
+                received++;
+            }
+            if (received < QUEUE_MESSAGES && queue.size() == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        queue.release();
+
+        PrintRate(drain ? "MidiQueue, drain" : "MidiQueue, pop", start, cpu_before);
+    }
+}
+
+// a burst of note ons pushed into a vector queue and popped again on one thread
+template <typename Queue>
+[[nodiscard]]
+static double MeasureVectorQueueBurst(uint32_t burst) {
+    Queue queue(QUEUE_SIZE);
+
+    std::vector<unsigned char> note_on = {0x90, 60, 100};
+    std::vector<unsigned char> message;
+    double                     time_stamp = 0.0;
+
+    return MeasureRate([&] {
+        for (uint32_t i = 0; i < burst; i++) {
+            queue.Push(note_on, i);
+        }
+        while (queue.Pop(message, time_stamp)) {
+        }
+        DoNotOptimize(message);
+    });
+}
+
+// the same queues filled with a burst of note ons and emptied again on one thread, the cost per message without
+// any scheduling in between; MidiQueue::push also reads the steady clock for the capture time, the vector queues
+// do not
+BENCHMARK(midi_queue_burst) {
+    constexpr uint32_t BURST = 64;
+
+    std::println("\t{:24} {:10.0f} msgs/s", "original vector queue", MeasureVectorQueueBurst<Vector_Queue>(BURST) * BURST);
+    std::println("\t{:24} {:10.0f} msgs/s", "locked vector queue", MeasureVectorQueueBurst<Locked_Vector_Queue>(BURST) * BURST);
+
+    for (const bool drain : {false, true}) {
+        MidiInApi::MidiQueue queue;
+        queue.allocate(QUEUE_SIZE, 4, 1024);
+
+        const unsigned char    note_on[3] = {0x90, 60, 100};
+        MidiInApi::MidiMessage message;
+        message.bytes.assign(std::begin(note_on), std::end(note_on));
+
+        std::vector<unsigned char>         bytes;
+        std::vector<RtMidiIn::MessageInfo> info;
+        double                             time_stamp = 0.0;
+
+        const double rate = MeasureRate([&] {
+            for (uint32_t i = 0; i < BURST; i++) {
+                queue.push(message);
+            }
+            bytes.clear();
+            info.clear();
+            if (drain) {
+                queue.drain(&bytes, &info, 0);
+            } else {
+                while (queue.pop(&bytes, &time_stamp)) {
+                }
+            }
+            DoNotOptimize(bytes);
+        });
+        queue.release();
+
+        std::println("\t{:24} {:10.0f} msgs/s", drain ? "MidiQueue, drain" : "MidiQueue, pop", rate * BURST);
+    }
+}
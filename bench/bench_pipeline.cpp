@@ -0,0 +1,110 @@
+#include "bench.hpp"
+#include "receive_pipeline.hpp"
+#include "send_stage.hpp"
+
+// the transmit() and receive() pipelines back to back over the loopback transport: the send stage and NDI sender
+// of one bridge, the capture and output threads of the other
+struct Loopback_Bridge {
+    std::shared_ptr<MIDI_Transport> transport = CreateTransport("loopback");
+    MIDI_Receiver                   receiver{transport->CreateReceiver("Monitor")};
+    NDI_MIDI_Manager                ndi_midi_manager{transport, "Stage"};
+
+    Loopback_Bridge(std::chrono::microseconds batch_window) {
+        const MIDI_Source source{"Stage", ""};
+        receiver.Connect(&source);
+
+        // creates the sender, after the receiver so it starts out connected
+        ndi_midi_manager.SetBatching(batch_window, 1024);
+    }
+};
+
+static void RunThroughput(std::chrono::microseconds batch_window) {
+    constexpr uint64_t MESSAGES = 200'000;
+
+    Loopback_Bridge bridge(batch_window);
+
+    std::atomic<uint64_t> received = 0;
+
+    MIDI_Receive_Pipeline pipeline({&bridge.receiver}, [&received](size_t, MIDI_Frame& frame, std::chrono::steady_clock::time_point) {
+        received.fetch_add(frame.Count(), std::memory_order_relaxed);
+    });
+
+    const auto cpu_before = ProcessCPUTime();
+    const auto start      = std::chrono::steady_clock::now();
+
+    {
+        MIDI_Send_Stage send_stage(bridge.ndi_midi_manager, DEFAULT_SEND_QUEUE_SIZE, Overflow_Policy::Block);
+
+        uint8_t message[3] = {0xB0, 7, 0};
+        for (uint64_t i = 0; i < MESSAGES; i++) {
+            message[2] = static_cast<uint8_t>(i & 0x7F);
+            send_stage.Push(message, TIMECODE_SYNTHESIZE);
+        }
+    }
+    bridge.ndi_midi_manager.FlushMIDI();
+
+    // whatever the loopback queue dropped never arrives
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    uint64_t   last     = UINT64_MAX;
+    while (received.load() != last && std::chrono::steady_clock::now() < deadline) {
+        last = received.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto   cpu     = ProcessCPUTime() - cpu_before;
+    const auto   stats   = pipeline.GetStats().front();
+
+    std::println("\tbatch window {:5} us: {:9.0f} msgs/s, {:8.0f} frames/s, {} of {} received, {} frames dropped, {:.1f} us CPU per message",
+                 batch_window.count(), received.load() / seconds, stats.frames / seconds, received.load(), MESSAGES,
+                 stats.dropped_frames, static_cast<double>(cpu.count()) / MESSAGES);
+}
+
+static void RunLatency(std::chrono::microseconds batch_window) {
+    constexpr size_t MESSAGES = 2000;
+
+    Loopback_Bridge bridge(batch_window);
+
+    std::mutex                             samples_mutex;
+    std::vector<std::chrono::microseconds> samples;
+    samples.reserve(MESSAGES);
+
+    MIDI_Receive_Pipeline pipeline({&bridge.receiver}, [&](size_t, MIDI_Frame& frame, std::chrono::steady_clock::time_point) {
+        // the frame timecode is the capture time of its first message
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - TimecodeToSteady(frame.timecode));
+
+        std::lock_guard lock(samples_mutex);
+        samples.push_back(latency);
+    });
+
+    {
+        MIDI_Send_Stage send_stage(bridge.ndi_midi_manager, DEFAULT_SEND_QUEUE_SIZE, Overflow_Policy::Block);
+
+        uint8_t message[3] = {0x90, 60, 100};
+        for (size_t i = 0; i < MESSAGES; i++) {
+            send_stage.Push(message, CurrentTimecode());
+            std::this_thread::sleep_for(std::chrono::microseconds(250));
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::lock_guard lock(samples_mutex);
+    const auto      summary = SummarizeLatencies(samples);
+
+    std::println("\tbatch window {:5} us: {} frames, latency p50 {} us, p99 {} us, max {} us", batch_window.count(),
+                 samples.size(), summary.p50.count(), summary.p99.count(), summary.max.count());
+}
+
+// as fast as the send stage takes messages, a frame per message and batched into 1 ms frames
+BENCHMARK(loopback_pipeline_throughput) {
+    RunThroughput(std::chrono::microseconds(0));
+    RunThroughput(std::chrono::microseconds(1000));
+}
+
+// one message every 250 us, from the send stage push to the receive output, batching trades latency for frames
+BENCHMARK(loopback_pipeline_latency) {
+    RunLatency(std::chrono::microseconds(0));
+    RunLatency(std::chrono::microseconds(1000));
+}
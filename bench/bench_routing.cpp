@@ -0,0 +1,203 @@
+#include "bench.hpp"
+#include "routing.hpp"
+
+#include <random>
+
+// one input routed to route_count outputs, each route with its own channel range and set of types
+[[nodiscard]]
+static Routing_Config MakeRoutingConfig(size_t route_count) {
+    std::string text = "input in = midi:In\n";
+
+    for (size_t route = 0; route < route_count; route++) {
+        const size_t first = route % 16 + 1;
+        const size_t last  = std::min<size_t>(first + 3, 16);
+
+        text += std::format("output o{} = ndi:Out {}\n", route, route);
+        text += std::format("route in -> o{} channels={}-{} types={}\n", route, first, last, route % 2 ? "note,cc" : "pitchbend,realtime");
+    }
+
+    std::istringstream input(text);
+    std::string        error;
+    return *ParseRoutingConfig(input, error);
+}
+
+// what the table replaces: every route checked for every message
+[[nodiscard]]
+static uint64_t ScanRoutes(const Routing_Config& config, size_t input, uint8_t status) {
+    uint64_t outputs = 0;
+    for (const auto& route : config.routes) {
+        if (route.input != input || !(route.types & MIDIMessageType(status))) {
+            continue;
+        }
+        if (status < 0xF0 && !(route.channels & (1 << (status & 0x0F)))) {
+            continue;
+        }
+        outputs |= uint64_t(1) << route.output;
+    }
+    return outputs;
+}
+
+// the status bytes of a mixed stream, notes, controllers and pitch bend on all channels plus clock
+[[nodiscard]]
+static std::vector<uint8_t> MakeStatusBytes() {
+    std::mt19937                            random(7);
+    std::uniform_int_distribution<uint32_t> channel(0, 15);
+
+    constexpr uint8_t TYPES[] = {0x90, 0x80, 0xB0, 0xB0, 0xE0, 0xF8};
+
+    std::vector<uint8_t> statuses(4096);
+    for (auto& status : statuses) {
+        const uint8_t type = TYPES[random() % std::size(TYPES)];
+        status             = type == 0xF8 ? type : static_cast<uint8_t>(type | channel(random));
+    }
+    return statuses;
+}
+
+// route lookups per second for 4 to 64 routes out of one input
+BENCHMARK(route_lookup) {
+    const auto statuses = MakeStatusBytes();
+
+    for (const size_t route_count : {4, 16, 64}) {
+        const auto             config = MakeRoutingConfig(route_count);
+        const MIDI_Route_Table table(config);
+
+        size_t   next    = 0;
+        uint64_t outputs = 0;
+
+        const double table_rate = MeasureRate([&] {
+            outputs ^= table.Outputs(0, statuses[next++ & 4095]);
+            DoNotOptimize(outputs);
+        });
+
+        const double scan_rate = MeasureRate([&] {
+            outputs ^= ScanRoutes(config, 0, statuses[next++ & 4095]);
+            DoNotOptimize(outputs);
+        });
+
+        std::println("\t{:2} routes: table {:12.0f} msgs/s, scanning the routes {:12.0f} msgs/s", route_count, table_rate, scan_rate);
+    }
+}
+
+// two batched NDI sources through a router with four filtered routes into two batched NDI outputs, everything
+// over the loopback transport; the routes do not overlap, so every input message is counted once
+BENCHMARK(router_throughput) {
+    constexpr uint64_t MESSAGES = 1'000'000; // per source
+
+    // messages the sources may be ahead of the router, far fewer frames than a loopback receiver holds before it
+    // drops the oldest, so the run is lossless and measures the router rather than the sources
+    constexpr uint64_t IN_FLIGHT = 32'768;
+
+    const auto transport = CreateTransport("loopback");
+
+    // the sources exist before the router looks for them
+    MIDI_Sender source_a(transport->CreateSender("Bench A"));
+    MIDI_Sender source_b(transport->CreateSender("Bench B"));
+    source_a.SetBatching(std::chrono::microseconds(1000), 1024);
+    source_b.SetBatching(std::chrono::microseconds(1000), 1024);
+
+    // the outputs start out connected, otherwise they would skip every frame
+    MIDI_Receiver monitor_x(transport->CreateReceiver("Monitor"));
+    MIDI_Receiver monitor_y(transport->CreateReceiver("Monitor"));
+    const MIDI_Source routed_x{"Routed X", ""};
+    const MIDI_Source routed_y{"Routed Y", ""};
+    monitor_x.Connect(&routed_x);
+    monitor_y.Connect(&routed_y);
+
+    MIDI_Receive_Pipeline monitors({&monitor_x, &monitor_y}, [](size_t, MIDI_Frame&, std::chrono::steady_clock::time_point) {});
+
+    std::istringstream input(R"(
+input  a = ndi:Bench A
+input  b = ndi:Bench B
+output x = ndi:Routed X
+output y = ndi:Routed Y
+route a -> x channels=1-8 types=note,cc
+route a -> y channels=9-16 types=note,cc
+route b -> x types=pitchbend
+route b -> y types=cc,realtime
+)");
+    std::string error;
+    auto        config = ParseRoutingConfig(input, error);
+
+    MIDI_Router router(transport, std::move(*config), 1, std::chrono::microseconds(1000), 1024);
+    if (!router.Start()) {
+        std::println("\tthe router did not start, skipped");
+        return;
+    }
+
+    const auto routed = [&router] {
+        uint64_t messages = 0;
+        for (const auto& stats : router.GetStats()) {
+            messages += stats.messages;
+        }
+        for (const auto unrouted : router.GetUnrouted()) {
+            messages += unrouted;
+        }
+        return messages;
+    };
+
+    std::atomic<uint64_t> sent = 0;
+
+    // every 256 messages a source waits until the router is no more than IN_FLIGHT behind both sources together
+    const auto pace = [&](uint64_t i, MIDI_Sender& source) {
+        if (i % 256 != 0) {
+            return;
+        }
+        sent.fetch_add(256);
+        while (sent.load() > routed() + IN_FLIGHT) {
+            // the batch of the source may be what the router waits for
+            source.FlushMIDI();
+            std::this_thread::yield();
+        }
+    };
+
+    const auto cpu_before = ProcessCPUTime();
+    const auto start      = std::chrono::steady_clock::now();
+
+    {
+        // notes and controllers on every channel from a, controllers, pitch bend and notes from b, the notes of b
+        // are not routed
+        std::jthread sender_a([&] {
+            uint8_t message[3] = {0x90, 60, 0};
+            for (uint64_t i = 0; i < MESSAGES; i++) {
+                pace(i, source_a);
+                message[0] = static_cast<uint8_t>((i % 2 ? 0xB0 : 0x90) | (i % 16));
+                message[2] = static_cast<uint8_t>(i & 0x7F);
+                source_a.SendMIDI(message);
+            }
+            source_a.FlushMIDI();
+        });
+        std::jthread sender_b([&] {
+            constexpr uint8_t TYPES[] = {0xB0, 0xE0, 0x90};
+
+            uint8_t message[3] = {0xB0, 7, 0};
+            for (uint64_t i = 0; i < MESSAGES; i++) {
+                pace(i, source_b);
+                message[0] = static_cast<uint8_t>(TYPES[i % 3] | (i % 16));
+                message[2] = static_cast<uint8_t>(i & 0x7F);
+                source_b.SendMIDI(message);
+            }
+            source_b.FlushMIDI();
+        });
+    }
+
+    // the run ends with the last message the router took
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (routed() < 2 * MESSAGES && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    const auto     end      = std::chrono::steady_clock::now();
+    const uint64_t received = routed();
+
+    // a lost frame would make the rate that of whatever got through
+    if (received != 2 * MESSAGES) {
+        std::println("\tFAILED: the router took {} of {} messages, the loopback inputs dropped frames", received, 2 * MESSAGES);
+        return;
+    }
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const auto   cpu     = ProcessCPUTime() - cpu_before;
+
+    std::println("\t{:9.0f} msgs/s routed, {} messages in {:.2f} s, {:.2f} us CPU per message (sources, router and outputs)",
+                 received / seconds, received, seconds, static_cast<double>(cpu.count()) / received);
+}
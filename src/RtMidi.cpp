@@ -39,6 +39,8 @@
 
 #include "RtMidi.h"
 #include <sstream>
+#include <algorithm>
+#include <chrono>
 #if defined(__APPLE__)
 #include <TargetConditionals.h>
 #endif
@@ -196,9 +198,12 @@ class MidiInAlsa: public MidiInApi
   void setPortName( const std::string &portName);
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
+  bool setInputThreadScheduling( int priority, int cpu );
+  bool getInputThreadScheduling( int *priority, int *cpu );
 
  protected:
   void initialize( const std::string& clientName );
+  int startInputThread( void );
 };
 
 class MidiOutAlsa: public MidiOutApi
@@ -279,6 +284,7 @@ public:
     unsigned int getPortCount(void) override;
     std::string getPortName(unsigned int portNumber) override;
     double getMessage(std::vector<unsigned char>* message) override;
+    unsigned int getMessages(std::vector<unsigned char>* bytes, std::vector<RtMidiIn::MessageInfo>* info, unsigned int maxCount) override;
 
 protected:
     void initialize(const std::string& clientName) override;
@@ -524,6 +530,9 @@ extern "C" const RtMidi::Api rtmidi_compiled_apis[] = {
 #endif
 #if defined(__AMIDI__)
   RtMidi::ANDROID_AMIDI,
+#endif
+#if defined(__RTMIDI_DUMMY__)
+  RtMidi::RTMIDI_DUMMY,
 #endif
   RtMidi::UNSPECIFIED,
 };
@@ -792,16 +801,17 @@ void MidiApi :: error( RtMidiError::Type type, std::string errorString )
 MidiInApi :: MidiInApi( unsigned int queueSizeLimit )
   : MidiApi()
 {
-  // Allocate the MIDI queue.
-  inputData_.queue.ringSize = queueSizeLimit;
-  if ( inputData_.queue.ringSize > 0 )
-    inputData_.queue.ring = new MidiMessage[ inputData_.queue.ringSize ];
+  // Allocate the MIDI queue and the buffers used while handling input,
+  // so the backend input threads do not need to allocate per message.
+  inputData_.queue.allocate( queueSizeLimit, inputData_.bufferCount, inputData_.bufferSize );
+  inputData_.message.bytes.reserve( inputData_.bufferSize );
+  inputData_.callbackBytes.reserve( inputData_.bufferSize );
 }
 
 MidiInApi :: ~MidiInApi( void )
 {
   // Delete the MIDI queue.
-  if ( inputData_.queue.ringSize > 0 ) delete [] inputData_.queue.ring;
+  inputData_.queue.release();
 }
 
 void MidiInApi :: setCallback( RtMidiIn::RtMidiCallback callback, void *userData )
@@ -861,18 +871,162 @@ double MidiInApi :: getMessage( std::vector<unsigned char> *message )
   return timeStamp;
 }
 
+unsigned int MidiInApi :: getMessages( std::vector<unsigned char> *bytes, std::vector<RtMidiIn::MessageInfo> *info, unsigned int maxCount )
+{
+  bytes->clear();
+  info->clear();
+
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::getMessages: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return 0;
+  }
+
+  return inputData_.queue.drain( bytes, info, maxCount );
+}
+
+bool MidiInApi :: waitForMessage( unsigned int timeoutMs )
+{
+  if ( inputData_.usingCallback ) {
+    errorString_ = "RtMidiIn::waitForMessage: a user callback is currently set for this port.";
+    error( RtMidiError::WARNING, errorString_ );
+    return false;
+  }
+
+  return inputData_.queue.wait( timeoutMs );
+}
+
+bool MidiInApi :: setInputThreadScheduling( int priority, int cpu )
+{
+  if ( priority <= 0 && cpu < 0 )
+    return true;
+
+  errorString_ = "RtMidiIn::setInputThreadScheduling: this API does not start an input thread of its own.";
+  error( RtMidiError::WARNING, errorString_ );
+  return false;
+}
+
+bool MidiInApi :: getInputThreadScheduling( int *, int * )
+{
+  return false;
+}
+
+void MidiInApi :: setQueueNotifier( RtMidiIn::RtMidiQueueNotifier notifier, void *userData )
+{
+  if ( connected_ ) {
+    errorString_ = "RtMidiIn::setQueueNotifier: the notifier has to be set before a port is opened.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.queue.notifier = notifier;
+  inputData_.queue.notifierData = userData;
+}
+
+void MidiInApi :: setOverflowCallback( RtMidiIn::RtMidiOverflowCallback callback, void *userData )
+{
+  if ( connected_ ) {
+    errorString_ = "RtMidiIn::setOverflowCallback: the callback has to be set before a port is opened.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.overflowCallback = callback;
+  inputData_.overflowData = userData;
+}
+
+void MidiInApi::RtMidiInData :: queueOverflow( const char *apiName )
+{
+  ++overflowCount;
+  if ( overflowCallback )
+    overflowCallback( overflowCount, overflowData );
+  else if ( overflowCount == 1 )
+    std::cerr << "\n" << apiName << ": message queue limit reached, further drops are not reported!!\n\n";
+}
+
 void MidiInApi :: setBufferSize( unsigned int size, unsigned int count )
 {
-    inputData_.bufferSize = size;
-    inputData_.bufferCount = count;
+  if ( connected_ ) {
+    errorString_ = "RtMidiIn::setBufferSize: the buffer size has to be set before a port is opened.";
+    error( RtMidiError::WARNING, errorString_ );
+    return;
+  }
+
+  inputData_.bufferSize = size;
+  inputData_.bufferCount = count;
+
+  // The constructor sized the sysex pool and the input buffers with the
+  // defaults, no input thread is running to use them now.
+  inputData_.queue.allocatePool( count, size );
+  inputData_.message.bytes.reserve( size );
+  inputData_.callbackBytes.reserve( size );
+}
+
+bool MidiInApi :: decodeAlsaEvent( MidiMessage &message, bool &continueSysex,
+                                   const unsigned char *bytes, size_t nBytes, bool sysexEvent )
+{
+  // The ALSA sequencer has a maximum buffer size for MIDI sysex
+  // events of 256 bytes.  If a device sends sysex messages larger
+  // than this, they are segmented into 256 byte chunks.  So,
+  // we'll watch for this and concatenate sysex chunks into a
+  // single sysex message if necessary.
+  if ( !continueSysex )
+    message.bytes.assign( bytes, bytes + nBytes );
+  else
+    message.bytes.insert( message.bytes.end(), bytes, bytes + nBytes );
+
+  continueSysex = sysexEvent && ( message.bytes.back() != 0xF7 );
+  return !continueSysex;
+}
+
+bool MidiInApi :: decodeJackEvent( MidiMessage &message, bool &continueSysex, unsigned char ignoreFlags,
+                                   const unsigned char *bytes, size_t size )
+{
+  if ( !continueSysex )
+    message.bytes.clear();
+
+  if ( !( ( continueSysex || bytes[0] == 0xF0 ) && ( ignoreFlags & 0x01 ) ) ) {
+    // Unless this is a (possibly continued) SysEx message and we're ignoring SysEx,
+    // copy the event buffer into the MIDI message struct.
+    for ( size_t i = 0; i < size; i++ )
+      message.bytes.push_back( bytes[i] );
+  }
+
+  switch ( bytes[0] ) {
+    case 0xF0:
+      // Start of a SysEx message
+      continueSysex = bytes[size - 1] != 0xF7;
+      if ( ignoreFlags & 0x01 ) return false;
+      break;
+    case 0xF1:
+    case 0xF8:
+      // MIDI Time Code or Timing Clock message
+      if ( ignoreFlags & 0x02 ) return false;
+      break;
+    case 0xFE:
+      // Active Sensing message
+      if ( ignoreFlags & 0x04 ) return false;
+      break;
+    default:
+      if ( continueSysex ) {
+        // Continuation of a SysEx message
+        continueSysex = bytes[size - 1] != 0xF7;
+        if ( ignoreFlags & 0x01 ) return false;
+      }
+      // All other MIDI messages
+  }
+
+  // A continued SysEx message is delivered with its last chunk.
+  return !continueSysex;
 }
 
 unsigned int MidiInApi::MidiQueue::size( unsigned int *__back,
                                          unsigned int *__front )
 {
-  // Access back/front members exactly once and make stack copies for
-  // size calculation
-  unsigned int _back = back, _front = front, _size;
+  // Load back/front exactly once and make stack copies for size
+  // calculation
+  unsigned int _back = back.load( std::memory_order_acquire );
+  unsigned int _front = front.load( std::memory_order_acquire ), _size;
   if ( _back >= _front )
     _size = _back - _front;
   else
@@ -885,45 +1039,190 @@ unsigned int MidiInApi::MidiQueue::size( unsigned int *__back,
   return _size;
 }
 
+void MidiInApi::MidiQueue::allocate( unsigned int size, unsigned int sysexBuffers, unsigned int sysexBufferSize )
+{
+  ringSize = size;
+  if ( ringSize > 0 )
+    ring = new Slot[ ringSize ];
+
+  allocatePool( sysexBuffers, sysexBufferSize );
+}
+
+// Replaces the sysex pool.  Must not be called while the producer or
+// the consumer is running.
+void MidiInApi::MidiQueue::allocatePool( unsigned int sysexBuffers, unsigned int sysexBufferSize )
+{
+  delete [] pool;
+
+  // One pool entry stays empty to tell a full pool from an empty one.
+  poolSize = sysexBuffers + 1;
+  pool = new std::vector<unsigned char>[ poolSize ];
+  for ( unsigned int i=0; i<sysexBuffers; ++i )
+    pool[i].reserve( sysexBufferSize );
+  poolFront = 0;
+  poolBack = sysexBuffers;
+}
+
+void MidiInApi::MidiQueue::release( void )
+{
+  delete [] ring;
+  ring = 0;
+  ringSize = 0;
+  delete [] pool;
+  pool = 0;
+  poolSize = 0;
+}
+
 // As long as we haven't reached our queue size limit, push the message.
-bool MidiInApi::MidiQueue::push( const MidiInApi::MidiMessage& msg )
+// Called from the backend input thread only.
+bool MidiInApi::MidiQueue::push( MidiInApi::MidiMessage& msg )
 {
-  // Local stack copies of front/back
-  unsigned int _back, _front, _size;
+  if ( ringSize == 0 )
+    return false;
 
-  // Get back/front indexes exactly once and calculate current size
-  _size = size( &_back, &_front );
+  // Only this thread writes back.  The acquire load of front makes sure
+  // the consumer is done reading the slot we are about to overwrite.
+  const unsigned int _back = back.load( std::memory_order_relaxed );
+  const unsigned int _next = ( _back + 1 ) % ringSize;
+  if ( _next == front.load( std::memory_order_acquire ) )
+    return false;
 
-  if ( _size < ringSize-1 )
-  {
-    ring[_back] = msg;
-    back = (back+1)%ringSize;
-    return true;
+  Slot &slot = ring[_back];
+  slot.size = (unsigned int) msg.bytes.size();
+  slot.timeStamp = msg.timeStamp;
+  slot.captureTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+  if ( slot.size <= inlineBytes ) {
+    std::copy( msg.bytes.begin(), msg.bytes.end(), slot.bytes );
+  }
+  else {
+    // Move the sysex into the slot and continue with whatever buffer the
+    // slot held.  If that one has no storage, take one from the pool.
+    msg.bytes.swapHeap( slot.sysex );
+    const unsigned int _poolFront = poolFront.load( std::memory_order_relaxed );
+    if ( msg.bytes.heapCapacity() == 0 && _poolFront != poolBack.load( std::memory_order_acquire ) ) {
+      msg.bytes.swapHeap( pool[_poolFront] );
+      poolFront.store( ( _poolFront + 1 ) % poolSize, std::memory_order_release );
+    }
   }
 
-  return false;
+  // Publish the slot contents to the consumer.
+  back.store( _next, std::memory_order_release );
+
+  // Wake a waiting reader on the empty to non-empty transition only, that
+  // is when front still points at the message just published.  The fence
+  // pairs with the one in hasMessages(): either the reader sees the new
+  // back or we see the front it stored before deciding to sleep.
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  if ( front.load( std::memory_order_relaxed ) == _back ) {
+    {
+      std::lock_guard<std::mutex> lock( waitMutex );
+      waitCondition.notify_one();
+    }
+    if ( notifier )
+      notifier( notifierData );
+  }
+  return true;
 }
 
+// Called from the reading thread only.
 bool MidiInApi::MidiQueue::pop( std::vector<unsigned char> *msg, double* timeStamp )
 {
-  // Local stack copies of front/back
-  unsigned int _back, _front, _size;
-
-  // Get back/front indexes exactly once and calculate current size
-  _size = size( &_back, &_front );
+  if ( ringSize == 0 )
+    return false;
 
-  if ( _size == 0 )
+  // Only this thread writes front.  The acquire load of back makes the
+  // producer's writes to the slot visible.
+  const unsigned int _front = front.load( std::memory_order_relaxed );
+  if ( _front == back.load( std::memory_order_acquire ) )
     return false;
 
   // Copy queued message to the vector pointer argument and then "pop" it.
-  msg->assign( ring[_front].bytes.begin(), ring[_front].bytes.end() );
-  *timeStamp = ring[_front].timeStamp;
+  Slot &slot = ring[_front];
+  const unsigned char *bytes = slot.size <= inlineBytes ? slot.bytes : slot.sysex.data();
+  msg->assign( bytes, bytes + slot.size );
+  *timeStamp = slot.timeStamp;
 
-  // Update front
-  front = (front+1)%ringSize;
+  recycle( slot );
+
+  // Hand the slot back to the producer.
+  front.store( ( _front + 1 ) % ringSize, std::memory_order_release );
   return true;
 }
 
+// Called from the reading thread only.
+unsigned int MidiInApi::MidiQueue::drain( std::vector<unsigned char> *bytes,
+                                          std::vector<RtMidiIn::MessageInfo> *info,
+                                          unsigned int maxCount )
+{
+  if ( ringSize == 0 )
+    return 0;
+
+  // Synchronize with the producer once for the whole batch: everything
+  // published up to this load of back is visible, later pushes are left
+  // for the next call.
+  unsigned int _front = front.load( std::memory_order_relaxed );
+  const unsigned int _back = back.load( std::memory_order_acquire );
+  unsigned int count = 0;
+
+  while ( _front != _back && ( maxCount == 0 || count < maxCount ) ) {
+    Slot &slot = ring[_front];
+    const unsigned char *data = slot.size <= inlineBytes ? slot.bytes : slot.sysex.data();
+
+    RtMidiIn::MessageInfo entry;
+    entry.offset = bytes->size();
+    entry.size = slot.size;
+    entry.timeStamp = slot.timeStamp;
+    entry.captureTime = slot.captureTime;
+    bytes->insert( bytes->end(), data, data + slot.size );
+    info->push_back( entry );
+
+    recycle( slot );
+    _front = ( _front + 1 ) % ringSize;
+    ++count;
+  }
+
+  // Hand all consumed slots back to the producer at once.
+  if ( count > 0 )
+    front.store( _front, std::memory_order_release );
+  return count;
+}
+
+// Called from the reading thread only.
+bool MidiInApi::MidiQueue::wait( unsigned int timeoutMs )
+{
+  if ( ringSize == 0 )
+    return false;
+  if ( hasMessages() )
+    return true;
+
+  std::unique_lock<std::mutex> lock( waitMutex );
+  return waitCondition.wait_for( lock, std::chrono::milliseconds( timeoutMs ),
+                                 [this] { return hasMessages(); } );
+}
+
+bool MidiInApi::MidiQueue::hasMessages( void )
+{
+  std::atomic_thread_fence( std::memory_order_seq_cst );
+  return front.load( std::memory_order_relaxed ) != back.load( std::memory_order_acquire );
+}
+
+// Returns the sysex buffer of a consumed slot to the producer unless the
+// pool is full.  Called from the reading thread only.
+void MidiInApi::MidiQueue::recycle( Slot &slot )
+{
+  if ( slot.size <= inlineBytes )
+    return;
+
+  const unsigned int _poolBack = poolBack.load( std::memory_order_relaxed );
+  const unsigned int _poolNext = ( _poolBack + 1 ) % poolSize;
+  if ( _poolNext != poolFront.load( std::memory_order_acquire ) ) {
+    slot.sysex.clear();
+    pool[_poolBack].swap( slot.sysex );
+    poolBack.store( _poolNext, std::memory_order_release );
+  }
+}
+
 //*********************************************************************//
 //  Common MidiOutApi Definitions
 //*********************************************************************//
@@ -1048,13 +1347,12 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
       if ( !( data->ignoreFlags & 0x01 ) && !continueSysex ) {
         // If not a continuing sysex message, invoke the user callback function or queue the message.
         if ( data->usingCallback ) {
-          RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-          callback( message.timeStamp, &message.bytes, data->userData );
+          data->invokeCallback( message );
         }
         else {
           // As long as we haven't reached our queue size limit, push the message.
           if ( !data->queue.push( message ) )
-            std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
+            data->queueOverflow( "MidiInCore" );
         }
         message.bytes.clear();
       }
@@ -1107,13 +1405,12 @@ static void midiInputCallback( const MIDIPacketList *list, void *procRef, void *
           if ( !continueSysex ) {
             // If not a continuing sysex message, invoke the user callback function or queue the message.
             if ( data->usingCallback ) {
-              RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-              callback( message.timeStamp, &message.bytes, data->userData );
+              data->invokeCallback( message );
             }
             else {
               // As long as we haven't reached our queue size limit, push the message.
               if ( !data->queue.push( message ) )
-                std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
+                data->queueOverflow( "MidiInCore" );
             }
             message.bytes.clear();
           }
@@ -1767,6 +2064,10 @@ struct AlsaMidiData {
   snd_seq_real_time_t lastTime;
   int queue_id; // an input queue is needed to get timestamped events
   int trigger_fds[2];
+
+  // Requested input thread scheduling, see RtMidiIn::setInputThreadScheduling.
+  int threadPriority;
+  int threadCpu;
 };
 
 #define PORT_TYPE( pinfo, bits ) ((snd_seq_port_info_get_capability(pinfo) & (bits)) == (bits))
@@ -1807,6 +2108,7 @@ static void *alsaMidiHandler( void *ptr )
   }
   snd_midi_event_init( apiData->coder );
   snd_midi_event_no_status( apiData->coder, 1 ); // suppress running status messages
+  message.bytes.reserve( apiData->bufferSize );
 
   poll_fd_count = snd_seq_poll_descriptors_count( apiData->seq, POLLIN ) + 1;
   poll_fds = (struct pollfd*)alloca( poll_fd_count * sizeof( struct pollfd ));
@@ -1903,18 +2205,8 @@ static void *alsaMidiHandler( void *ptr )
 
       nBytes = snd_midi_event_decode( apiData->coder, buffer, apiData->bufferSize, ev );
       if ( nBytes > 0 ) {
-        // The ALSA sequencer has a maximum buffer size for MIDI sysex
-        // events of 256 bytes.  If a device sends sysex messages larger
-        // than this, they are segmented into 256 byte chunks.  So,
-        // we'll watch for this and concatenate sysex chunks into a
-        // single sysex message if necessary.
-        if ( !continueSysex )
-          message.bytes.assign( buffer, &buffer[nBytes] );
-        else
-          message.bytes.insert( message.bytes.end(), buffer, &buffer[nBytes] );
-
-        continueSysex = ( ( ev->type == SND_SEQ_EVENT_SYSEX ) && ( message.bytes.back() != 0xF7 ) );
-        if ( !continueSysex ) {
+        if ( MidiInApi::decodeAlsaEvent( message, continueSysex, buffer, nBytes,
+                                         ev->type == SND_SEQ_EVENT_SYSEX ) ) {
 
           // Calculate the time stamp:
           message.timeStamp = 0.0;
@@ -1969,13 +2261,12 @@ static void *alsaMidiHandler( void *ptr )
     if ( message.bytes.size() == 0 || continueSysex ) continue;
 
     if ( data->usingCallback ) {
-      RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-      callback( message.timeStamp, &message.bytes, data->userData );
+      data->invokeCallback( message );
     }
     else {
       // As long as we haven't reached our queue size limit, push the message.
       if ( !data->queue.push( message ) )
-        std::cerr << "\nMidiInAlsa: message queue limit reached!!\n\n";
+        data->queueOverflow( "MidiInAlsa" );
     }
   }
 
@@ -2043,6 +2334,8 @@ void MidiInAlsa :: initialize( const std::string& clientName )
   data->trigger_fds[0] = -1;
   data->trigger_fds[1] = -1;
   data->bufferSize = inputData_.bufferSize;
+  data->threadPriority = 0;
+  data->threadCpu = -1;
   apiData_ = (void *) data;
   inputData_.apiData = (void *) data;
 
@@ -2223,14 +2516,8 @@ void MidiInAlsa :: openPort( unsigned int portNumber, const std::string &portNam
     snd_seq_drain_output( data->seq );
 #endif
     // Start our MIDI input thread.
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-
     inputData_.doInput = true;
-    int err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
-    pthread_attr_destroy( &attr );
+    int err = startInputThread();
     if ( err ) {
       snd_seq_unsubscribe_port( data->seq, data->subscription );
       snd_seq_port_subscribe_free( data->subscription );
@@ -2285,14 +2572,8 @@ void MidiInAlsa :: openVirtualPort( const std::string &portName )
     snd_seq_drain_output( data->seq );
 #endif
     // Start our MIDI input thread.
-    pthread_attr_t attr;
-    pthread_attr_init( &attr );
-    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
-    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
-
     inputData_.doInput = true;
-    int err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
-    pthread_attr_destroy( &attr );
+    int err = startInputThread();
     if ( err ) {
       if ( data->subscription ) {
         snd_seq_unsubscribe_port( data->seq, data->subscription );
@@ -2335,6 +2616,95 @@ void MidiInAlsa :: closePort( void )
   }
 }
 
+bool MidiInAlsa :: setInputThreadScheduling( int priority, int cpu )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( priority > sched_get_priority_max( SCHED_FIFO ) ) {
+    errorString_ = "MidiInAlsa::setInputThreadScheduling: priority out of the SCHED_FIFO range.";
+    error( RtMidiError::WARNING, errorString_ );
+    return false;
+  }
+
+  data->threadPriority = priority > 0 ? priority : 0;
+  data->threadCpu = cpu >= 0 ? cpu : -1;
+  return true;
+}
+
+bool MidiInAlsa :: getInputThreadScheduling( int *priority, int *cpu )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( !inputData_.doInput || pthread_equal( data->thread, data->dummy_thread_id ) )
+    return false;
+
+  int policy;
+  struct sched_param param;
+  if ( pthread_getschedparam( data->thread, &policy, &param ) != 0 )
+    return false;
+
+  *priority = ( policy == SCHED_FIFO || policy == SCHED_RR ) ? param.sched_priority : 0;
+  *cpu = -1;
+#if defined(__GLIBC__)
+  cpu_set_t cpus;
+  if ( pthread_getaffinity_np( data->thread, sizeof( cpus ), &cpus ) == 0 && CPU_COUNT( &cpus ) == 1 ) {
+    for ( int i=0; i<CPU_SETSIZE; ++i ) {
+      if ( CPU_ISSET( i, &cpus ) ) {
+        *cpu = i;
+        break;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+// Starts alsaMidiHandler with the requested scheduling.  Where the
+// system refuses that (SCHED_FIFO needs CAP_SYS_NICE or an rtprio
+// limit), the CPU affinity alone and then the default scheduling are
+// tried, with a warning.
+int MidiInAlsa :: startInputThread( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+
+  int priorities[3] = { data->threadPriority, 0, 0 };
+  int cpus[3] = { data->threadCpu, data->threadCpu, -1 };
+  int err = 0;
+  for ( int i=0; i<3; ++i ) {
+    // Skip the attempts that would repeat the previous one.
+    if ( i > 0 && priorities[i] == priorities[i-1] && cpus[i] == cpus[i-1] ) continue;
+    int priority = priorities[i];
+    int cpu = cpus[i];
+
+    pthread_attr_t attr;
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_JOINABLE );
+    pthread_attr_setschedpolicy( &attr, SCHED_OTHER );
+    if ( priority > 0 ) {
+      struct sched_param param;
+      param.sched_priority = priority;
+      pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+      pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+      pthread_attr_setschedparam( &attr, &param );
+    }
+#if defined(__GLIBC__)
+    if ( cpu >= 0 && cpu < CPU_SETSIZE ) {
+      cpu_set_t cpuset;
+      CPU_ZERO( &cpuset );
+      CPU_SET( cpu, &cpuset );
+      pthread_attr_setaffinity_np( &attr, sizeof( cpuset ), &cpuset );
+    }
+#endif
+
+    err = pthread_create( &data->thread, &attr, alsaMidiHandler, &inputData_ );
+    pthread_attr_destroy( &attr );
+    if ( !err || ( priority == 0 && cpu < 0 ) )
+      break;
+
+    errorString_ = "MidiInAlsa::startInputThread: the system refused the requested input thread scheduling, falling back.";
+    error( RtMidiError::WARNING, errorString_ );
+  }
+  return err;
+}
+
 void MidiInAlsa :: setClientName( const std::string &clientName )
 {
 
@@ -2771,13 +3141,12 @@ static void CALLBACK midiInputCallback( HMIDIIN /*hmin*/,
   apiData->lastTime = timestamp;
 
   if ( data->usingCallback ) {
-    RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-    callback( apiData->message.timeStamp, &apiData->message.bytes, data->userData );
+    data->invokeCallback( apiData->message );
   }
   else {
     // As long as we haven't reached our queue size limit, push the message.
     if ( !data->queue.push( apiData->message ) )
-      std::cerr << "\nMidiInWinMM: message queue limit reached!!\n\n";
+      data->queueOverflow( "MidiInWinMM" );
   }
 
   // Clear the vector for the next input message.
@@ -2817,6 +3186,7 @@ void MidiInWinMM :: initialize( const std::string& /*clientName*/ )
   apiData_ = (void *) data;
   inputData_.apiData = (void *) data;
   data->message.bytes.clear();  // needs to be empty for first input message
+  data->message.bytes.reserve( inputData_.bufferSize );
 
   if ( !InitializeCriticalSectionAndSpinCount( &(data->_mutex), 0x00000400 ) ) {
     errorString_ = "MidiInWinMM::initialize: InitializeCriticalSectionAndSpinCount failed.";
@@ -3650,7 +4020,7 @@ void UWPMidiClass::midi_in_callback(const MidiInPort&, const MidiMessageReceived
 
     if (input_data_->usingCallback)
     {
-        (input_data_->userCallback)(message.timeStamp, &message.bytes, input_data_->userData);
+        input_data_->invokeCallback(message);
     }
     else
     {
@@ -3658,7 +4028,7 @@ void UWPMidiClass::midi_in_callback(const MidiInPort&, const MidiMessageReceived
 
         if (!input_data_->queue.push(message))
         {
-            std::cerr << "\nMidiInWinUWP: message queue limit reached!!\n\n";
+            input_data_->queueOverflow( "MidiInWinUWP" );
         }
     }
 }
@@ -3819,6 +4189,14 @@ double MidiInWinUWP::getMessage(std::vector<unsigned char>* message)
     return MidiInApi::getMessage(message);
 }
 
+unsigned int MidiInWinUWP::getMessages(std::vector<unsigned char>* bytes, std::vector<RtMidiIn::MessageInfo>* info, unsigned int maxCount)
+{
+    UWPMidiClass* data{ static_cast<UWPMidiClass*>(apiData_) };
+    std::lock_guard<std::mutex> lock(data->mtx_queue_);
+
+    return MidiInApi::getMessages(bytes, info, maxCount);
+}
+
 //*********************************************************************//
 //  API: Windows UWP
 //  Class Definitions: MidiOutWinUWP
@@ -4041,52 +4419,18 @@ static int jackProcessIn( jack_nframes_t nframes, void *arg )
 
     jData->lastTime = time;
 
-    if ( !continueSysex )
-      message.bytes.clear();
+    if ( !MidiInApi::decodeJackEvent( message, continueSysex, ignoreFlags, event.buffer, event.size ) )
+      continue;
 
-    if ( !( ( continueSysex || event.buffer[0] == 0xF0 ) && ( ignoreFlags & 0x01 ) ) ) {
-      // Unless this is a (possibly continued) SysEx message and we're ignoring SysEx,
-      // copy the event buffer into the MIDI message struct.
-      for ( unsigned int i = 0; i < event.size; i++ )
-        message.bytes.push_back( event.buffer[i] );
+    // If not a continuation of a SysEx message,
+    // invoke the user callback function or queue the message.
+    if ( rtData->usingCallback ) {
+      rtData->invokeCallback( message );
     }
-
-    switch ( event.buffer[0] ) {
-      case 0xF0:
-        // Start of a SysEx message
-        continueSysex = event.buffer[event.size - 1] != 0xF7;
-        if ( ignoreFlags & 0x01 ) continue;
-        break;
-      case 0xF1:
-      case 0xF8:
-        // MIDI Time Code or Timing Clock message
-        if ( ignoreFlags & 0x02 ) continue;
-        break;
-      case 0xFE:
-        // Active Sensing message
-        if ( ignoreFlags & 0x04 ) continue;
-        break;
-      default:
-        if ( continueSysex ) {
-          // Continuation of a SysEx message
-          continueSysex = event.buffer[event.size - 1] != 0xF7;
-          if ( ignoreFlags & 0x01 ) continue;
-        }
-        // All other MIDI messages
-    }
-
-    if ( !continueSysex ) {
-      // If not a continuation of a SysEx message,
-      // invoke the user callback function or queue the message.
-      if ( rtData->usingCallback ) {
-        RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) rtData->userCallback;
-        callback( message.timeStamp, &message.bytes, rtData->userData );
-      }
-      else {
-        // As long as we haven't reached our queue size limit, push the message.
-        if ( !rtData->queue.push( message ) )
-          std::cerr << "\nMidiInJack: message queue limit reached!!\n\n";
-      }
+    else {
+      // As long as we haven't reached our queue size limit, push the message.
+      if ( !rtData->queue.push( message ) )
+        rtData->queueOverflow( "MidiInJack" );
     }
   }
 
@@ -4649,8 +4993,7 @@ extern "C" void EMSCRIPTEN_KEEPALIVE rtmidi_onMidiMessageProc( MidiInApi::RtMidi
   memcpy(message.bytes.data(), inputBytes, length);
   // FIXME: handle timestamp
   if ( data->usingCallback ) {
-    RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) data->userCallback;
-    callback( message.timeStamp, &message.bytes, data->userData );
+    data->invokeCallback( message );
   }
 }
 
@@ -5146,7 +5489,7 @@ void* MidiInAndroid :: pollMidi(void* context) {
     }
 
     if (numMessagesReceived > 0 && numBytesReceived >= 0) {
-      auto message = self->inputData_.message;
+      auto &message = self->inputData_.message;
 
       if (self->inputData_.firstMessage == true) {
         message.timeStamp = 0.0;
@@ -5167,11 +5510,10 @@ void* MidiInAndroid :: pollMidi(void* context) {
 
       if (!continueSysex) {
         if (self->inputData_.usingCallback) {
-          auto callback = (RtMidiIn::RtMidiCallback) self->inputData_.userCallback;
-          callback(message.timeStamp, &message.bytes, self->inputData_.userData);
+          self->inputData_.invokeCallback( message );
         } else {
           if (!self->inputData_.queue.push(message))
-            std::cerr << "\nMidiInAndroid: message queue limit reached!!\n\n";
+            self->inputData_.queueOverflow( "MidiInAndroid" );
         }
       }
     }
@@ -77,8 +77,12 @@
                         "." RTMIDI_TOSTRING(RTMIDI_VERSION_PATCH)
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <exception>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -278,6 +282,12 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   //! User callback function type definition.
   typedef void (*RtMidiCallback)( double timeStamp, std::vector<unsigned char> *message, void *userData );
 
+  //! Queue notifier function type definition, see setQueueNotifier().
+  typedef void (*RtMidiQueueNotifier)( void *userData );
+
+  //! Queue overflow function type definition, see setOverflowCallback().
+  typedef void (*RtMidiOverflowCallback)( unsigned long droppedCount, void *userData );
+
   //! Default constructor that allows an optional api, client name and queue size.
   /*!
     An exception will be thrown if a MIDI system initialization
@@ -392,6 +402,73 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   */
   double getMessage( std::vector<unsigned char> *message );
 
+  //! Location and delta-time of one message returned by getMessages().
+  struct MessageInfo {
+    size_t offset;    //!< Index of the first message byte in the bytes vector.
+    size_t size;      //!< Number of message bytes.
+    double timeStamp; //!< Event delta-time in seconds, as returned by getMessage().
+    long long captureTime; //!< std::chrono::steady_clock time in nanoseconds at which the input thread queued the message.
+  };
+
+  //! Drain the pending MIDI messages of the input queue into one packed byte vector and return the number of messages.
+  /*!
+    Both vectors are cleared first (keeping their capacity), then the
+    bytes of every available message are appended back to back to \e
+    bytes and one MessageInfo per message is appended to \e info.  At
+    most \e maxCount messages are taken if it is non-zero.  This
+    function returns immediately and is the bulk equivalent of calling
+    getMessage() until it returns an empty message, with a single
+    synchronization with the input thread for the whole batch.  It
+    can not be used while a callback function is set.
+  */
+  unsigned int getMessages( std::vector<unsigned char> *bytes, std::vector<MessageInfo> *info, unsigned int maxCount = 0 );
+
+  //! Block until a MIDI message is available in the input queue or \e timeoutMs milliseconds have passed.
+  /*!
+    Returns true if a message can be read with getMessage() or
+    getMessages(), false on timeout.  The input thread only wakes the
+    waiting thread when the queue goes from empty to non-empty, so
+    this replaces polling without adding work per message.  It can
+    not be used while a callback function is set.
+  */
+  bool waitForMessage( unsigned int timeoutMs );
+
+  //! Set a function to be invoked by the input thread when a message arrives in an empty input queue.
+  /*!
+    This lets a single thread wait for many input ports at once instead
+    of calling waitForMessage() on each of them.  The notifier runs on
+    the input thread and has to return quickly.  It fires on the same
+    empty to non-empty transition that wakes waitForMessage(), so a
+    reader should drain the queue with getMessages() and check
+    waitForMessage( 0 ) before relying on the next notification.  Set
+    it before opening a port, NULL removes it.
+  */
+  void setQueueNotifier( RtMidiQueueNotifier notifier, void *userData = 0 );
+
+  //! Set a function to be invoked by the input thread when a message is dropped because the input queue is full.
+  /*!
+    It receives the number of messages dropped so far, runs on the
+    input thread and has to return quickly.  Without one, only the
+    first dropped message is reported on std::cerr, so an overflowing
+    queue does not turn into console writes on the input thread.  Set
+    it before opening a port, NULL removes it.
+  */
+  void setOverflowCallback( RtMidiOverflowCallback callback, void *userData = 0 );
+
+  //! Set the scheduling of the input thread started by the next openPort() or openVirtualPort().
+  /*!
+    A \e priority above 0 requests SCHED_FIFO at that priority and a
+    \e cpu of 0 or above pins the thread to that CPU.  Where the
+    system refuses (e.g. without CAP_SYS_NICE), the thread is started
+    with less and a warning is issued, getInputThreadScheduling()
+    tells what was applied.  Only the LINUX_ALSA API starts an input
+    thread of its own, the others return false.
+  */
+  bool setInputThreadScheduling( int priority, int cpu = -1 );
+
+  //! Get the SCHED_FIFO priority (0 for default scheduling) and the CPU (-1 if not pinned to one) of the running input thread, false if there is none.
+  bool getInputThreadScheduling( int *priority, int *cpu );
+
   //! Set an error callback function to be invoked when an error has occurred.
   /*!
     The callback function will be called whenever an error has occurred. It is best
@@ -402,8 +479,9 @@ class RTMIDI_DLL_PUBLIC RtMidiIn : public RtMidi
   //! Set maximum expected incoming message size.
   /*!
     For APIs that require manual buffer management, it can be useful to set the buffer
-    size and buffer count when expecting to receive large SysEx messages.  Note that
-    currently this function has no effect when called after openPort().  The default
+    size and buffer count when expecting to receive large SysEx messages.  The input
+    queue keeps count buffers of this size to hand SysEx to the reader without allocating.
+    This function has no effect (and issues a warning) when called after openPort().  The default
     buffer size is 1024 with a count of 4 buffers, which should be sufficient for most
     cases; as mentioned, this does not affect all API backends, since most either support
     dynamically scalable buffers or take care of buffer handling themselves.  It is
@@ -579,33 +657,178 @@ class RTMIDI_DLL_PUBLIC MidiInApi : public MidiApi
   void cancelCallback( void );
   virtual void ignoreTypes( bool midiSysex, bool midiTime, bool midiSense );
   virtual double getMessage( std::vector<unsigned char> *message );
+  virtual unsigned int getMessages( std::vector<unsigned char> *bytes, std::vector<RtMidiIn::MessageInfo> *info, unsigned int maxCount );
+  virtual bool waitForMessage( unsigned int timeoutMs );
+  void setQueueNotifier( RtMidiIn::RtMidiQueueNotifier notifier, void *userData );
+  void setOverflowCallback( RtMidiIn::RtMidiOverflowCallback callback, void *userData );
+  virtual bool setInputThreadScheduling( int priority, int cpu );
+  virtual bool getInputThreadScheduling( int *priority, int *cpu );
   virtual void setBufferSize( unsigned int size, unsigned int count );
 
+  // Byte storage for one incoming MIDI message.  Messages up to
+  // inlineBytes long (all channel and system messages) live inside the
+  // object, longer ones (sysex) spill into a heap buffer whose capacity
+  // is kept across clear() and which is recycled through the queue's
+  // sysex pool, so input handling does not allocate per event.  Provides
+  // the subset of the std::vector interface used by the backends.
+  class MidiBytes {
+   public:
+    static const unsigned int inlineBytes = 16;
+
+    MidiBytes()
+      : size_(0), onHeap_(false) {}
+
+    unsigned char *data() { return onHeap_ ? heap_.data() : inline_; }
+    const unsigned char *data() const { return onHeap_ ? heap_.data() : inline_; }
+    unsigned char *begin() { return data(); }
+    unsigned char *end() { return data() + size_; }
+    const unsigned char *begin() const { return data(); }
+    const unsigned char *end() const { return data() + size_; }
+    unsigned char &operator[]( size_t i ) { return data()[i]; }
+    unsigned char &back() { return data()[size_ - 1]; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t heapCapacity() const { return heap_.capacity(); }
+
+    void clear() { size_ = 0; onHeap_ = false; heap_.clear(); }
+    void reserve( size_t n ) { heap_.reserve( n ); }
+
+    void push_back( unsigned char byte ) {
+      if ( !onHeap_ && size_ < inlineBytes ) {
+        inline_[size_++] = byte;
+        return;
+      }
+      spill();
+      heap_.push_back( byte );
+      size_++;
+    }
+
+    void assign( const unsigned char *first, const unsigned char *last ) {
+      clear();
+      insert( end(), first, last );
+    }
+
+    // Only appending (position == end()) is supported.
+    void insert( unsigned char * /*position*/, const unsigned char *first, const unsigned char *last ) {
+      const size_t n = last - first;
+      if ( !onHeap_ && size_ + n <= inlineBytes ) {
+        std::copy( first, last, inline_ + size_ );
+        size_ += n;
+        return;
+      }
+      spill();
+      heap_.insert( heap_.end(), first, last );
+      size_ += n;
+    }
+
+    void resize( size_t n ) {
+      if ( !onHeap_ && n <= inlineBytes ) {
+        if ( n > size_ ) std::fill( inline_ + size_, inline_ + n, 0 );
+        size_ = n;
+        return;
+      }
+      spill();
+      heap_.resize( n );
+      size_ = n;
+    }
+
+    // Exchanges the heap buffer (holding exactly size() bytes) with
+    // buffer and leaves this object empty.  Used to hand sysex to and
+    // from the queue without copying.
+    void swapHeap( std::vector<unsigned char> &buffer ) {
+      spill();
+      heap_.swap( buffer );
+      clear();
+    }
+
+   private:
+    void spill() {
+      if ( onHeap_ ) return;
+      heap_.assign( inline_, inline_ + size_ );
+      onHeap_ = true;
+    }
+
+    unsigned char inline_[inlineBytes];
+    std::vector<unsigned char> heap_;
+    size_t size_;
+    bool onHeap_;
+  };
+
   // A MIDI structure used internally by the class to store incoming
   // messages.  Each message represents one and only one MIDI message.
   struct MidiMessage {
-    std::vector<unsigned char> bytes;
+    MidiBytes bytes;
 
     //! Time in seconds elapsed since the previous message
     double timeStamp;
 
     // Default constructor.
     MidiMessage()
-      : bytes(0), timeStamp(0.0) {}
+      : timeStamp(0.0) {}
   };
 
+  // A wait-free single-producer/single-consumer ring shared between the
+  // backend input thread (push) and the reading thread (pop).  The slots
+  // are allocated once; messages up to inlineBytes long (all channel and
+  // system messages) are copied into fixed storage inside the slot.
+  // Sysex buffers are moved into the slot instead of copied, and the
+  // reader returns them to the input thread through a second ring of
+  // preallocated buffers (the sysex pool).
   struct MidiQueue {
-    unsigned int front;
-    unsigned int back;
+    static const unsigned int inlineBytes = MidiBytes::inlineBytes;
+
+    struct Slot {
+      unsigned char bytes[inlineBytes];
+      std::vector<unsigned char> sysex;
+      unsigned int size;
+      double timeStamp;
+      long long captureTime;
+
+      Slot()
+        : size(0), timeStamp(0.0), captureTime(0) {}
+    };
+
+    std::atomic<unsigned int> front; // written by the consumer only
+    std::atomic<unsigned int> back;  // written by the producer only
     unsigned int ringSize;
-    MidiMessage *ring;
+    Slot *ring;
+
+    // Empty sysex buffers flowing from the consumer back to the producer.
+    std::atomic<unsigned int> poolFront; // written by the producer only
+    std::atomic<unsigned int> poolBack;  // written by the consumer only
+    unsigned int poolSize;
+    std::vector<unsigned char> *pool;
+
+    // Called by push() next to waking the reader, see setQueueNotifier().
+    RtMidiIn::RtMidiQueueNotifier notifier;
+    void *notifierData;
 
     // Default constructor.
     MidiQueue()
-      : front(0), back(0), ringSize(0), ring(0) {}
-    bool push( const MidiMessage& );
+      : front(0), back(0), ringSize(0), ring(0), poolFront(0), poolBack(0), poolSize(0), pool(0),
+        notifier(0), notifierData(0) {}
+    void allocate( unsigned int size, unsigned int sysexBuffers, unsigned int sysexBufferSize );
+    void allocatePool( unsigned int sysexBuffers, unsigned int sysexBufferSize );
+    void release( void );
+    // May take over the sysex buffer of the message, which is left empty then.
+    bool push( MidiMessage& );
     bool pop( std::vector<unsigned char>*, double* );
+    // Pops up to maxCount (0 for all) messages in one pass, appending them
+    // to bytes and info.  Returns the number of messages taken.
+    unsigned int drain( std::vector<unsigned char>*, std::vector<RtMidiIn::MessageInfo>*, unsigned int maxCount );
     unsigned int size( unsigned int *back=0, unsigned int *front=0 );
+    // Blocks the reading thread until the queue is non-empty or timeoutMs
+    // has passed.  Returns false on timeout.
+    bool wait( unsigned int timeoutMs );
+
+   private:
+    void recycle( Slot& );
+    bool hasMessages( void );
+
+    // Only used to put the reader to sleep; push() takes the mutex solely
+    // on the empty to non-empty transition.
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
   };
 
   // The RtMidiInData structure is used to pass private class data to
@@ -623,13 +846,43 @@ class RTMIDI_DLL_PUBLIC MidiInApi : public MidiApi
     bool continueSysex;
     unsigned int bufferSize;
     unsigned int bufferCount;
+    std::vector<unsigned char> callbackBytes;
+    RtMidiIn::RtMidiOverflowCallback overflowCallback;
+    void *overflowData;
+    unsigned long overflowCount;
 
     // Default constructor.
     RtMidiInData()
       : ignoreFlags(7), doInput(false), firstMessage(true), apiData(0), usingCallback(false),
-        userCallback(0), userData(0), continueSysex(false), bufferSize(1024), bufferCount(4) {}
+        userCallback(0), userData(0), continueSysex(false), bufferSize(1024), bufferCount(4),
+        overflowCallback(0), overflowData(0), overflowCount(0) {}
+
+    // Called by the input thread for every message the full queue
+    // dropped, see setOverflowCallback().
+    void queueOverflow( const char *apiName );
+
+    // Hands message to the user callback through callbackBytes, which
+    // keeps its capacity so this does not allocate per message.
+    void invokeCallback( const MidiMessage &message ) {
+      callbackBytes.assign( message.bytes.begin(), message.bytes.end() );
+      RtMidiIn::RtMidiCallback callback = (RtMidiIn::RtMidiCallback) userCallback;
+      callback( message.timeStamp, &callbackBytes, userData );
+    }
   };
 
+  // Decode steps of the ALSA and JACK input handlers, kept outside the
+  // API sections so they can be exercised without the libraries.  Both
+  // return true once message holds a complete message to deliver.
+
+  // One event decoded by snd_midi_event_decode().  The sequencer splits
+  // sysex into chunks of up to 256 bytes, which are concatenated until
+  // the closing F7.
+  static bool decodeAlsaEvent( MidiMessage &message, bool &continueSysex,
+                               const unsigned char *bytes, size_t nBytes, bool sysexEvent );
+  // One event of a JACK port buffer, dropped if ignoreFlags filters it.
+  static bool decodeJackEvent( MidiMessage &message, bool &continueSysex, unsigned char ignoreFlags,
+                               const unsigned char *bytes, size_t size );
+
  protected:
   RtMidiInData inputData_;
 };
@@ -660,6 +913,12 @@ inline unsigned int RtMidiIn :: getPortCount( void ) { return rtapi_->getPortCou
 inline std::string RtMidiIn :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
 inline void RtMidiIn :: ignoreTypes( bool midiSysex, bool midiTime, bool midiSense ) { static_cast<MidiInApi *>(rtapi_)->ignoreTypes( midiSysex, midiTime, midiSense ); }
 inline double RtMidiIn :: getMessage( std::vector<unsigned char> *message ) { return static_cast<MidiInApi *>(rtapi_)->getMessage( message ); }
+inline unsigned int RtMidiIn :: getMessages( std::vector<unsigned char> *bytes, std::vector<MessageInfo> *info, unsigned int maxCount ) { return static_cast<MidiInApi *>(rtapi_)->getMessages( bytes, info, maxCount ); }
+inline bool RtMidiIn :: waitForMessage( unsigned int timeoutMs ) { return static_cast<MidiInApi *>(rtapi_)->waitForMessage( timeoutMs ); }
+inline void RtMidiIn :: setQueueNotifier( RtMidiQueueNotifier notifier, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setQueueNotifier( notifier, userData ); }
+inline void RtMidiIn :: setOverflowCallback( RtMidiOverflowCallback callback, void *userData ) { static_cast<MidiInApi *>(rtapi_)->setOverflowCallback( callback, userData ); }
+inline bool RtMidiIn :: setInputThreadScheduling( int priority, int cpu ) { return static_cast<MidiInApi *>(rtapi_)->setInputThreadScheduling( priority, cpu ); }
+inline bool RtMidiIn :: getInputThreadScheduling( int *priority, int *cpu ) { return static_cast<MidiInApi *>(rtapi_)->getInputThreadScheduling( priority, cpu ); }
 inline void RtMidiIn :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData ) { rtapi_->setErrorCallback(errorCallback, userData); }
 inline void RtMidiIn :: setBufferSize( unsigned int size, unsigned int count ) { static_cast<MidiInApi *>(rtapi_)->setBufferSize(size, count); }
 
@@ -0,0 +1,219 @@
+#include "bridge_pool.hpp"
+#include "logging.hpp"
+#include "thread_util.hpp"
+
+// same depth as the single port input of MIDI_IO_MANAGER
+constexpr unsigned int BRIDGE_QUEUE_SIZE = 1000;
+
+MIDI_Bridge_Pool::MIDI_Bridge_Pool(std::shared_ptr<MIDI_Transport> transport, size_t worker_count,
+                                   std::chrono::microseconds batch_window, size_t batch_max_bytes)
+    : m_p_transport(std::move(transport))
+    , m_batch_window(batch_window)
+    , m_batch_max_bytes(batch_max_bytes) {
+    for (size_t i = 0; i < std::max<size_t>(worker_count, 1); i++) {
+        m_workers.push_back(std::make_unique<Bridge_Worker>());
+        m_workers.back()->batch.bytes.reserve(MAX_SYSEX_BUFFER);
+    }
+}
+
+MIDI_Bridge_Pool::~MIDI_Bridge_Pool() {
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.request_stop();
+            worker->thread.join();
+        }
+    }
+
+    // closing joins the input threads, so no notifier runs into a port that is going away
+    for (auto& port : m_ports) {
+        if (port->midi_in->isPortOpen()) {
+            port->midi_in->closePort();
+        }
+    }
+}
+
+bool MIDI_Bridge_Pool::AddPort(std::string_view midi_input, std::string_view ndi_send_name) {
+    auto port = OpenPort(midi_input);
+    if (!port) {
+        return false;
+    }
+
+    port->sender = std::make_unique<MIDI_Sender>(m_p_transport->CreateSender(ndi_send_name));
+    port->sender->SetBatching(m_batch_window, m_batch_max_bytes, false);
+    port->output = [p_sender = port->sender.get()](std::span<uint8_t> data, int64_t timecode) { p_sender->SendMIDI(data, timecode); };
+
+    std::println("Publishing MIDI port {} as {}", midi_input, ndi_send_name);
+
+    port->worker->ports.push_back(port.get());
+    m_ports.push_back(std::move(port));
+    return true;
+}
+
+bool MIDI_Bridge_Pool::AddPort(std::string_view midi_input, Output output) {
+    auto port = OpenPort(midi_input);
+    if (!port) {
+        return false;
+    }
+
+    port->output = std::move(output);
+
+    port->worker->ports.push_back(port.get());
+    m_ports.push_back(std::move(port));
+    return true;
+}
+
+std::unique_ptr<MIDI_Bridge_Pool::Bridge_Port> MIDI_Bridge_Pool::OpenPort(std::string_view midi_input) {
+    auto port = std::make_unique<Bridge_Port>();
+
+    try {
+        port->midi_in = std::make_unique<RtMidiIn>(RtMidi::Api::UNSPECIFIED, "RtMidi Input Client", BRIDGE_QUEUE_SIZE);
+    } catch (RtMidiError& error) {
+        std::println("error creating RtMidiIn: {}", error.getMessage());
+        return nullptr;
+    }
+
+    std::optional<uint32_t> port_number;
+    for (uint32_t i = 0; i < port->midi_in->getPortCount(); i++) {
+        try {
+            if (port->midi_in->getPortName(i) == midi_input) {
+                port_number = i;
+                break;
+            }
+        } catch (RtMidiError& error) {
+            std::println("error getting port name: {}", error.getMessage());
+        }
+    }
+
+    if (!port_number) {
+        std::println("MIDI input {} not found", midi_input);
+        return nullptr;
+    }
+
+    // ports are spread evenly, a worker only ever touches its own
+    port->worker = m_workers[m_ports.size() % m_workers.size()].get();
+    port->midi_in->setQueueNotifier(NotifyReady, port.get());
+    port->midi_in->setOverflowCallback(LogQueueOverflow);
+    RequestMIDIInputPolicy(*port->midi_in);
+
+    try {
+        port->midi_in->openPort(*port_number);
+    } catch (RtMidiError& error) {
+        error.printMessage();
+        return nullptr;
+    }
+
+    port->midi_in->ignoreTypes(false, false, false);
+
+    RecordMIDIInputPolicy(*port->midi_in, midi_input);
+
+    return port;
+}
+
+void MIDI_Bridge_Pool::Start() {
+    for (auto& worker : m_workers) {
+        if (worker->ports.empty() || worker->thread.joinable()) {
+            continue;
+        }
+        worker->thread = std::jthread([this, p_worker = worker.get()](std::stop_token stop_token) { WorkerLoop(*p_worker, stop_token); });
+    }
+}
+
+std::vector<Bridge_Stats> MIDI_Bridge_Pool::GetStats() const {
+    std::vector<Bridge_Stats> stats(m_ports.size());
+    for (size_t i = 0; i < m_ports.size(); i++) {
+        stats[i].messages  = m_ports[i]->messages.load(std::memory_order_relaxed);
+        stats[i].bursts    = m_ports[i]->bursts.load(std::memory_order_relaxed);
+        stats[i].max_burst = m_ports[i]->max_burst.load(std::memory_order_relaxed);
+
+        if (m_ports[i]->sender) {
+            stats[i].sender = m_ports[i]->sender->GetStats();
+        }
+    }
+    return stats;
+}
+
+void MIDI_Bridge_Pool::NotifyReady(void* user_data) {
+    auto* port = static_cast<Bridge_Port*>(user_data);
+
+    // already flagged, the worker has not drained the port yet
+    if (port->ready.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    std::lock_guard lock(port->worker->mutex);
+    port->worker->pending = true;
+    port->worker->cv.notify_one();
+}
+
+void MIDI_Bridge_Pool::DrainPort(Bridge_Port& port, MIDI_Batch& batch) {
+    const size_t count = port.midi_in->getMessages(&batch.bytes, &batch.infos);
+
+    for (size_t i = 0; i < count; i++) {
+        port.output(batch.Message(i), batch.Timecode(i));
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    port.messages.fetch_add(count, std::memory_order_relaxed);
+    port.bursts.fetch_add(1, std::memory_order_relaxed);
+    if (count > port.max_burst.load(std::memory_order_relaxed)) {
+        port.max_burst.store(count, std::memory_order_relaxed);
+    }
+}
+
+void MIDI_Bridge_Pool::WorkerLoop(Bridge_Worker& worker, std::stop_token stop_token) {
+    ApplyThreadPolicy(Thread_Role::Send, "bridge worker");
+
+    // earliest pending batch of all ports of this worker, max while none is pending
+    constexpr auto NO_DEADLINE = std::chrono::steady_clock::time_point::max();
+
+    auto deadline = NO_DEADLINE;
+
+    while (!stop_token.stop_requested()) {
+        {
+            std::unique_lock lock(worker.mutex);
+            const auto       has_pending = [&worker] { return worker.pending; };
+
+            if (deadline != NO_DEADLINE) {
+                worker.cv.wait_until(lock, stop_token, deadline, has_pending);
+            } else {
+                worker.cv.wait(lock, stop_token, has_pending);
+            }
+            worker.pending = false;
+        }
+
+        bool again = false;
+        deadline   = NO_DEADLINE;
+
+        for (Bridge_Port* port : worker.ports) {
+            if (port->ready.exchange(false, std::memory_order_acq_rel)) {
+                DrainPort(*port, worker.batch);
+
+                // the input thread only notifies when the queue turns non-empty, a message that arrived
+                // while draining does not count as that, so it is picked up on the next round instead
+                if (port->midi_in->waitForMessage(0)) {
+                    port->ready.store(true, std::memory_order_release);
+                    again = true;
+                }
+
+                if (port->sender) {
+                    port->batch_deadline = port->sender->FlushExpired(std::chrono::steady_clock::now());
+                }
+            } else if (port->batch_deadline && *port->batch_deadline <= std::chrono::steady_clock::now()) {
+                port->batch_deadline = port->sender->FlushExpired(std::chrono::steady_clock::now());
+            }
+
+            if (port->batch_deadline && *port->batch_deadline < deadline) {
+                deadline = *port->batch_deadline;
+            }
+        }
+
+        // round robin, a port that keeps streaming can not starve the others
+        if (again) {
+            std::lock_guard lock(worker.mutex);
+            worker.pending = true;
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+
+struct Bridge_Stats {
+    uint64_t messages  = 0; // handed to NDI
+    uint64_t bursts    = 0; // worker wake ups that found messages on the port
+    size_t   max_burst = 0; // most messages taken in one of them
+
+    // of the NDI sender, see MIDI_Sender, empty for ports with an output of their own
+    Sender_Stats sender;
+};
+
+// transmits many MIDI inputs from one process: every input port gets its own NDI sender, while the
+// transport and a small fixed set of worker threads are shared by all of them
+// an input thread only flags its port when the RtMidi queue turns non-empty, the worker that owns the
+// port then drains the whole burst and sends it, so an idle port costs no CPU and a busy one a single
+// wake up per burst instead of a thread of its own
+class MIDI_Bridge_Pool {
+public:
+    // invoked on a worker thread for every message of a port added with one
+    using Output = std::function<void(std::span<uint8_t> data, int64_t timecode)>;
+
+    // batching applies to every sender, see MIDI_Sender::SetBatching
+    MIDI_Bridge_Pool(std::shared_ptr<MIDI_Transport> transport, size_t worker_count,
+                     std::chrono::microseconds batch_window, size_t batch_max_bytes);
+    ~MIDI_Bridge_Pool();
+
+    MIDI_Bridge_Pool(const MIDI_Bridge_Pool&)            = delete;
+    MIDI_Bridge_Pool& operator=(const MIDI_Bridge_Pool&) = delete;
+
+    // opens the MIDI input port of that name and publishes it as ndi_send_name, only before Start
+    [[nodiscard]]
+    bool AddPort(std::string_view midi_input, std::string_view ndi_send_name);
+
+    // opens the MIDI input port of that name and hands its messages to output instead, only before Start
+    [[nodiscard]]
+    bool AddPort(std::string_view midi_input, Output output);
+
+    void Start();
+
+    // in the order the ports were added
+    [[nodiscard]]
+    std::vector<Bridge_Stats> GetStats() const;
+
+private:
+    struct Bridge_Worker;
+
+    struct Bridge_Port {
+        std::unique_ptr<RtMidiIn>    midi_in;
+        Output                       output;
+        std::unique_ptr<MIDI_Sender> sender; // only for ports published directly, flushed by the worker
+        Bridge_Worker*               worker = nullptr;
+
+        // set by the input thread, cleared by the worker before it drains the queue
+        std::atomic<bool> ready = false;
+
+        // worker only
+        std::optional<std::chrono::steady_clock::time_point> batch_deadline;
+
+        std::atomic<uint64_t> messages  = 0;
+        std::atomic<uint64_t> bursts    = 0;
+        std::atomic<size_t>   max_burst = 0;
+    };
+
+    struct Bridge_Worker {
+        std::mutex                  mutex;
+        std::condition_variable_any cv;
+        bool                        pending = false; // a port of this worker became ready, guarded by mutex
+
+        std::vector<Bridge_Port*> ports;
+        MIDI_Batch                batch;
+        std::jthread              thread;
+    };
+
+    std::shared_ptr<MIDI_Transport> m_p_transport;
+    std::chrono::microseconds       m_batch_window;
+    size_t                          m_batch_max_bytes;
+
+    std::vector<std::unique_ptr<Bridge_Port>>   m_ports;
+    std::vector<std::unique_ptr<Bridge_Worker>> m_workers;
+
+    // nullptr if the port does not exist or can not be opened
+    [[nodiscard]]
+    std::unique_ptr<Bridge_Port> OpenPort(std::string_view midi_input);
+
+    // invoked on the RtMidi input thread, see RtMidiIn::setQueueNotifier
+    static void NotifyReady(void* user_data);
+
+    void DrainPort(Bridge_Port& port, MIDI_Batch& batch);
+    void WorkerLoop(Bridge_Worker& worker, std::stop_token stop_token);
+};
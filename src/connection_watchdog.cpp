@@ -0,0 +1,166 @@
+#include "connection_watchdog.hpp"
+
+// how often the connection counts are polled when no status change arrives
+constexpr auto WATCHDOG_POLL_INTERVAL = std::chrono::milliseconds(50);
+
+// a connection count of zero for this long is a lost link, shorter gaps are left to the transport to recover
+constexpr auto LINK_GRACE_PERIOD = std::chrono::milliseconds(500);
+
+// reconnect attempts start at the first and double up to the last
+constexpr auto RECONNECT_BACKOFF_MIN = std::chrono::milliseconds(250);
+constexpr auto RECONNECT_BACKOFF_MAX = std::chrono::milliseconds(8000);
+
+[[nodiscard]]
+static std::chrono::milliseconds ToMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+}
+
+MIDI_Connection_Watchdog::MIDI_Connection_Watchdog(MIDI_Source_Discovery& discovery, const std::vector<std::string>& names,
+                                                   const std::vector<std::unique_ptr<MIDI_Receiver>>& receivers)
+    : m_discovery(discovery) {
+    for (size_t i = 0; i < receivers.size(); i++) {
+        Link link;
+        link.name     = names[i];
+        link.receiver = receivers[i].get();
+        link.backoff  = RECONNECT_BACKOFF_MIN;
+        m_links.push_back(std::move(link));
+
+        // runs on the capture thread, so it only flags the change and leaves the rest to the watchdog thread
+        receivers[i]->SetStatusCallback([this] {
+            m_check_requested.store(true, std::memory_order_relaxed);
+            m_cv.notify_one();
+        });
+    }
+
+    // nothing to watch when only transmitting
+    if (m_links.empty()) {
+        return;
+    }
+
+    m_subscription = m_discovery.Subscribe([this](const Source_Snapshot& snapshot) { OnSourcesChanged(snapshot); });
+
+    m_thread = std::jthread([this](std::stop_token stop_token) { WatchLoop(stop_token); });
+}
+
+MIDI_Connection_Watchdog::~MIDI_Connection_Watchdog() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    m_thread.request_stop();
+    m_thread.join();
+
+    m_discovery.Unsubscribe(m_subscription);
+
+    for (auto& link : m_links) {
+        link.receiver->SetStatusCallback(nullptr);
+    }
+}
+
+std::vector<Link_Stats> MIDI_Connection_Watchdog::GetStats() const {
+    std::lock_guard lock(m_mutex);
+
+    std::vector<Link_Stats> all_stats;
+    all_stats.reserve(m_links.size());
+
+    for (const auto& link : m_links) {
+        all_stats.push_back(link.stats);
+    }
+    return all_stats;
+}
+
+void MIDI_Connection_Watchdog::Check(Link& link, std::chrono::steady_clock::time_point now) {
+    if (link.receiver->GetConnectionCount() > 0) {
+        if (link.down && link.established) {
+            const auto outage = ToMilliseconds(now - *link.zero_since);
+
+            link.stats.last_outage         = outage;
+            link.stats.max_outage          = std::max(link.stats.max_outage, outage);
+            link.stats.total_outage       += outage;
+            link.stats.last_reconnect_time = ToMilliseconds(now - link.source_back.value_or(*link.zero_since + LINK_GRACE_PERIOD));
+
+            std::println("NDI source {} is back after {} ms", link.name, outage.count());
+        }
+
+        link.established     = true;
+        link.down            = false;
+        link.stats.connected = true;
+        link.zero_since.reset();
+        link.source_back.reset();
+        link.backoff = RECONNECT_BACKOFF_MIN;
+        return;
+    }
+
+    link.stats.connected = false;
+
+    if (!link.zero_since) {
+        link.zero_since = now;
+    }
+
+    if (!link.down) {
+        if (now - *link.zero_since < LINK_GRACE_PERIOD) {
+            return;
+        }
+
+        link.down         = true;
+        link.next_attempt = now;
+
+        if (link.established) {
+            link.stats.outages++;
+            std::println("NDI source {} lost, reconnecting", link.name);
+        }
+    }
+
+    if (now < link.next_attempt) {
+        return;
+    }
+
+    // the URL may have changed with a restart, a source discovery does not know is tried by name
+    const auto* discovered = m_discovery.GetSnapshot()->Find(link.name);
+    const auto  source     = discovered ? discovered->ToSource() : MIDI_Source{link.name, ""};
+
+    link.receiver->Connect(&source);
+    link.stats.reconnect_attempts++;
+
+    link.next_attempt = now + link.backoff;
+    link.backoff      = std::min(link.backoff * 2, RECONNECT_BACKOFF_MAX);
+}
+
+void MIDI_Connection_Watchdog::OnSourcesChanged(const Source_Snapshot& snapshot) {
+    const auto now = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (const auto& source : snapshot.added) {
+            for (auto& link : m_links) {
+                if (link.name != source.name || !link.down) {
+                    continue;
+                }
+
+                // the sender is back, no reason to sit out the backoff
+                link.source_back  = now;
+                link.next_attempt = now;
+                link.backoff      = RECONNECT_BACKOFF_MIN;
+            }
+        }
+    }
+
+    m_check_requested.store(true, std::memory_order_relaxed);
+    m_cv.notify_one();
+}
+
+void MIDI_Connection_Watchdog::WatchLoop(std::stop_token stop_token) {
+    std::unique_lock lock(m_mutex);
+
+    while (!stop_token.stop_requested()) {
+        m_cv.wait_for(lock, stop_token, WATCHDOG_POLL_INTERVAL, [this] { return m_check_requested.load(std::memory_order_relaxed); });
+        m_check_requested.store(false, std::memory_order_relaxed);
+
+        const auto now = std::chrono::steady_clock::now();
+
+        for (auto& link : m_links) {
+            Check(link, now);
+        }
+    }
+}
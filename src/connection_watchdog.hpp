@@ -0,0 +1,73 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+#include "source_discovery.hpp"
+
+struct Link_Stats {
+    bool     connected          = false;
+    uint64_t outages            = 0;
+    uint64_t reconnect_attempts = 0;
+
+    std::chrono::milliseconds last_outage{0};
+    std::chrono::milliseconds max_outage{0};
+    std::chrono::milliseconds total_outage{0};
+
+    // of the last outage: from the source showing up in discovery again, or from the outage being noticed if
+    // discovery never lost it, until the link was back
+    std::chrono::milliseconds last_reconnect_time{0};
+};
+
+// notices when a receiver lost its source, e.g. because the sender restarted, and reconnects it with backoff
+// a link counts as down once its connection count stayed at zero for a short grace period, status change frames
+// make the watchdog look right away instead of at its next poll; a source discovery sees again is retried at once
+class MIDI_Connection_Watchdog {
+public:
+    // watches receivers[i], connected to the source names[i]
+    // the discovery and the receivers have to outlive the watchdog, which has to be created before receiving starts
+    // and destroyed after it stopped
+    MIDI_Connection_Watchdog(MIDI_Source_Discovery& discovery, const std::vector<std::string>& names,
+                             const std::vector<std::unique_ptr<MIDI_Receiver>>& receivers);
+    ~MIDI_Connection_Watchdog();
+
+    MIDI_Connection_Watchdog(const MIDI_Connection_Watchdog&)            = delete;
+    MIDI_Connection_Watchdog& operator=(const MIDI_Connection_Watchdog&) = delete;
+
+    // in the order of the receivers
+    [[nodiscard]]
+    std::vector<Link_Stats> GetStats() const;
+
+private:
+    struct Link {
+        std::string    name;
+        MIDI_Receiver* receiver = nullptr;
+
+        bool established = false; // was up at least once, a source that never connected has no outage to report
+        bool down        = false;
+
+        std::optional<std::chrono::steady_clock::time_point> zero_since;  // connection count is zero since
+        std::optional<std::chrono::steady_clock::time_point> source_back; // discovery saw the source again during the outage
+        std::chrono::steady_clock::time_point                next_attempt;
+        std::chrono::milliseconds                            backoff{0};
+
+        Link_Stats stats;
+    };
+
+    MIDI_Source_Discovery& m_discovery;
+    size_t                 m_subscription = 0;
+
+    mutable std::mutex          m_mutex;
+    std::condition_variable_any m_cv;
+    std::atomic<bool>           m_check_requested = false;
+    std::vector<Link>           m_links;
+
+    std::jthread m_thread;
+
+    // called with m_mutex held
+    void Check(Link& link, std::chrono::steady_clock::time_point now);
+
+    // on the discovery thread
+    void OnSourcesChanged(const Source_Snapshot& snapshot);
+
+    void WatchLoop(std::stop_token stop_token);
+};
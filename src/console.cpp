@@ -0,0 +1,43 @@
+#include "console.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace {
+
+// set once stdin reached its end, it then stays readable and would read as a key press forever
+std::atomic<bool> stdin_closed = false;
+
+} // namespace
+#endif
+
+bool KeyPressed() {
+#ifdef _WIN32
+    return _kbhit() != 0;
+#elif defined(__linux__)
+    if (stdin_closed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    pollfd fd{STDIN_FILENO, POLLIN, 0};
+
+    if (poll(&fd, 1, 0) <= 0) {
+        return false;
+    }
+
+    char buffer[256];
+
+    const auto length = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+    if (length <= 0) {
+        stdin_closed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
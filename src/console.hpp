@@ -0,0 +1,8 @@
+#pragma once
+
+#include "pch.hpp"
+
+// true once a line was entered on the console, for the "press enter to exit" loops
+// without a console, e.g. stdin is /dev/null under a service manager, this stays false and only a signal ends the loop
+[[nodiscard]]
+bool KeyPressed();
@@ -0,0 +1,57 @@
+#include "echo_filter.hpp"
+
+// FNV-1a, messages are short and this runs once per message on each side
+[[nodiscard]]
+static uint64_t HashMessage(std::span<const uint8_t> data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const uint8_t byte : data) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+[[nodiscard]]
+static uint32_t MillisecondClock(std::chrono::steady_clock::time_point time) {
+    // wraps after 49 days, the unsigned difference in IsEcho stays correct across the wrap
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count());
+}
+
+MIDI_Echo_Filter::MIDI_Echo_Filter(std::chrono::milliseconds window)
+    : m_window_ms(static_cast<uint32_t>(window.count())) {}
+
+void MIDI_Echo_Filter::Record(std::span<const uint8_t> data, std::chrono::steady_clock::time_point now) {
+    if (m_window_ms == 0 || data.empty()) {
+        return;
+    }
+
+    const uint64_t hash = HashMessage(data);
+    // the tag is never 0, so a stored entry never looks empty
+    const uint64_t tag = (hash >> 32) | 1;
+
+    m_entries[hash & (TABLE_SIZE - 1)].store((tag << 32) | MillisecondClock(now), std::memory_order_relaxed);
+}
+
+bool MIDI_Echo_Filter::IsEcho(std::span<const uint8_t> data, std::chrono::steady_clock::time_point now) {
+    if (m_window_ms == 0 || data.empty()) {
+        return false;
+    }
+
+    const uint64_t hash = HashMessage(data);
+    const uint64_t tag  = (hash >> 32) | 1;
+
+    auto&    entry = m_entries[hash & (TABLE_SIZE - 1)];
+    uint64_t value = entry.load(std::memory_order_relaxed);
+
+    if ((value >> 32) != tag || MillisecondClock(now) - static_cast<uint32_t>(value) > m_window_ms) {
+        return false;
+    }
+
+    // only one echo per recorded message, a second identical input is genuine
+    if (!entry.compare_exchange_strong(value, 0, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
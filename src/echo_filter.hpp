@@ -0,0 +1,37 @@
+#pragma once
+
+#include "pch.hpp"
+
+// loop suppression for duplex mode: remembers the messages written to the MIDI output for a short window,
+// a message that comes back on the MIDI input within that window is taken as an echo (a controller
+// reflecting its feedback, a MIDI thru) and not sent again, so traffic cannot ping-pong between two bridges
+// lock-free and allocation free: a fixed table indexed by a hash of the message, where colliding messages
+// overwrite each other, which at worst lets a rare echo through
+class MIDI_Echo_Filter {
+public:
+    explicit MIDI_Echo_Filter(std::chrono::milliseconds window);
+
+    MIDI_Echo_Filter(const MIDI_Echo_Filter&)            = delete;
+    MIDI_Echo_Filter& operator=(const MIDI_Echo_Filter&) = delete;
+
+    // output side, any thread
+    void Record(std::span<const uint8_t> data, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // input side: true if data echoes a recorded message, which is then forgotten so a repeat gets through
+    [[nodiscard]]
+    bool IsEcho(std::span<const uint8_t> data, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    [[nodiscard]]
+    uint64_t GetSuppressed() const {
+        return m_suppressed.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t TABLE_SIZE = 4096;
+
+    // upper 32 bits: tag from the message hash, lower 32 bits: record time in milliseconds, 0 is an empty slot
+    std::array<std::atomic<uint64_t>, TABLE_SIZE> m_entries{};
+
+    uint32_t              m_window_ms;
+    std::atomic<uint64_t> m_suppressed = 0;
+};
@@ -0,0 +1,207 @@
+#include "event_reactor.hpp"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+// events taken from the kernel per epoll_wait
+constexpr int REACTOR_MAX_EVENTS = 64;
+
+Event_Reactor::Event_Reactor() {
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    m_wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_epoll_fd < 0 || m_wake_fd < 0) {
+        std::println("cannot create event loop: {}", std::strerror(errno));
+        return;
+    }
+
+    epoll_event event{};
+    event.events  = EPOLLIN;
+    event.data.fd = m_wake_fd;
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &event);
+}
+
+Event_Reactor::~Event_Reactor() {
+    if (m_signal_fd >= 0) {
+        close(m_signal_fd);
+    }
+    if (m_wake_fd >= 0) {
+        close(m_wake_fd);
+    }
+    if (m_epoll_fd >= 0) {
+        close(m_epoll_fd);
+    }
+}
+
+bool Event_Reactor::Add(int fd, Handler handler) {
+    if (!IsValid() || fd < 0) {
+        return false;
+    }
+
+    epoll_event event{};
+    event.events  = EPOLLIN;
+    event.data.fd = fd;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        std::println("cannot watch descriptor {}: {}", fd, std::strerror(errno));
+        return false;
+    }
+
+    m_handlers[fd] = std::move(handler);
+    return true;
+}
+
+void Event_Reactor::Remove(int fd) {
+    if (!m_handlers.contains(fd) || IsRemoved(fd)) {
+        return;
+    }
+
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+
+    // the handler may be the one running
+    if (m_dispatching) {
+        m_removed.push_back(fd);
+        return;
+    }
+    m_handlers.erase(fd);
+}
+
+bool Event_Reactor::IsRemoved(int fd) const {
+    return std::find(m_removed.begin(), m_removed.end(), fd) != m_removed.end();
+}
+
+bool Event_Reactor::AddSignals(std::initializer_list<int> signals, std::function<void(int signal)> handler) {
+    if (!IsValid() || m_signal_fd >= 0) {
+        return false;
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (const int signal : signals) {
+        sigaddset(&mask, signal);
+    }
+
+    // a signalfd only sees signals that are blocked, otherwise the default action still runs
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        return false;
+    }
+
+    m_signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (m_signal_fd < 0) {
+        std::println("cannot create signalfd: {}", std::strerror(errno));
+        return false;
+    }
+
+    m_signal_handler = std::move(handler);
+
+    return Add(m_signal_fd, [this] { HandleSignals(); });
+}
+
+void Event_Reactor::Wake() {
+    const uint64_t one = 1;
+    const auto     res = write(m_wake_fd, &one, sizeof(one));
+    (void)res;
+}
+
+void Event_Reactor::Stop() {
+    m_stop = true;
+    Wake();
+}
+
+void Event_Reactor::Run(const Tick& tick) {
+    if (!IsValid()) {
+        return;
+    }
+
+    std::array<epoll_event, REACTOR_MAX_EVENTS> events;
+
+    while (!m_stop) {
+        int timeout_ms = -1;
+
+        if (tick) {
+            const auto now = std::chrono::steady_clock::now();
+
+            if (const auto next = tick(now)) {
+                // round up, waking early only to find nothing due would spin
+                const auto wait = std::chrono::ceil<std::chrono::milliseconds>(*next - now);
+                timeout_ms      = static_cast<int>(std::max<int64_t>(wait.count(), 0));
+            }
+        }
+
+        const int n_events = epoll_wait(m_epoll_fd, events.data(), static_cast<int>(events.size()), timeout_ms);
+
+        if (n_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::println("epoll_wait failed: {}", std::strerror(errno));
+            return;
+        }
+
+        const auto dispatch_start = std::chrono::steady_clock::now();
+
+        m_dispatching = true;
+
+        for (int i = 0; i < n_events; i++) {
+            const int fd = events[i].data.fd;
+
+            if (fd == m_wake_fd) {
+                HandleWake();
+                continue;
+            }
+
+            // an earlier handler of this wake up may have removed it
+            auto it = m_handlers.find(fd);
+            if (it != m_handlers.end() && !IsRemoved(fd)) {
+                it->second();
+            }
+        }
+
+        m_dispatching = false;
+
+        for (const int fd : m_removed) {
+            m_handlers.erase(fd);
+        }
+        m_removed.clear();
+
+        const auto dispatch_time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - dispatch_start);
+
+        std::lock_guard lock(m_stats_mutex);
+        m_stats.wakeups++;
+        m_stats.events += static_cast<uint64_t>(n_events);
+        m_stats.max_dispatch_time = std::max(m_stats.max_dispatch_time, dispatch_time);
+    }
+}
+
+Reactor_Stats Event_Reactor::GetStats() const {
+    std::lock_guard lock(m_stats_mutex);
+    return m_stats;
+}
+
+void Event_Reactor::HandleWake() {
+    uint64_t count = 0;
+    const auto res = read(m_wake_fd, &count, sizeof(count));
+    (void)res;
+
+    if (m_wake_handler) {
+        m_wake_handler();
+    }
+}
+
+void Event_Reactor::HandleSignals() {
+    signalfd_siginfo info;
+
+    while (read(m_signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        if (m_signal_handler) {
+            m_signal_handler(static_cast<int>(info.ssi_signo));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pch.hpp"
+
+#ifdef __linux__
+
+struct Reactor_Stats {
+    uint64_t wakeups = 0; // returns from epoll_wait
+    uint64_t events  = 0; // handlers run
+
+    // longest time spent handling the events of one wake up
+    std::chrono::microseconds max_dispatch_time{0};
+};
+
+// single threaded event loop on epoll: MIDI input descriptors, transport readiness descriptors, a wake
+// eventfd and a signalfd all wait in one epoll_wait, and their handlers run on the thread that calls Run,
+// so a bridge needs no thread of its own per input and no locks between its stages
+// descriptors are level triggered, a handler does not have to drain everything in one call
+class Event_Reactor {
+public:
+    using Handler = std::function<void()>;
+
+    // asked before every wait with the current time, returns when the loop has to run it next
+    using Tick = std::function<std::optional<std::chrono::steady_clock::time_point>(std::chrono::steady_clock::time_point now)>;
+
+    Event_Reactor();
+    ~Event_Reactor();
+
+    Event_Reactor(const Event_Reactor&)            = delete;
+    Event_Reactor& operator=(const Event_Reactor&) = delete;
+
+    // false if the epoll or eventfd descriptors could not be created
+    [[nodiscard]]
+    bool IsValid() const {
+        return m_epoll_fd >= 0 && m_wake_fd >= 0;
+    }
+
+    // handler runs on the loop thread whenever fd is readable, only from the loop thread or before Run
+    [[nodiscard]]
+    bool Add(int fd, Handler handler);
+
+    // also from a handler, its own included: fd is not watched anymore once this returns, the handler is destroyed
+    // after the current wake up
+    void Remove(int fd);
+
+    // blocks the signals for the calling thread (and threads it starts later) and delivers them to handler instead
+    [[nodiscard]]
+    bool AddSignals(std::initializer_list<int> signals, std::function<void(int signal)> handler);
+
+    // any thread: runs the wake handler on the loop thread, wakes coalesce while one is pending
+    void Wake();
+
+    void SetWakeHandler(Handler handler) {
+        m_wake_handler = std::move(handler);
+    }
+
+    // any thread: Run returns after the current wake up
+    void Stop();
+
+    void Run(const Tick& tick = {});
+
+    [[nodiscard]]
+    Reactor_Stats GetStats() const;
+
+private:
+    int m_epoll_fd  = -1;
+    int m_wake_fd   = -1;
+    int m_signal_fd = -1;
+
+    std::unordered_map<int, Handler> m_handlers;
+
+    // removed while handlers run, erased once they are done
+    bool             m_dispatching = false;
+    std::vector<int> m_removed;
+
+    Handler                         m_wake_handler;
+    std::function<void(int signal)> m_signal_handler;
+
+    std::atomic<bool> m_stop = false;
+
+    mutable std::mutex m_stats_mutex;
+    Reactor_Stats      m_stats;
+
+    [[nodiscard]]
+    bool IsRemoved(int fd) const;
+
+    void HandleWake();
+    void HandleSignals();
+};
+
+#endif
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HEXCODEC_SSE2
+#endif
+
+// uppercase hex digits for every byte value, so encoding is one table load per byte
+inline constexpr auto HEX_ENCODE_TABLE = [] {
+    constexpr char                       digits[] = "0123456789ABCDEF";
+    std::array<std::array<char, 2>, 256> table{};
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i][0] = digits[i >> 4];
+        table[i][1] = digits[i & 0x0F];
+    }
+    return table;
+}();
+
+[[nodiscard]]
+constexpr size_t EncodedHexSize(size_t byte_count) {
+    return byte_count * 2;
+}
+
+// writes EncodedHexSize(data.size()) characters to out, no terminator
+inline size_t EncodeHex(std::span<const uint8_t> data, char* out) {
+    const uint8_t* src = data.data();
+    size_t         n   = data.size();
+    char*          dst = out;
+
+#ifdef HEXCODEC_SSE2
+    // 16 bytes -> 32 characters per iteration: split into nibbles and map 0-9/10-15 to '0'/'A' arithmetically
+    const __m128i mask_0f = _mm_set1_epi8(0x0F);
+    const __m128i nine    = _mm_set1_epi8(9);
+    const __m128i ascii_0 = _mm_set1_epi8('0');
+    const __m128i alpha   = _mm_set1_epi8('A' - '0' - 10);
+
+    const auto to_ascii = [&](__m128i nibbles) {
+        const __m128i is_alpha = _mm_cmpgt_epi8(nibbles, nine);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, ascii_0), _mm_and_si128(is_alpha, alpha));
+    };
+
+    while (n >= 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hi = to_ascii(_mm_and_si128(_mm_srli_epi16(in, 4), mask_0f));
+        const __m128i lo = to_ascii(_mm_and_si128(in, mask_0f));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(hi, lo));
+
+        src += 16;
+        dst += 32;
+        n -= 16;
+    }
+#endif
+
+    for (size_t i = 0; i < n; i++) {
+        const auto& digits = HEX_ENCODE_TABLE[src[i]];
+        dst[0]             = digits[0];
+        dst[1]             = digits[1];
+        dst += 2;
+    }
+
+    return static_cast<size_t>(dst - out);
+}
+
+// nibble value for every hex digit (either case), 0xFF for anything else
+inline constexpr auto HEX_DECODE_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    table.fill(0xFF);
+    for (uint8_t i = 0; i < 10; i++) {
+        table['0' + i] = i;
+    }
+    for (uint8_t i = 0; i < 6; i++) {
+        table['A' + i] = 10 + i;
+        table['a' + i] = 10 + i;
+    }
+    return table;
+}();
+
+// decodes hex.size() / 2 bytes to out, returns false on odd length or a non hex character
+// out may have been partially written when false is returned
+inline bool DecodeHex(std::string_view hex, uint8_t* out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+
+    const char* src = hex.data();
+    size_t      n   = hex.size() / 2;
+    uint8_t*    dst = out;
+
+#ifdef HEXCODEC_SSE2
+    // 32 characters -> 16 bytes per iteration, all characters are validated before anything is combined
+    const __m128i ascii_0   = _mm_set1_epi8('0');
+    const __m128i ascii_a   = _mm_set1_epi8('a');
+    const __m128i lowercase = _mm_set1_epi8(0x20);
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    const __m128i ten       = _mm_set1_epi8(10);
+    const __m128i six       = _mm_set1_epi8(6);
+    const __m128i low_byte  = _mm_set1_epi16(0x00FF);
+
+    // returns the nibble values, valid_mask gets 0xFF for every byte that was a hex digit
+    const auto to_nibbles = [&](__m128i chars, __m128i& valid_mask) {
+        const __m128i digit    = _mm_sub_epi8(chars, ascii_0);
+        const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(digit, minus_one), _mm_cmplt_epi8(digit, ten));
+        const __m128i alpha    = _mm_sub_epi8(_mm_or_si128(chars, lowercase), ascii_a);
+        const __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(alpha, minus_one), _mm_cmplt_epi8(alpha, six));
+
+        valid_mask = _mm_or_si128(is_digit, is_alpha);
+        return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_alpha, _mm_add_epi8(alpha, ten)));
+    };
+
+    // two characters per 16 bit lane: high nibble in the low byte, low nibble in the high byte
+    const auto combine = [&](__m128i nibbles) {
+        const __m128i hi = _mm_slli_epi16(_mm_and_si128(nibbles, low_byte), 4);
+        const __m128i lo = _mm_srli_epi16(nibbles, 8);
+        return _mm_or_si128(hi, lo);
+    };
+
+    while (n >= 16) {
+        __m128i valid_a, valid_b;
+
+        const __m128i a = to_nibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), valid_a);
+        const __m128i b = to_nibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), valid_b);
+
+        if (_mm_movemask_epi8(_mm_and_si128(valid_a, valid_b)) != 0xFFFF) {
+            return false;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(combine(a), combine(b)));
+
+        src += 32;
+        dst += 16;
+        n -= 16;
+    }
+#endif
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t hi = HEX_DECODE_TABLE[static_cast<uint8_t>(src[0])];
+        const uint8_t lo = HEX_DECODE_TABLE[static_cast<uint8_t>(src[1])];
+
+        if ((hi | lo) & 0xF0) {
+            return false;
+        }
+
+        *dst++ = static_cast<uint8_t>((hi << 4) | lo);
+        src += 2;
+    }
+
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "logging.hpp"
+
+// records the ring holds, a power of two
+constexpr size_t LOG_RING_SIZE = 4096;
+
+// how often the log thread looks for records, producers never wake it so logging costs them no system call
+constexpr auto LOG_DRAIN_INTERVAL = std::chrono::milliseconds(10);
+
+namespace {
+
+// bounded multi producer ring after Vyukov: every slot carries a sequence number that tells producers and the
+// consumer whose turn it is, so producers only contend on one compare exchange of the head
+class Log_Ring {
+public:
+    Log_Ring() {
+        for (size_t i = 0; i < LOG_RING_SIZE; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_thread = std::jthread([this](std::stop_token stop_token) { LogLoop(stop_token); });
+    }
+
+    ~Log_Ring() {
+        m_thread.request_stop();
+        m_thread.join();
+        Drain();
+    }
+
+    Log_Ring(const Log_Ring&)            = delete;
+    Log_Ring& operator=(const Log_Ring&) = delete;
+
+    void Push(const Log_Record& record) {
+        size_t position = m_head.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot&          slot     = m_slots[position & (LOG_RING_SIZE - 1)];
+            const size_t   sequence = slot.sequence.load(std::memory_order_acquire);
+            const intptr_t diff     = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.record = record;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return;
+                }
+            } else if (diff < 0) {
+                // full, the consumer has not freed this slot yet
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // single consumer, the log thread or FlushLog
+    void Drain() {
+        std::lock_guard lock(m_drain_mutex);
+
+        for (;;) {
+            Slot& slot = m_slots[m_tail & (LOG_RING_SIZE - 1)];
+
+            if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+                break;
+            }
+
+            const Log_Record record = slot.record;
+            slot.sequence.store(m_tail + LOG_RING_SIZE, std::memory_order_release);
+            m_tail++;
+
+            Print(record);
+        }
+
+        const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reported_dropped) {
+            std::println("{} log records dropped, the log ring was full", dropped - m_reported_dropped);
+            m_reported_dropped = dropped;
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence = 0;
+        Log_Record          record;
+    };
+
+    std::array<Slot, LOG_RING_SIZE> m_slots;
+
+    alignas(64) std::atomic<size_t>   m_head    = 0;
+    alignas(64) std::atomic<uint64_t> m_dropped = 0;
+
+    // consumer only, guarded by m_drain_mutex
+    std::mutex  m_drain_mutex;
+    size_t      m_tail             = 0;
+    uint64_t    m_reported_dropped = 0;
+    std::string m_text;
+
+    std::mutex                  m_wait_mutex;
+    std::condition_variable_any m_wait_cv;
+    std::jthread                m_thread;
+
+    void LogLoop(std::stop_token stop_token) {
+        while (!stop_token.stop_requested()) {
+            {
+                std::unique_lock lock(m_wait_mutex);
+                m_wait_cv.wait_for(lock, stop_token, LOG_DRAIN_INTERVAL, [] { return false; });
+            }
+            Drain();
+        }
+    }
+
+    void Print(const Log_Record& record) {
+        switch (record.event) {
+        case Log_Event::VirtualPortRX: {
+            // colon separated hex like 90:3c:7f, built in a buffer that keeps its capacity
+            m_text.clear();
+            for (size_t i = 0; i < record.size; i++) {
+                if (i > 0) {
+                    m_text += ':';
+                }
+                std::format_to(std::back_inserter(m_text), "{:02x}", record.bytes[i]);
+            }
+            if (static_cast<size_t>(record.value) > record.size) {
+                std::format_to(std::back_inserter(m_text), ":... ({} bytes)", record.value);
+            }
+            std::println("command: {}", m_text);
+            break;
+        }
+        case Log_Event::VirtualPortShutdown:
+            std::println("empty command - driver was probably shut down!");
+            break;
+        case Log_Event::VirtualPortError:
+            std::println("error sending data: {}", record.value);
+            break;
+        case Log_Event::QueueOverflow:
+            std::println("MIDI input queue full, {} messages dropped so far", record.value);
+            break;
+        }
+    }
+};
+
+Log_Ring& GetLogRing() {
+    // created by SetLogLevel, so a process that turned logging off never starts the thread
+    static Log_Ring ring;
+    return ring;
+}
+
+} // namespace
+
+std::optional<Log_Level> ParseLogLevel(std::string_view name) {
+    if (name == "debug") {
+        return Log_Level::Debug;
+    }
+    if (name == "info") {
+        return Log_Level::Info;
+    }
+    if (name == "warning") {
+        return Log_Level::Warning;
+    }
+    if (name == "error") {
+        return Log_Level::Error;
+    }
+    if (name == "off") {
+        return Log_Level::Off;
+    }
+    return std::nullopt;
+}
+
+void SetLogLevel(Log_Level level) {
+    log_level.store(level, std::memory_order_relaxed);
+
+    if (level != Log_Level::Off) {
+        GetLogRing();
+    }
+}
+
+void PushLogRecord(Log_Level level, Log_Event event, std::span<const uint8_t> bytes, int64_t value) {
+    Log_Record record;
+    record.value = value;
+    record.event = event;
+    record.level = level;
+    record.size  = static_cast<uint8_t>(std::min(bytes.size(), LOG_INLINE_BYTES));
+    std::copy_n(bytes.begin(), record.size, record.bytes.begin());
+
+    GetLogRing().Push(record);
+}
+
+void FlushLog() {
+    GetLogRing().Drain();
+}
+
+void LogQueueOverflow(unsigned long dropped, void*) {
+    Log(Log_Level::Warning, Log_Event::QueueOverflow, {}, static_cast<int64_t>(dropped));
+}
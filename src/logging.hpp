@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pch.hpp"
+
+enum class Log_Level : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off,
+};
+
+// "debug", "info", "warning", "error" or "off"
+[[nodiscard]]
+std::optional<Log_Level> ParseLogLevel(std::string_view name);
+
+// what a record reports, the text for it is only put together on the log thread
+enum class Log_Event : uint8_t {
+    VirtualPortRX,       // bytes: the start of the message, value: its length
+    VirtualPortShutdown, // the driver handed over an empty command
+    VirtualPortError,    // value: GetLastError of a failed send, the RtMidiError type outside Windows
+    QueueOverflow,       // value: messages the RtMidi input queue dropped so far
+};
+
+// bytes of a message kept in a record, longer ones (SysEx) are cut
+constexpr size_t LOG_INLINE_BYTES = 24;
+
+struct Log_Record {
+    int64_t                               value = 0;
+    Log_Event                             event = Log_Event::VirtualPortRX;
+    Log_Level                             level = Log_Level::Info;
+    uint8_t                               size  = 0; // used bytes
+    std::array<uint8_t, LOG_INLINE_BYTES> bytes{};
+};
+
+// records below this level are discarded right at the call, can be changed at any time from any thread
+inline std::atomic<Log_Level> log_level = Log_Level::Info;
+
+// also creates the ring and starts the log thread unless level is Off, call it before the threads that log start
+void SetLogLevel(Log_Level level);
+
+[[nodiscard]]
+inline bool IsLogEnabled(Log_Level level) {
+    return level >= log_level.load(std::memory_order_relaxed) && level != Log_Level::Off;
+}
+
+// copies a binary record into a lock-free ring and returns, the log thread formats and prints it later
+// safe on any thread including driver callbacks once SetLogLevel created the ring: it never allocates, formats or
+// blocks, a full ring drops the record and the log thread reports how many were lost; without SetLogLevel the first
+// record creates the ring, on whatever thread pushes it
+void PushLogRecord(Log_Level level, Log_Event event, std::span<const uint8_t> bytes, int64_t value);
+
+inline void Log(Log_Level level, Log_Event event, std::span<const uint8_t> bytes = {}, int64_t value = 0) {
+    if (!IsLogEnabled(level)) {
+        return;
+    }
+    PushLogRecord(level, event, bytes, value);
+}
+
+// prints every record pushed so far, e.g. before the process exits
+void FlushLog();
+
+// for RtMidiIn::setOverflowCallback, logs on the input thread without touching std::cerr
+void LogQueueOverflow(unsigned long dropped, void* user_data);
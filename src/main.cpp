@@ -1,8 +1,56 @@
 #include "pch.hpp"
+#include "bridge_pool.hpp"
+#include "connection_watchdog.hpp"
+#include "console.hpp"
+#include "echo_filter.hpp"
+#include "event_reactor.hpp"
+#include "logging.hpp"
 #include "ndimidi.hpp"
+#include "playout.hpp"
+#include "receive_pipeline.hpp"
+#include "routing.hpp"
+#include "send_stage.hpp"
+#include "source_cache.hpp"
+#include "startup_timing.hpp"
+#include "thread_util.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+std::atomic<bool> end_loop = false;
+
+// forwards MIDI input to the NDI send stage until enter is pressed or SIGINT is received
+// sleeps on the RtMidi queue while idle and drains every burst of messages in one call
+// with an echo filter, input that only reflects what was just received from NDI is not sent back
+void forwardMIDI(MIDI_IO_MANAGER& midi_io_manager, MIDI_Send_Stage& send_stage, MIDI_Echo_Filter* p_echo_filter = nullptr) {
+    MIDI_Batch batch;
+    batch.bytes.reserve(MAX_SYSEX_BUFFER);
 
-void receiveInteractive() {
-    NDI_MIDI_Manager ndi_midi_manager;
+    while (!end_loop) {
+        if (KeyPressed()) {
+            end_loop = true;
+            break;
+        }
+
+        // the timeout only bounds how late a key press is noticed
+        if (!midi_io_manager.WaitForMIDI(std::chrono::milliseconds(50))) {
+            continue;
+        }
+
+        midi_io_manager.ReceiveMIDI(batch);
+
+        for (size_t i = 0; i < batch.Count(); i++) {
+            if (p_echo_filter && p_echo_filter->IsEcho(batch.Message(i))) {
+                continue;
+            }
+            send_stage.Push(batch.Message(i), batch.Timecode(i));
+        }
+    }
+}
+
+void receiveInteractive(const std::shared_ptr<MIDI_Transport>& transport) {
+    NDI_MIDI_Manager ndi_midi_manager(transport);
     MIDI_IO_MANAGER  midi_io_manager(L"NDI MIDI");
 
     ndi_midi_manager.UpdateSources();
@@ -12,7 +60,7 @@ void receiveInteractive() {
     std::println("Which NDI source would you like to use?");
 
     for (size_t i = 0; i < sources.size(); i++) {
-        std::println("{}: {}", i, sources[i].p_ndi_name);
+        std::println("{}: {}", i, sources[i].name);
     }
 
     std::string input;
@@ -26,38 +74,38 @@ void receiveInteractive() {
         return;
     }
 
-    std::println("Connecting to source {}: {}", source_index, sources[source_index].p_ndi_name);
+    std::println("Connecting to source {}: {}", source_index, sources[source_index].name);
 
     ndi_midi_manager.ConnectToSource(&sources[source_index]);
 
+    if (!midi_io_manager.OpenVirtualPort()) {
+        std::println("Error creating the virtual MIDI port. Exiting...");
+        return;
+    }
+
     std::println("Starting reception, press enter to exit...");
 
     bool end = false;
 
+    MIDI_Frame frame;
+    frame.bytes.reserve(MAX_SYSEX_BUFFER);
+
     while (!end) {
-        if (_kbhit()) {
+        if (KeyPressed()) {
             end = true;
         }
-        auto data_string = ndi_midi_manager.ReceiveMIDI(100);
 
-        if (!data_string.has_value()) {
+        if (ndi_midi_manager.ReceiveMIDI(100, frame) != MIDI_Parse_Status::Ok) {
             continue;
         }
 
-        if (data_string.value().empty()) {
-            continue;
-        }
-        auto data = ndi_midi_manager.ParseMIDIMessage(data_string.value());
-
-        if (data.empty()) {
-            continue;
+        for (size_t i = 0; i < frame.Count(); i++) {
+            midi_io_manager.SendMIDI(frame.Message(i));
         }
-
-        midi_io_manager.SendMIDI(data);
     }
 }
 
-void transmitInteractive() {
+void transmitInteractive(const std::shared_ptr<MIDI_Transport>& transport) {
     MIDI_IO_MANAGER midi_io_manager(L"NDI MIDI");
 
     midi_io_manager.UpdateMIDIPorts();
@@ -81,6 +129,8 @@ void transmitInteractive() {
     }
     std::println("Opening MIDI Port {}", port_index);
 
+    NDI_MIDI_Manager ndi_midi_manager(transport);
+
     bool succ = midi_io_manager.OpenMIDIPort((uint32_t)port_index);
 
     if (!succ) {
@@ -88,54 +138,82 @@ void transmitInteractive() {
         return;
     }
 
-    NDI_MIDI_Manager ndi_midi_manager;
-
     std::println("Starting transmission, press enter to exit...");
 
-    bool end = false;
-
-    while (!end) {
-        if (_kbhit()) {
-            end = true;
-        }
+    MIDI_Send_Stage send_stage(ndi_midi_manager, DEFAULT_SEND_QUEUE_SIZE, Overflow_Policy::Block);
 
-        auto data = midi_io_manager.ReceiveMIDI();
+    forwardMIDI(midi_io_manager, send_stage);
 
-        if (data.size() > 0) {
-            ndi_midi_manager.SendMIDI(data);
-        }
-    }
+    midi_io_manager.CloseMIDIPort();
 
     std::println("Exiting...");
 }
 
-bool end_loop = false;
+// how long it took from the start of the process until the first received MIDI frame went out
+void printFirstFrame(std::chrono::steady_clock::time_point first_frame, const MIDI_Source_Connector& source_connector, size_t sources) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(first_frame - GetProcessStartTime());
+    std::println("first MIDI frame {} ms after start ({} of {} sources connected from the cache)", elapsed.count(),
+                 source_connector.GetCachedCount(), sources);
+}
 
-bool receive(const std::string_view& ndi_source, const std::string_view& midi_output_name) {
-    NDI_MIDI_Manager ndi_midi_manager;
+void printReceiveStats(const std::vector<std::string>& ndi_sources, const std::vector<Receive_Stats>& receive_stats, double seconds) {
+    for (size_t i = 0; i < receive_stats.size(); i++) {
+        const auto& stats = receive_stats[i];
+        std::println("{}: {} frames, {} messages ({:.1f}/s, {:.0f} B/s), {} invalid, {} dropped by the transport",
+                     ndi_sources[i], stats.frames, stats.messages, stats.messages / seconds, stats.bytes / seconds,
+                     stats.invalid_frames, stats.dropped_frames);
+        std::println("{}: queue depth {} (max {}), {} capture stalls ({} us total, max {} us), slowest output {} us",
+                     ndi_sources[i], stats.depth, stats.max_depth, stats.capture_stalls,
+                     stats.capture_stall_time.count(), stats.max_capture_stall.count(), stats.max_output_time.count());
+    }
+}
 
-    ndi_midi_manager.UpdateSources();
+void printLinkStats(const std::vector<std::string>& ndi_sources, const std::vector<Link_Stats>& link_stats) {
+    for (size_t i = 0; i < link_stats.size(); i++) {
+        const auto& stats = link_stats[i];
+        if (stats.outages == 0 && stats.connected) {
+            continue;
+        }
+        std::println("{}: {}, {} outages (last {} ms, max {} ms, total {} ms), {} reconnect attempts, last reconnect {} ms after the source was back",
+                     ndi_sources[i], stats.connected ? "connected" : "disconnected", stats.outages, stats.last_outage.count(),
+                     stats.max_outage.count(), stats.total_outage.count(), stats.reconnect_attempts, stats.last_reconnect_time.count());
+    }
+}
 
-    const auto sources = ndi_midi_manager.GetSources();
+void printSendStats(const Send_Stats& stats) {
+    std::println("send queue: {} messages, high water {} of {}, blocked {} times ({} us), {} dropped, {} coalesced",
+                 stats.messages, stats.high_water, stats.capacity, stats.blocked, stats.blocked_time.count(), stats.dropped, stats.coalesced);
+}
 
-    int64_t source_index = -1;
+void printSenderStats(const Sender_Stats& stats) {
+    std::println("NDI sender: {} receivers, {} messages skipped while nobody listened, {} state resyncs",
+                 stats.connections, stats.skipped, stats.resyncs);
+}
 
-    for (size_t i = 0; i < sources.size(); i++) {
-        if (sources[i].p_ndi_name == ndi_source) {
-            source_index = i;
-            break;
-        }
-    }
+bool receive(const std::shared_ptr<MIDI_Transport>& transport, const std::vector<std::string>& ndi_sources, const std::string_view& midi_output_name,
+             std::chrono::microseconds playout_delay, const std::filesystem::path& source_cache) {
+    MIDI_Source_Discovery discovery(transport);
 
-    if (source_index == -1) {
-        std::println("Invalid NDI source. Exiting...");
+    std::vector<std::unique_ptr<MIDI_Receiver>> receivers;
+
+    // one receiver per requested source, all merged into the same MIDI port
+    MIDI_Source_Connector source_connector(transport, discovery, source_cache);
+
+    if (!source_connector.Connect(ndi_sources, receivers)) {
         return false;
     }
 
-    ndi_midi_manager.ConnectToSource(&sources[source_index]);
+    MIDI_Connection_Watchdog watchdog(discovery, ndi_sources, receivers);
 
     MIDI_IO_MANAGER midi_io_manager(midi_output_name);
 
+    if (!midi_io_manager.OpenVirtualPort()) {
+        std::println("Error creating the virtual MIDI port. Exiting...");
+        return false;
+    }
+
+    PrintStartupTimings();
+
     std::println("Starting reception, press enter to exit...");
 
     signal(SIGINT, [](int) {
@@ -143,28 +221,76 @@ bool receive(const std::string_view& ndi_source, const std::string_view& midi_ou
         end_loop = true;
     });
 
+    // with several playout schedulers, their threads share the port
+    std::mutex output_mutex;
+    const auto send_to_port = [&midi_io_manager, &output_mutex](std::span<uint8_t> data) {
+        std::lock_guard lock(output_mutex);
+        midi_io_manager.SendMIDI(data);
+    };
+
+    // with a playout delay, frames go out at their sender timing on the scheduler threads instead of on arrival
+    // every source gets its own scheduler as each one has its own clock and network path
+    std::vector<std::unique_ptr<MIDI_Playout_Scheduler>> playouts;
+    if (playout_delay.count() > 0) {
+        for (size_t i = 0; i < receivers.size(); i++) {
+            playouts.push_back(std::make_unique<MIDI_Playout_Scheduler>(playout_delay, send_to_port));
+        }
+    }
+
+    std::vector<const MIDI_Receiver*> pipeline_receivers;
+    for (const auto& receiver : receivers) {
+        pipeline_receivers.push_back(receiver.get());
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // NDI capture and the MIDI port writes run on their own threads, this one only waits for exit
+    MIDI_Receive_Pipeline pipeline(
+        std::move(pipeline_receivers),
+        [&send_to_port, &playouts](size_t source, MIDI_Frame& frame, std::chrono::steady_clock::time_point arrival) {
+            if (!playouts.empty()) {
+                playouts[source]->Schedule(frame, arrival);
+                return;
+            }
+            for (size_t i = 0; i < frame.Count(); i++) {
+                send_to_port(frame.Message(i));
+            }
+        });
+
+    bool first_frame_reported = false;
+
     while (!end_loop) {
-        if (_kbhit()) {
+        if (KeyPressed()) {
             end_loop = true;
+            break;
         }
-        auto data_string = ndi_midi_manager.ReceiveMIDI(100);
-        if (!data_string.has_value()) {
-            continue;
-        }
-        if (data_string.value().empty()) {
-            continue;
-        }
-        auto data = ndi_midi_manager.ParseMIDIMessage(data_string.value());
-        if (data.empty()) {
-            continue;
+
+        if (const auto first_frame = pipeline.GetFirstFrameTime(); first_frame && !first_frame_reported) {
+            printFirstFrame(*first_frame, source_connector, ndi_sources.size());
+            first_frame_reported = true;
         }
-        midi_io_manager.SendMIDI(data);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printReceiveStats(ndi_sources, pipeline.GetStats(), seconds);
+    printLinkStats(ndi_sources, watchdog.GetStats());
+
+    for (size_t i = 0; i < playouts.size(); i++) {
+        const auto stats = playouts[i]->GetStats();
+        std::println("{}: playout {} messages, {} late frames, {} dropped, delay {} us, max depth {}",
+                     ndi_sources[i], stats.messages, stats.late, stats.dropped, stats.delay.count(), stats.max_depth);
+        std::println("{}: jitter input {} us, output {} us, max lateness {} us",
+                     ndi_sources[i], stats.input_jitter.count(), stats.output_jitter.count(), stats.max_lateness.count());
     }
 
     return true;
 }
 
-bool transmit(const std::string_view& midi_input, const std::string_view& ndi_send_name) {
+bool transmit(const std::shared_ptr<MIDI_Transport>& transport, const std::string_view& midi_input, const std::string_view& ndi_send_name,
+              std::chrono::microseconds batch_window, size_t batch_max_bytes, size_t send_queue_size, Overflow_Policy overflow_policy) {
     MIDI_IO_MANAGER midi_io_manager(midi_input);
     midi_io_manager.UpdateMIDIPorts();
     auto    ports      = midi_io_manager.GetMIDIPorts();
@@ -179,44 +305,398 @@ bool transmit(const std::string_view& midi_input, const std::string_view& ndi_se
         std::println("Invalid MIDI port. Exiting...");
         return false;
     }
+    NDI_MIDI_Manager ndi_midi_manager(transport, ndi_send_name);
+    ndi_midi_manager.SetBatching(batch_window, batch_max_bytes);
     bool succ = midi_io_manager.OpenMIDIPort((uint32_t)port_index);
     if (!succ) {
         std::println("Error opening MIDI port. Exiting...");
         return false;
     }
-    NDI_MIDI_Manager ndi_midi_manager(ndi_send_name);
+    PrintStartupTimings();
     std::println("Starting transmission, press enter to exit...");
     signal(SIGINT, [](int) {
         std::println("Exiting...");
         end_loop = true;
     });
+    MIDI_Send_Stage send_stage(ndi_midi_manager, send_queue_size, overflow_policy);
+    forwardMIDI(midi_io_manager, send_stage);
+    midi_io_manager.CloseMIDIPort();
+    printSendStats(send_stage.GetStats());
+    printSenderStats(ndi_midi_manager.GetSenderStats());
+    return true;
+}
+
+// both directions in one process: MIDI input goes out as ndi_send_name while the NDI sources play into the
+// virtual MIDI port, on the send and receive pipeline threads with one NDI runtime and one source discovery
+bool duplex(const std::shared_ptr<MIDI_Transport>& transport, const std::vector<std::string>& ndi_sources, const std::string_view& midi_input,
+            const std::string_view& ndi_send_name, const std::string_view& midi_output_name, std::chrono::microseconds batch_window,
+            size_t batch_max_bytes, size_t send_queue_size, Overflow_Policy overflow_policy, std::chrono::milliseconds echo_window,
+            const std::filesystem::path& source_cache) {
+    NDI_MIDI_Manager ndi_midi_manager(transport, ndi_send_name);
+    ndi_midi_manager.SetBatching(batch_window, batch_max_bytes);
+
+    std::vector<std::unique_ptr<MIDI_Receiver>> receivers;
+
+    MIDI_Source_Connector source_connector(transport, ndi_midi_manager.GetDiscovery(), source_cache);
+
+    if (!source_connector.Connect(ndi_sources, receivers)) {
+        return false;
+    }
+
+    MIDI_Connection_Watchdog watchdog(ndi_midi_manager.GetDiscovery(), ndi_sources, receivers);
+
+    // the virtual port carries the received direction, the RtMidi input of the same manager the sent one
+    MIDI_IO_MANAGER midi_io_manager(midi_output_name);
+    midi_io_manager.UpdateMIDIPorts();
+
+    if (!midi_io_manager.OpenVirtualPort()) {
+        std::println("Error creating the virtual MIDI port. Exiting...");
+        return false;
+    }
+
+    const auto ports = midi_io_manager.GetMIDIPorts();
+    const auto port  = std::find(ports.begin(), ports.end(), midi_input);
+
+    if (port == ports.end() || !midi_io_manager.OpenMIDIPort(static_cast<uint32_t>(port - ports.begin()))) {
+        std::println("Error opening MIDI port {}. Exiting...", midi_input);
+        return false;
+    }
+
+    PrintStartupTimings();
+
+    std::println("Starting duplex bridge, press enter to exit...");
+
+    signal(SIGINT, [](int) {
+        std::println("Exiting...");
+        end_loop = true;
+    });
+
+    MIDI_Echo_Filter echo_filter(echo_window);
+
+    std::vector<const MIDI_Receiver*> pipeline_receivers;
+    for (const auto& receiver : receivers) {
+        pipeline_receivers.push_back(receiver.get());
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    MIDI_Receive_Pipeline pipeline(
+        std::move(pipeline_receivers),
+        [&midi_io_manager, &echo_filter](size_t, MIDI_Frame& frame, std::chrono::steady_clock::time_point) {
+            for (size_t i = 0; i < frame.Count(); i++) {
+                // recorded before the write, the echo may be back on the input before SendMIDI returns
+                echo_filter.Record(frame.Message(i));
+                midi_io_manager.SendMIDI(frame.Message(i));
+            }
+        });
+
+    {
+        MIDI_Send_Stage send_stage(ndi_midi_manager, send_queue_size, overflow_policy);
+        forwardMIDI(midi_io_manager, send_stage, &echo_filter);
+        midi_io_manager.CloseMIDIPort();
+        printSendStats(send_stage.GetStats());
+    }
+
+    printSenderStats(ndi_midi_manager.GetSenderStats());
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printReceiveStats(ndi_sources, pipeline.GetStats(), seconds);
+    printLinkStats(ndi_sources, watchdog.GetStats());
+
+    if (const auto first_frame = pipeline.GetFirstFrameTime()) {
+        printFirstFrame(*first_frame, source_connector, ndi_sources.size());
+    }
+
+    std::println("{} echoed messages suppressed", echo_filter.GetSuppressed());
+
+    return true;
+}
+
+#ifdef __linux__
+// transmits, and with NDI sources also receives, on this one thread instead of the send, capture and output threads
+// of the other modes: the MIDI input queue, the readiness descriptors of the receivers, stdin and SIGINT all wake the
+// same epoll loop, which encodes, sends and writes received messages to the MIDI port without handing anything on.
+// The MIDI input wakes it through an eventfd the RtMidi input thread signals, not through the ALSA sequencer's own
+// descriptors, and the RtMidi input, source discovery, connection watchdog and sender connection poll threads still run
+bool eventLoop(const std::shared_ptr<MIDI_Transport>& transport, const std::vector<std::string>& ndi_sources, const std::string_view& midi_input,
+               const std::string_view& ndi_send_name, const std::string_view& midi_output_name, std::chrono::microseconds batch_window,
+               size_t batch_max_bytes, const std::filesystem::path& source_cache) {
+    ApplyThreadPolicy(Thread_Role::MIDIInput, "event loop");
+
+    Event_Reactor reactor;
+
+    // before anything starts a thread, every thread has to block the signals for the signalfd to see them
+    if (!reactor.IsValid() || !reactor.AddSignals({SIGINT, SIGTERM}, [&reactor](int) {
+            std::println("Exiting...");
+            reactor.Stop();
+        })) {
+        std::println("Cannot start the event loop. Exiting...");
+        return false;
+    }
+
+    NDI_MIDI_Manager ndi_midi_manager(transport, ndi_send_name);
+    // expired batches are flushed by the loop, see the tick below
+    ndi_midi_manager.SetBatching(batch_window, batch_max_bytes, false);
+
+    std::vector<std::unique_ptr<MIDI_Receiver>> receivers;
+
+    MIDI_Source_Connector source_connector(transport, ndi_midi_manager.GetDiscovery(), source_cache);
+
+    if (!source_connector.Connect(ndi_sources, receivers)) {
+        return false;
+    }
+
+    MIDI_Connection_Watchdog watchdog(ndi_midi_manager.GetDiscovery(), ndi_sources, receivers);
+
+    MIDI_IO_MANAGER midi_io_manager(midi_output_name);
+    midi_io_manager.UpdateMIDIPorts();
+
+    // only receiving needs the virtual port
+    if (!ndi_sources.empty() && !midi_io_manager.OpenVirtualPort()) {
+        std::println("Error creating the virtual MIDI port. Exiting...");
+        return false;
+    }
+
+    const int midi_ready_fd = midi_io_manager.GetReadyFd();
+
+    if (midi_ready_fd < 0) {
+        return false;
+    }
+
+    const auto ports = midi_io_manager.GetMIDIPorts();
+    const auto port  = std::find(ports.begin(), ports.end(), midi_input);
+
+    if (port == ports.end() || !midi_io_manager.OpenMIDIPort(static_cast<uint32_t>(port - ports.begin()))) {
+        std::println("Error opening MIDI port {}. Exiting...", midi_input);
+        return false;
+    }
+
+    uint64_t sent_messages = 0;
+
+    // from the RtMidi input thread signaling the descriptor until the loop handles it
+    uint64_t                  midi_wakes = 0;
+    std::chrono::microseconds max_wake_latency{0};
+    std::chrono::microseconds total_wake_latency{0};
+
+    MIDI_Batch batch;
+    batch.bytes.reserve(MAX_SYSEX_BUFFER);
+
+    const bool reading_midi = reactor.Add(midi_ready_fd, [&] {
+        // cleared first, a message that arrives while draining only notifies again once the queue ran empty
+        const auto ready_time = midi_io_manager.ClearReady();
+
+        if (ready_time != std::chrono::steady_clock::time_point{}) {
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - ready_time);
+
+            midi_wakes++;
+            total_wake_latency += latency;
+            max_wake_latency    = std::max(max_wake_latency, latency);
+        }
+
+        do {
+            midi_io_manager.ReceiveMIDI(batch);
+
+            for (size_t i = 0; i < batch.Count(); i++) {
+                ndi_midi_manager.SendMIDI(batch.Message(i), batch.Timecode(i));
+            }
+            sent_messages += batch.Count();
+        } while (midi_io_manager.WaitForMIDI(std::chrono::milliseconds(0)));
+    });
+
+    if (!reading_midi) {
+        return false;
+    }
+
+    uint64_t                                             received_messages = 0;
+    std::chrono::microseconds                            max_receive_latency{0};
+    std::optional<std::chrono::steady_clock::time_point> first_frame;
+
+    MIDI_Frame frame;
+
+    for (size_t i = 0; i < receivers.size(); i++) {
+        const int fd = receivers[i]->GetReadyFd();
+
+        if (fd < 0) {
+            std::println("The {} transport cannot wake an event loop on received frames. Exiting...", ndi_sources[i]);
+            return false;
+        }
+
+        const bool added = reactor.Add(fd, [&, receiver = receivers[i].get()] {
+            // the descriptor stays readable while frames are queued, so the next wake up takes the rest
+            if (receiver->ReceiveMIDI(0, frame) != MIDI_Parse_Status::Ok) {
+                return;
+            }
+
+            // sender capture to MIDI output, only meaningful with clocks in sync like on the loopback transport
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - TimecodeToSteady(frame.timecode));
+            max_receive_latency = std::max(max_receive_latency, latency);
+
+            for (size_t j = 0; j < frame.Count(); j++) {
+                midi_io_manager.SendMIDI(frame.Message(j));
+            }
+            received_messages += frame.Count();
+
+            if (!first_frame) {
+                first_frame = std::chrono::steady_clock::now();
+            }
+        });
+
+        if (!added) {
+            return false;
+        }
+    }
+
+    // enter stops the loop like in the other modes; epoll refuses a stdin that is /dev/null or a regular file, then
+    // there is no console and only the signals stop it
+    const bool watching_stdin = reactor.Add(STDIN_FILENO, [&reactor] {
+        std::string line;
+
+        if (!std::getline(std::cin, line)) {
+            // at its end stdin stays readable and would wake the loop forever
+            reactor.Remove(STDIN_FILENO);
+            return;
+        }
+        reactor.Stop();
+    });
+
+    PrintStartupTimings();
+
+    std::println("Starting event loop bridge, press {} to exit...", watching_stdin ? "enter" : "Ctrl+C");
+
+    reactor.Run([&ndi_midi_manager](std::chrono::steady_clock::time_point now) { return ndi_midi_manager.FlushExpired(now); });
+
+    midi_io_manager.CloseMIDIPort();
+    ndi_midi_manager.FlushMIDI();
+    printSenderStats(ndi_midi_manager.GetSenderStats());
+
+    const auto stats = reactor.GetStats();
+
+    std::println("event loop: {} wake ups, {} events, slowest dispatch {} us", stats.wakeups, stats.events, stats.max_dispatch_time.count());
+    std::println("{} messages sent, {} received, max receive latency {} us", sent_messages, received_messages, max_receive_latency.count());
+
+    if (midi_wakes > 0) {
+        std::println("MIDI input wake latency: average {} us, max {} us", total_wake_latency.count() / midi_wakes, max_wake_latency.count());
+    }
+
+    printLinkStats(ndi_sources, watchdog.GetStats());
+
+    if (first_frame) {
+        printFirstFrame(*first_frame, source_connector, ndi_sources.size());
+    }
+
+    return true;
+}
+#endif
+
+// publishes several MIDI inputs from this one process, every input as its own NDI source
+bool transmitBridges(const std::shared_ptr<MIDI_Transport>& transport, const std::vector<std::string>& midi_inputs,
+                     const std::vector<std::string>& ndi_send_names, size_t bridge_threads,
+                     std::chrono::microseconds batch_window, size_t batch_max_bytes) {
+    MIDI_Bridge_Pool bridge_pool(transport, bridge_threads, batch_window, batch_max_bytes);
+
+    for (size_t i = 0; i < midi_inputs.size(); i++) {
+        if (!bridge_pool.AddPort(midi_inputs[i], ndi_send_names[i])) {
+            std::println("Error opening MIDI port {}. Exiting...", midi_inputs[i]);
+            return false;
+        }
+    }
+
+    bridge_pool.Start();
+
+    PrintStartupTimings();
+
+    std::println("Starting transmission of {} ports, press enter to exit...", midi_inputs.size());
+
+    signal(SIGINT, [](int) {
+        std::println("Exiting...");
+        end_loop = true;
+    });
+
     while (!end_loop) {
-        if (_kbhit()) {
+        if (KeyPressed()) {
             end_loop = true;
+            break;
         }
-        auto data = midi_io_manager.ReceiveMIDI();
-        if (data.size() > 0) {
-            ndi_midi_manager.SendMIDI(data);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    const auto bridge_stats = bridge_pool.GetStats();
+
+    for (size_t i = 0; i < bridge_stats.size(); i++) {
+        const auto& stats = bridge_stats[i];
+        std::println("{}: {} messages in {} bursts, largest burst {}, {} skipped while nobody listened, {} state resyncs",
+                     midi_inputs[i], stats.messages, stats.bursts, stats.max_burst, stats.sender.skipped, stats.sender.resyncs);
+    }
+
+    return true;
+}
+
+// runs the routing matrix of a config file until enter is pressed or SIGINT is received
+bool route(const std::shared_ptr<MIDI_Transport>& transport, const std::filesystem::path& route_config, size_t bridge_threads,
+           std::chrono::microseconds batch_window, size_t batch_max_bytes) {
+    auto config = LoadRoutingConfig(route_config);
+
+    if (!config) {
+        return false;
+    }
+
+    MIDI_Router router(transport, std::move(*config), bridge_threads, batch_window, batch_max_bytes);
+
+    if (!router.Start()) {
+        std::println("Error opening the routing endpoints. Exiting...");
+        return false;
+    }
+
+    PrintStartupTimings();
+
+    std::println("Starting {} routes, press enter to exit...", router.GetConfig().routes.size());
+
+    signal(SIGINT, [](int) {
+        std::println("Exiting...");
+        end_loop = true;
+    });
+
+    while (!end_loop) {
+        if (KeyPressed()) {
+            end_loop = true;
+            break;
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    const auto& inputs  = router.GetConfig().inputs;
+    const auto& outputs = router.GetConfig().outputs;
+
+    for (const auto& stats : router.GetStats()) {
+        std::println("{} -> {}: {} messages", inputs[stats.input].id, outputs[stats.output].id, stats.messages);
+    }
+
+    const auto unrouted = router.GetUnrouted();
+    for (size_t i = 0; i < unrouted.size(); i++) {
+        std::println("{}: {} messages filtered out", inputs[i].id, unrouted[i]);
     }
+
     return true;
 }
 
-void list() {
-    NDI_MIDI_Manager ndi_midi_manager;
+void list(const std::shared_ptr<MIDI_Transport>& transport) {
+    NDI_MIDI_Manager ndi_midi_manager(transport);
     MIDI_IO_MANAGER  midi_io_manager(L"NDI MIDI");
     ndi_midi_manager.UpdateSources();
     midi_io_manager.UpdateMIDIPorts();
     std::println("NDI Sources:");
     const auto sources = ndi_midi_manager.GetSources();
     for (size_t i = 0; i < sources.size(); i++) {
-        std::println("{}: {}", i, sources[i].p_ndi_name);
+        std::println("{}: {}", i, sources[i].name);
     }
     std::println("MIDI Ports:");
     const auto ports = midi_io_manager.GetMIDIPorts();
     for (size_t i = 0; i < ports.size(); i++) {
         std::println("{}: {}", i, ports[i]);
     }
+    PrintStartupTimings();
 }
 
 int main(int argc, char** argv) {
@@ -229,17 +709,83 @@ int main(int argc, char** argv) {
         // List devices
         ("list,l", "list MIDI devices and NDI Sources")
         // "Modes"
-        ("receive,r", "receive MIDI data")("transmit,t", "transmit MIDI data")
+        ("receive,r", "receive MIDI data")("transmit,t", "transmit MIDI data")("bidirectional,b", "receive and transmit MIDI data in one process")
+        // Optional
+        ("routes", po::value<std::string>(),
+         "Optional: route MIDI inputs and NDI sources to NDI senders and virtual ports as declared in this file, instead of -r, -t or -b")
+#ifdef __linux__
+        // Optional
+        ("event-loop", "Optional: with -t or -b, run the whole bridge on one epoll thread instead of a thread per stage")
+#endif
+        // Optional
+        ("timings", "Optional: print how long each startup phase took, e.g. loading the NDI runtime or creating the virtual MIDI port")
+        // Optional
+        ("log-level", po::value<std::string>()->default_value("info"),
+         "Optional: debug (also dumps every message of the virtual MIDI port), info, warning, error or off")
+        // Optional
+        ("transport", po::value<std::string>()->default_value("ndi"),
+         "Optional: ndi, or loopback for an in-process stand-in that needs no NDI runtime")
         // "Receive" options
-        ("ndi-source", po::value<std::string>(), "NDI source name (required if -r)")
+        ("ndi-source", po::value<std::vector<std::string>>()->composing(),
+         "NDI source name (required if -r), repeat to merge several sources into one MIDI port")
+        // Optional
+        ("source-cache", po::value<std::string>()->default_value(DefaultSourceCachePath().string()),
+         "Optional: file that remembers discovered NDI sources, so the next start connects to them without waiting for discovery, empty disables it")
         // Optional
         ("midi-output-name", po::value<std::string>()->default_value("NDI MIDI"), "Optional: MIDI output name used in receive mode")
+        // Optional
+        ("playout-delay-us", po::value<uint32_t>()->default_value(0),
+         "Optional: play received MIDI out at the sender's timing, delayed by at least this many microseconds to absorb network jitter, 0 forwards on arrival")
+        // Optional
+        ("input-core", po::value<int>()->default_value(NO_CORE),
+         "Optional: CPU core to pin the RtMidi input threads (and the event loop) to, -1 leaves them unpinned")
+        // Optional
+        ("capture-core", po::value<int>()->default_value(NO_CORE),
+         "Optional: CPU core to pin the NDI capture threads to, -1 leaves them unpinned")
+        // Optional
+        ("send-core", po::value<int>()->default_value(NO_CORE),
+         "Optional: CPU core to pin the NDI send, batch and bridge worker threads to, -1 leaves them unpinned")
+        // Optional
+        ("output-core", po::value<int>()->default_value(NO_CORE),
+         "Optional: CPU core to pin the MIDI output and playout threads to, -1 leaves them unpinned")
+        // Optional
+        ("input-priority", po::value<uint32_t>()->default_value(0),
+         "Optional: SCHED_FIFO priority (1-99) of the RtMidi input threads (and the event loop), 0 keeps the default scheduling")
+        // Optional
+        ("capture-priority", po::value<uint32_t>()->default_value(0),
+         "Optional: SCHED_FIFO priority of the NDI capture threads")
+        // Optional
+        ("send-priority", po::value<uint32_t>()->default_value(0),
+         "Optional: SCHED_FIFO priority of the NDI send, batch and bridge worker threads")
+        // Optional
+        ("output-priority", po::value<uint32_t>()->default_value(0),
+         "Optional: SCHED_FIFO priority of the MIDI output and playout threads")
+        // Optional
+        ("lock-memory", "Optional: lock the process memory (mlockall) so page faults cannot stall the bridge threads")
         // "Transmit" options
-        ("midi-input", po::value<std::string>(),
-         "MIDI input port name (required if -t)")
+        ("midi-input", po::value<std::vector<std::string>>()->composing(),
+         "MIDI input port name (required if -t), repeat to publish several ports from one process")
+        // Optional
+        ("ndi-send-name", po::value<std::vector<std::string>>()->composing(),
+         "Optional: NDI source name to create in transmit mode, given once per --midi-input. Defaults to NDI MIDI for a single port and to the MIDI port name for several")
+        // Optional
+        ("bridge-threads", po::value<uint32_t>()->default_value(1),
+         "Optional: worker threads shared by all ports when transmitting several MIDI inputs")
+        // Optional
+        ("echo-window-ms", po::value<uint32_t>()->default_value(50),
+         "Optional: in bidirectional mode, MIDI input repeating a message received from NDI within this many milliseconds is not sent back, 0 disables loop suppression")
         // Optional
-        ("ndi-send-name", po::value<std::string>()->default_value("NDI MIDI"),
-         "Optional: NDI source name to create in transmit mode");
+        ("batch-window-us", po::value<uint32_t>()->default_value(0),
+         "Optional: coalesce MIDI messages into one NDI frame for up to this many microseconds in transmit mode, 0 disables batching")
+        // Optional
+        ("batch-max-bytes", po::value<uint32_t>()->default_value(1024),
+         "Optional: maximum size of a batched NDI frame in bytes")
+        // Optional
+        ("send-queue-size", po::value<uint32_t>()->default_value(DEFAULT_SEND_QUEUE_SIZE),
+         "Optional: MIDI messages buffered in front of the NDI send thread in transmit mode")
+        // Optional
+        ("overflow-policy", po::value<std::string>()->default_value("block"),
+         "Optional: what to do when the send queue is full: block, drop-oldest, or coalesce (keep only the latest value of a controller that keeps changing)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -250,22 +796,159 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    auto level = ParseLogLevel(vm["log-level"].as<std::string>());
+
+    if (!level) {
+        std::println("Unknown log level {}. Exiting...", vm["log-level"].as<std::string>());
+        return 1;
+    }
+
+    SetLogLevel(*level);
+
+    if (vm.count("timings")) {
+        EnableStartupTimings();
+    }
+
+    std::shared_ptr<MIDI_Transport> transport;
+    {
+        Startup_Phase phase("transport");
+        transport = CreateTransport(vm["transport"].as<std::string>());
+    }
+
+    if (!transport) {
+        std::println("Unknown or unavailable transport {}. Exiting...", vm["transport"].as<std::string>());
+        return 1;
+    }
+
     if (vm.count("list")) {
-        list();
+        list(transport);
         return 0;
     }
 
+    // applied by every bridge thread when it starts, a priority or core the OS refuses falls back to the default
+    SetThreadPolicy(Thread_Role::MIDIInput, Thread_Policy{vm["input-core"].as<int>(), static_cast<int>(vm["input-priority"].as<uint32_t>())});
+    SetThreadPolicy(Thread_Role::Capture, Thread_Policy{vm["capture-core"].as<int>(), static_cast<int>(vm["capture-priority"].as<uint32_t>())});
+    SetThreadPolicy(Thread_Role::Send, Thread_Policy{vm["send-core"].as<int>(), static_cast<int>(vm["send-priority"].as<uint32_t>())});
+    SetThreadPolicy(Thread_Role::Output, Thread_Policy{vm["output-core"].as<int>(), static_cast<int>(vm["output-priority"].as<uint32_t>())});
+
+    if (vm.count("lock-memory")) {
+        std::string error;
+        if (LockProcessMemory(error)) {
+            std::println("memory locked");
+        } else {
+            std::println("cannot lock memory ({}), continuing without", error);
+        }
+    }
+
+    // what the bridge threads actually got is reported when main returns, after they all started and stopped
+    struct Thread_Report_Printer {
+        ~Thread_Report_Printer() {
+            PrintThreadReports();
+        }
+    } thread_report_printer;
+
+    if (vm.count("routes")) {
+        auto route_config = std::filesystem::path(vm["routes"].as<std::string>());
+
+        auto bridge_threads = vm["bridge-threads"].as<uint32_t>();
+
+        auto batch_window = std::chrono::microseconds(vm["batch-window-us"].as<uint32_t>());
+
+        auto batch_max_bytes = vm["batch-max-bytes"].as<uint32_t>();
+
+        return route(transport, route_config, bridge_threads, batch_window, batch_max_bytes) ? 0 : 1;
+    }
+
+#ifdef __linux__
+    if (vm.count("event-loop") && (vm.count("transmit") || vm.count("bidirectional"))) {
+        if (!vm.count("midi-input") || (vm.count("bidirectional") && !vm.count("ndi-source"))) {
+            std::println("MIDI input port name, and NDI source names in bidirectional mode, are required for the event loop. Exiting...");
+            return 1;
+        }
+
+        auto midi_input_names = vm["midi-input"].as<std::vector<std::string>>();
+
+        if (midi_input_names.size() > 1) {
+            std::println("The event loop takes a single MIDI input. Exiting...");
+            return 1;
+        }
+
+        auto ndi_source_names = vm.count("bidirectional") ? vm["ndi-source"].as<std::vector<std::string>>() : std::vector<std::string>();
+
+        auto source_cache = std::filesystem::path(vm["source-cache"].as<std::string>());
+
+        auto ndi_send_name = vm.count("ndi-send-name") ? vm["ndi-send-name"].as<std::vector<std::string>>().front() : std::string("NDI MIDI");
+
+        auto midi_output_name = vm["midi-output-name"].as<std::string>();
+
+        auto batch_window = std::chrono::microseconds(vm["batch-window-us"].as<uint32_t>());
+
+        auto batch_max_bytes = vm["batch-max-bytes"].as<uint32_t>();
+
+        return eventLoop(transport, ndi_source_names, midi_input_names.front(), ndi_send_name, midi_output_name, batch_window, batch_max_bytes,
+                         source_cache)
+                   ? 0
+                   : 1;
+    }
+#endif
+
+    if (vm.count("bidirectional")) {
+        if (!vm.count("ndi-source") || !vm.count("midi-input")) {
+            std::println("NDI source and MIDI input port names are required for bidirectional mode. Exiting...");
+            return 1;
+        }
+
+        auto ndi_source_names = vm["ndi-source"].as<std::vector<std::string>>();
+
+        auto midi_input_names = vm["midi-input"].as<std::vector<std::string>>();
+
+        if (midi_input_names.size() > 1) {
+            std::println("Bidirectional mode takes a single MIDI input. Exiting...");
+            return 1;
+        }
+
+        auto ndi_send_name = vm.count("ndi-send-name") ? vm["ndi-send-name"].as<std::vector<std::string>>().front() : std::string("NDI MIDI");
+
+        auto midi_output_name = vm["midi-output-name"].as<std::string>();
+
+        auto batch_window = std::chrono::microseconds(vm["batch-window-us"].as<uint32_t>());
+
+        auto batch_max_bytes = vm["batch-max-bytes"].as<uint32_t>();
+
+        auto send_queue_size = vm["send-queue-size"].as<uint32_t>();
+
+        auto overflow_policy = ParseOverflowPolicy(vm["overflow-policy"].as<std::string>());
+
+        if (!overflow_policy) {
+            std::println("Unknown overflow policy {}. Exiting...", vm["overflow-policy"].as<std::string>());
+            return 1;
+        }
+
+        auto echo_window = std::chrono::milliseconds(vm["echo-window-ms"].as<uint32_t>());
+
+        auto source_cache = std::filesystem::path(vm["source-cache"].as<std::string>());
+
+        return duplex(transport, ndi_source_names, midi_input_names.front(), ndi_send_name, midi_output_name, batch_window,
+                      batch_max_bytes, send_queue_size, *overflow_policy, echo_window, source_cache)
+                   ? 0
+                   : 1;
+    }
+
     if (vm.count("receive")) {
         if (!vm.count("ndi-source")) {
             std::println("NDI source name is required for receiving MIDI data. Exiting...");
             return 1;
         }
 
-        auto ndi_source_name = vm["ndi-source"].as<std::string>();
+        auto ndi_source_names = vm["ndi-source"].as<std::vector<std::string>>();
 
         auto midi_output_name = vm["midi-output-name"].as<std::string>();
 
-        return receive(ndi_source_name, midi_output_name) ? 0 : 1;
+        auto playout_delay = std::chrono::microseconds(vm["playout-delay-us"].as<uint32_t>());
+
+        auto source_cache = std::filesystem::path(vm["source-cache"].as<std::string>());
+
+        return receive(transport, ndi_source_names, midi_output_name, playout_delay, source_cache) ? 0 : 1;
     }
 
     if (vm.count("transmit")) {
@@ -275,20 +958,50 @@ int main(int argc, char** argv) {
             return 1;
         }
 
-        auto midi_input_name = vm["midi-input"].as<std::string>();
+        auto midi_input_names = vm["midi-input"].as<std::vector<std::string>>();
+
+        auto ndi_send_names = vm.count("ndi-send-name") ? vm["ndi-send-name"].as<std::vector<std::string>>() : std::vector<std::string>();
+
+        if (ndi_send_names.size() > midi_input_names.size()) {
+            std::println("More NDI send names than MIDI inputs. Exiting...");
+            return 1;
+        }
+
+        auto batch_window = std::chrono::microseconds(vm["batch-window-us"].as<uint32_t>());
+
+        auto batch_max_bytes = vm["batch-max-bytes"].as<uint32_t>();
+
+        auto send_queue_size = vm["send-queue-size"].as<uint32_t>();
+
+        auto overflow_policy = ParseOverflowPolicy(vm["overflow-policy"].as<std::string>());
+
+        if (!overflow_policy) {
+            std::println("Unknown overflow policy {}. Exiting...", vm["overflow-policy"].as<std::string>());
+            return 1;
+        }
+
+        if (midi_input_names.size() > 1) {
+            for (size_t i = ndi_send_names.size(); i < midi_input_names.size(); i++) {
+                ndi_send_names.push_back(midi_input_names[i]);
+            }
+
+            auto bridge_threads = vm["bridge-threads"].as<uint32_t>();
+
+            return transmitBridges(transport, midi_input_names, ndi_send_names, bridge_threads, batch_window, batch_max_bytes) ? 0 : 1;
+        }
 
-        auto ndi_send_name = vm["ndi-send-name"].as<std::string>();
+        auto ndi_send_name = ndi_send_names.empty() ? std::string("NDI MIDI") : ndi_send_names.front();
 
-        return transmit(midi_input_name, ndi_send_name) ? 0 : 1;
+        return transmit(transport, midi_input_names.front(), ndi_send_name, batch_window, batch_max_bytes, send_queue_size, *overflow_policy) ? 0 : 1;
     }
 
     std::string input;
     std::println("Would you like to receive (r) or transmit (t) MIDI data via NDI?");
     std::getline(std::cin, input);
     if (input.compare("r") == 0 || input.compare("R") == 0) {
-        receiveInteractive();
+        receiveInteractive(transport);
     } else if (input.compare("t") == 0 || input.compare("T") == 0) {
-        transmitInteractive();
+        transmitInteractive(transport);
     } else {
         std::println("Invalid input. Exiting...");
     }
@@ -0,0 +1,101 @@
+#include "midi_state.hpp"
+
+// parameter number selection, data entry goes to the one selected last
+constexpr uint8_t CC_NRPN_LSB = 98;
+constexpr uint8_t CC_NRPN_MSB = 99;
+constexpr uint8_t CC_RPN_LSB  = 100;
+constexpr uint8_t CC_RPN_MSB  = 101;
+
+// what Reset All Controllers puts back to its default (RP-015), the parameter numbers to the null one
+constexpr uint8_t  CC_MODULATION     = 1;
+constexpr uint8_t  CC_EXPRESSION     = 11;
+constexpr uint8_t  CC_SUSTAIN        = 64;
+constexpr uint8_t  CC_SOFT_PEDAL     = 67;
+constexpr uint8_t  PARAMETER_NULL    = 127;
+constexpr uint16_t PITCH_BEND_CENTER = 0x2000;
+
+// channel mode messages, they act on the state instead of being part of it
+constexpr uint8_t CC_ALL_SOUND_OFF         = 120;
+constexpr uint8_t CC_RESET_ALL_CONTROLLERS = 121;
+constexpr uint8_t CC_ALL_NOTES_OFF         = 123;
+
+void MIDI_State_Snapshot::Update(std::span<const uint8_t> data) {
+    if (data.empty()) {
+        return;
+    }
+
+    const uint8_t status = data[0];
+
+    // system reset
+    if (status == 0xFF) {
+        Clear();
+        return;
+    }
+
+    if (status < 0x80 || status >= 0xF0) {
+        return;
+    }
+
+    auto& state = m_channels[status & 0x0F];
+
+    switch (status & 0xF0) {
+    case 0x80:
+        if (data.size() >= 3) {
+            state.notes[data[1] & 0x7F] = 0;
+        }
+        break;
+    case 0x90:
+        // a note on with velocity 0 is a note off
+        if (data.size() >= 3) {
+            state.notes[data[1] & 0x7F] = data[2] & 0x7F;
+        }
+        break;
+    case 0xB0: {
+        if (data.size() < 3) {
+            break;
+        }
+
+        const uint8_t controller = data[1] & 0x7F;
+
+        if (controller == CC_NRPN_LSB || controller == CC_NRPN_MSB) {
+            state.nrpn_last = true;
+        } else if (controller == CC_RPN_LSB || controller == CC_RPN_MSB) {
+            state.nrpn_last = false;
+        }
+
+        if (controller < CC_ALL_SOUND_OFF) {
+            state.controllers[controller] = data[2] & 0x7F;
+        } else if (controller == CC_RESET_ALL_CONTROLLERS) {
+            // bank select, volume, pan, the sound and effect controllers and the parameter values keep theirs;
+            // channel and poly pressure are reset too, but are not tracked
+            state.controllers[CC_MODULATION] = 0;
+            state.controllers[CC_EXPRESSION] = 127;
+            std::fill(state.controllers.begin() + CC_SUSTAIN, state.controllers.begin() + CC_SOFT_PEDAL + 1, 0);
+            for (const uint8_t parameter : {CC_NRPN_LSB, CC_NRPN_MSB, CC_RPN_LSB, CC_RPN_MSB}) {
+                state.controllers[parameter] = PARAMETER_NULL;
+            }
+            state.pitch_bend = PITCH_BEND_CENTER;
+        } else if (controller == CC_ALL_SOUND_OFF || controller >= CC_ALL_NOTES_OFF) {
+            // omni and mono/poly switches end all notes too
+            state.notes.fill(0);
+        }
+        break;
+    }
+    case 0xC0:
+        if (data.size() >= 2) {
+            state.program = data[1] & 0x7F;
+        }
+        break;
+    case 0xE0:
+        if (data.size() >= 3) {
+            state.pitch_bend = static_cast<uint16_t>((data[1] & 0x7F) | ((data[2] & 0x7F) << 7));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void MIDI_State_Snapshot::Clear() {
+    m_channels.fill(Channel_State());
+}
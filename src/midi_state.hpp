@@ -0,0 +1,101 @@
+#pragma once
+
+#include "pch.hpp"
+
+// what a receiver joining in the middle of a stream needs to be in the same state as one that listened from the
+// start: per channel the last value of every controller, the program, the pitch bend and the held notes
+class MIDI_State_Snapshot {
+public:
+    // tracks one complete MIDI message, anything that is not channel state is ignored
+    void Update(std::span<const uint8_t> data);
+
+    void Clear();
+
+    // calls emit with every message that restores the state, per channel in the order a synth expects them:
+    // bank select, program, the other controllers, the (N)RPN selection and data entry, pitch bend, then the held
+    // notes if include_notes. Data increment and decrement are relative and never replayed
+    template <typename Emit>
+    void ForEachMessage(bool include_notes, Emit&& emit) const;
+
+private:
+    static constexpr uint8_t  UNSET      = 0xFF;
+    static constexpr uint16_t UNSET_BEND = 0xFFFF;
+
+    struct Channel_State {
+        Channel_State() {
+            controllers.fill(UNSET);
+            notes.fill(0);
+        }
+
+        std::array<uint8_t, 128> controllers;
+        std::array<uint8_t, 128> notes; // velocity of every held note, 0 once released
+        uint8_t                  program    = UNSET;
+        uint16_t                 pitch_bend = UNSET_BEND;
+        bool                     nrpn_last  = false; // data entry goes to the NRPN rather than the RPN
+    };
+
+    std::array<Channel_State, 16> m_channels;
+};
+
+template <typename Emit>
+void MIDI_State_Snapshot::ForEachMessage(bool include_notes, Emit&& emit) const {
+    for (uint8_t channel = 0; channel < m_channels.size(); channel++) {
+        const auto& state = m_channels[channel];
+
+        const auto emit_controller = [&](uint8_t controller) {
+            if (state.controllers[controller] != UNSET) {
+                const uint8_t message[3] = {static_cast<uint8_t>(0xB0 | channel), controller, state.controllers[controller]};
+                emit(std::span<const uint8_t>(message));
+            }
+        };
+
+        // a program change picks from the bank selected before it
+        emit_controller(0);
+        emit_controller(32);
+
+        if (state.program != UNSET) {
+            const uint8_t message[2] = {static_cast<uint8_t>(0xC0 | channel), state.program};
+            emit(std::span<const uint8_t>(message));
+        }
+
+        for (uint8_t controller = 1; controller < 120; controller++) {
+            // bank select went first, parameter numbers and data entry go last
+            if (controller == 32 || controller == 6 || controller == 38 || (controller >= 96 && controller <= 101)) {
+                continue;
+            }
+            emit_controller(controller);
+        }
+
+        // data entry applies to whichever parameter was selected last, so that one is selected last again
+        if (state.nrpn_last) {
+            emit_controller(101);
+            emit_controller(100);
+            emit_controller(99);
+            emit_controller(98);
+        } else {
+            emit_controller(99);
+            emit_controller(98);
+            emit_controller(101);
+            emit_controller(100);
+        }
+        emit_controller(6);
+        emit_controller(38);
+
+        if (state.pitch_bend != UNSET_BEND) {
+            const uint8_t message[3] = {static_cast<uint8_t>(0xE0 | channel), static_cast<uint8_t>(state.pitch_bend & 0x7F),
+                                        static_cast<uint8_t>(state.pitch_bend >> 7)};
+            emit(std::span<const uint8_t>(message));
+        }
+
+        if (!include_notes) {
+            continue;
+        }
+
+        for (uint8_t note = 0; note < 128; note++) {
+            if (state.notes[note] != 0) {
+                const uint8_t message[3] = {static_cast<uint8_t>(0x90 | channel), note, state.notes[note]};
+                emit(std::span<const uint8_t>(message));
+            }
+        }
+    }
+}
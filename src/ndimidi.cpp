@@ -1,176 +1,493 @@
 #include "ndimidi.hpp"
+#include "logging.hpp"
+#include "thread_util.hpp"
+#include "hexcodec.hpp"
+#include "startup_timing.hpp"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
-NDI_MIDI_Manager::NDI_MIDI_Manager(const std::string_view& send_name) {
+// how soon a receiver that connected gets the state snapshot, a poll is one connection count per sender
+constexpr auto CONNECTION_POLL_INTERVAL = std::chrono::milliseconds(50);
 
-    NDIlib_initialize();
+namespace {
 
-    auto find_create_desc = NDIlib_find_create_t(
-        true, nullptr, nullptr);
+// polls the connection counts of every sender from one thread, so e.g. the senders of the bridge pool
+// do not need a thread each
+class Sender_Connection_Poller {
+public:
+    void Add(MIDI_Sender* sender) {
+        std::lock_guard lock(m_mutex);
+        m_senders.push_back(sender);
 
-    m_p_find = NDIlib_find_create_v2(&find_create_desc);
+        if (!m_thread.joinable()) {
+            m_thread = std::jthread([this](std::stop_token stop_token) { PollLoop(stop_token); });
+        }
+        m_cv.notify_one();
+    }
 
-    if (!m_p_find) {
-        std::println("cannot create NDI find instance");
-        return;
+    // the sender is not being polled anymore once this returns
+    void Remove(MIDI_Sender* sender) {
+        std::lock_guard lock(m_mutex);
+        std::erase(m_senders, sender);
     }
 
-    auto send_create_desc = NDIlib_send_create_t(
-        send_name.data(),
-        nullptr,
-        false,
-        false);
+private:
+    std::mutex                  m_mutex;
+    std::condition_variable_any m_cv;
+    std::vector<MIDI_Sender*>   m_senders;
+    std::jthread                m_thread;
+
+    void PollLoop(std::stop_token stop_token) {
+        std::unique_lock lock(m_mutex);
+
+        while (!stop_token.stop_requested()) {
+            if (!m_cv.wait(lock, stop_token, [this] { return !m_senders.empty(); })) {
+                break;
+            }
 
-    m_p_send = NDIlib_send_create(&send_create_desc);
+            for (auto* sender : m_senders) {
+                sender->PollConnections();
+            }
 
-    auto recv_create_desc            = NDIlib_recv_create_v3_t();
-    recv_create_desc.p_ndi_recv_name = "NDI MIDI";
+            m_cv.wait_for(lock, stop_token, CONNECTION_POLL_INTERVAL, [] { return false; });
+        }
+    }
+};
 
-    m_p_recv = NDIlib_recv_create_v3(&recv_create_desc);
+Sender_Connection_Poller& GetConnectionPoller() {
+    static Sender_Connection_Poller poller;
+    return poller;
 }
 
-NDI_MIDI_Manager::~NDI_MIDI_Manager() {
+} // namespace
 
-    DisconnectFromSource();
+NDI_MIDI_Manager::NDI_MIDI_Manager(std::shared_ptr<MIDI_Transport> transport, const std::string_view& send_name)
+    : m_p_transport(std::move(transport))
+    , m_send_name(send_name) {}
 
-    if (m_p_find) {
-        NDIlib_find_destroy(m_p_find);
+NDI_MIDI_Manager::~NDI_MIDI_Manager() {
+
+    if (m_p_receiver) {
+        DisconnectFromSource();
     }
 
-    m_p_find = nullptr;
+    m_p_discovery.reset();
+    m_p_sender.reset();
+    m_p_receiver.reset();
+}
+
+MIDI_Source_Discovery& NDI_MIDI_Manager::GetDiscovery() const {
+    std::call_once(m_discovery_once, [this] { m_p_discovery = std::make_unique<MIDI_Source_Discovery>(m_p_transport); });
+    return *m_p_discovery;
+}
 
-    if (m_p_send) {
-        NDIlib_send_destroy(m_p_send);
-    }
+MIDI_Sender& NDI_MIDI_Manager::GetSender() const {
+    std::call_once(m_sender_once, [this] {
+        Startup_Phase phase("NDI sender");
+        m_p_sender = std::make_unique<MIDI_Sender>(m_p_transport->CreateSender(m_send_name));
+    });
+    return *m_p_sender;
+}
+
+MIDI_Receiver& NDI_MIDI_Manager::GetOwnReceiver() const {
+    std::call_once(m_receiver_once, [this] {
+        Startup_Phase phase("NDI receiver");
+        m_p_receiver = CreateReceiver();
+    });
+    return *m_p_receiver;
+}
+
+const MIDI_Receiver& NDI_MIDI_Manager::GetReceiver() const {
+    return GetOwnReceiver();
+}
+
+void NDI_MIDI_Manager::UpdateSources() {
+    // discovery runs from the first use of the manager's discovery, this only waits for it to settle the first time
+    m_sources = GetDiscovery().WaitForSources({})->GetSources();
 
-    m_p_send = nullptr;
+    std::println("found {} sources", m_sources.size());
+}
 
-    if (m_p_recv) {
-        NDIlib_recv_destroy(m_p_recv);
+void NDI_MIDI_Manager::ConnectToSource(const MIDI_Source* source) const {
+    if (!source) {
+        return;
     }
 
-    m_p_recv = nullptr;
+    GetOwnReceiver().Connect(source);
+}
 
-    NDIlib_destroy();
+void NDI_MIDI_Manager::DisconnectFromSource() const {
+    GetOwnReceiver().Connect(nullptr);
 }
 
-void NDI_MIDI_Manager::UpdateSources() {
+std::unique_ptr<MIDI_Receiver> NDI_MIDI_Manager::CreateReceiver(std::string_view name) const {
+    return std::make_unique<MIDI_Receiver>(m_p_transport->CreateReceiver(name));
+}
+
+void NDI_MIDI_Manager::SendMIDI(const std::span<uint8_t>& data, int64_t timecode) {
+    GetSender().SendMIDI(data, timecode);
+}
+
+void NDI_MIDI_Manager::SetBatching(std::chrono::microseconds max_latency, size_t max_frame_size, bool own_thread) {
+    GetSender().SetBatching(max_latency, max_frame_size, own_thread);
+}
+
+void NDI_MIDI_Manager::FlushMIDI() {
+    GetSender().FlushMIDI();
+}
+
+std::optional<std::chrono::steady_clock::time_point> NDI_MIDI_Manager::FlushExpired(std::chrono::steady_clock::time_point now) {
+    return GetSender().FlushExpired(now);
+}
+
+Sender_Stats NDI_MIDI_Manager::GetSenderStats() const {
+    if (!m_p_sender) {
+        return Sender_Stats();
+    }
+    return m_p_sender->GetStats();
+}
 
-    if (!m_p_find) {
+MIDI_Parse_Status NDI_MIDI_Manager::ReceiveMIDI(uint32_t wait_time_ms, MIDI_Frame& frame) const {
+    return GetOwnReceiver().ReceiveMIDI(wait_time_ms, frame);
+}
+
+MIDI_Receiver::MIDI_Receiver(std::unique_ptr<Metadata_Receiver> receiver)
+    : m_p_receiver(std::move(receiver)) {}
+
+MIDI_Receiver::~MIDI_Receiver() {
+    Connect(nullptr);
+}
+
+void MIDI_Receiver::Connect(const MIDI_Source* source) const {
+    if (!m_p_receiver) {
         return;
     }
+    m_p_receiver->Connect(source);
+}
 
-    // wait as long as we are still finding new sources
-    // NDIlib_find_wait_for_sources returns immideately after a NEW source is found, so if we only call it once, we will only have the first source
-    while (NDIlib_find_wait_for_sources(m_p_find, 1000)) {
+uint64_t MIDI_Receiver::GetDroppedFrames() const {
+    if (!m_p_receiver) {
+        return 0;
     }
+    return m_p_receiver->GetDroppedFrames();
+}
+
+int MIDI_Receiver::GetReadyFd() const {
+    if (!m_p_receiver) {
+        return -1;
+    }
+    return m_p_receiver->GetReadyFd();
+}
+
+int MIDI_Receiver::GetConnectionCount() const {
+    if (!m_p_receiver) {
+        return 0;
+    }
+    return m_p_receiver->GetConnectionCount();
+}
 
-    const auto p_sources = NDIlib_find_get_current_sources(m_p_find, &m_n_sources);
+void MIDI_Receiver::SetStatusCallback(std::function<void()> callback) {
+    m_status_callback = std::move(callback);
+}
+
+MIDI_Parse_Status MIDI_Receiver::ReceiveMIDI(uint32_t wait_time_ms, MIDI_Frame& frame) const {
 
-    m_p_sources.clear();
-    m_p_sources.reserve(m_n_sources);
+    frame.Clear();
+
+    if (!m_p_receiver) {
+        return MIDI_Parse_Status::NoFrame;
+    }
 
-    if (p_sources) {
-        std::println("found {} sources", m_n_sources);
+    Metadata_Frame metadata_frame;
 
-        for (uint32_t i = 0; i < m_n_sources; i++) {
-            m_p_sources.push_back(p_sources[i]);
+    switch (m_p_receiver->Capture(wait_time_ms, metadata_frame)) {
+    case Capture_Result::Metadata: {
+        // decode straight out of the transport owned buffer, it is only released afterwards
+        const auto status = NDI_MIDI_Manager::ParseMIDIMessage(metadata_frame.data, frame);
+        frame.timecode    = metadata_frame.timecode;
+
+        m_p_receiver->FreeFrame(metadata_frame);
+        return status;
+    }
+    case Capture_Result::None:
+        break;
+    // The source has changed status in some way
+    case Capture_Result::StatusChange:
+        if (m_status_callback) {
+            m_status_callback();
         }
+        break;
     }
+    return MIDI_Parse_Status::NoFrame;
 }
 
-void NDI_MIDI_Manager::ConnectToSource(const NDIlib_source_t* source) const {
-    if (!m_p_recv) {
+MIDI_Sender::MIDI_Sender(std::unique_ptr<Metadata_Sender> sender)
+    : m_p_sender(std::move(sender)) {
+    // enough for any channel message, sysex grows the buffer once
+    m_send_buffer.resize(256);
+
+    if (!m_p_sender) {
         return;
     }
 
-    if (!source) {
-        return;
+    m_stats.connections = m_p_sender->GetConnectionCount(0);
+    GetConnectionPoller().Add(this);
+}
+
+MIDI_Sender::~MIDI_Sender() {
+    if (m_p_sender) {
+        GetConnectionPoller().Remove(this);
     }
 
-    NDIlib_recv_connect(m_p_recv, source);
+    // stop the batch thread and send whatever is still pending before the sender goes away
+    SetBatching(std::chrono::microseconds(0), 0);
 }
 
-void NDI_MIDI_Manager::DisconnectFromSource() const {
+void MIDI_Sender::SendMIDI(const std::span<uint8_t>& data, int64_t timecode) {
+    if (!m_p_sender) {
+        return;
+    }
+
+    std::lock_guard lock(m_send_mutex);
+
+    // the poller may not have seen a receiver that connected since, asking is cheap while nobody listens
+    if (m_stats.connections == 0) {
+        m_stats.connections = m_p_sender->GetConnectionCount(0);
+
+        // nobody would get it, the state is all a receiver connecting later needs
+        if (m_stats.connections == 0) {
+            m_state.Update(data);
+            m_stats.skipped++;
+            return;
+        }
+
+        // the state from before this message, the message itself follows
+        SendStateLocked(true);
+    }
+
+    m_state.Update(data);
 
-    if (!m_p_recv) {
+    const size_t element_size = MIDI_OPEN_TAG.size() + EncodedHexSize(data.size()) + MIDI_CLOSE_TAG.size();
+
+    if (m_batch_max_latency.count() == 0) {
+        m_send_timecode = timecode;
+        AppendMIDIElement(data);
+        FlushLocked();
         return;
     }
-    NDIlib_recv_connect(m_p_recv, nullptr);
-}
 
-void NDI_MIDI_Manager::SendMIDI(const std::span<uint8_t>& data) const {
-    std::string metadata_message("<MIDI>");
-    metadata_message.reserve(data.size() + 7);
+    if (m_send_length > 0 && m_send_length + element_size > m_batch_max_frame_size) {
+        FlushLocked();
+    }
+
+    const bool was_empty = m_send_length == 0;
 
-    for (const auto& byte : data) {
-        metadata_message += std::format("{:02X}", byte);
+    if (was_empty) {
+        m_send_timecode = timecode;
     }
 
-    metadata_message += "</MIDI>";
+    AppendMIDIElement(data);
 
-    const NDIlib_metadata_frame_t metadata_frame{
-        static_cast<int>(metadata_message.size()),
-        NDIlib_send_timecode_synthesize,
-        const_cast<char*>(metadata_message.c_str())};
+    // a single element larger than the frame limit goes out on its own
+    if (m_send_length >= m_batch_max_frame_size) {
+        FlushLocked();
+        return;
+    }
 
-    NDIlib_send_send_metadata(m_p_send, &metadata_frame);
+    if (was_empty) {
+        m_batch_deadline = std::chrono::steady_clock::now() + m_batch_max_latency;
+        m_batch_cv.notify_one();
+    }
 }
 
-const std::optional<std::string> NDI_MIDI_Manager::ReceiveMIDI(uint32_t wait_time_ms) const {
+void MIDI_Sender::SetBatching(std::chrono::microseconds max_latency, size_t max_frame_size, bool own_thread) {
+    if (m_batch_thread.joinable()) {
+        m_batch_thread.request_stop();
+        m_batch_thread.join();
+    }
 
-    if (!m_p_recv) {
-        return std::nullopt;
+    std::lock_guard lock(m_send_mutex);
+
+    FlushLocked();
+
+    m_batch_max_latency    = max_latency;
+    m_batch_max_frame_size = max_frame_size;
+
+    if (m_batch_max_latency.count() > 0 && own_thread) {
+        m_batch_thread = std::jthread([this](std::stop_token stop_token) { BatchLoop(stop_token); });
     }
+}
 
-    NDIlib_metadata_frame_t metadata_frame;
+void MIDI_Sender::FlushMIDI() {
+    std::lock_guard lock(m_send_mutex);
+    FlushLocked();
+}
 
-    switch (NDIlib_recv_capture_v3(
-        m_p_recv, nullptr, nullptr, &metadata_frame, wait_time_ms)) {
-    case NDIlib_frame_type_metadata:
-        if (metadata_frame.length > 0) {
-            auto str = std::string(metadata_frame.p_data, metadata_frame.length);
-            NDIlib_recv_free_metadata(m_p_recv, &metadata_frame);
-            return str;
-        }
-        break;
-    case NDIlib_frame_type_none:
-        break;
-    // The device has changed status in some way (see notes below)
-    case NDIlib_frame_type_status_change:
-        break;
+std::optional<std::chrono::steady_clock::time_point> MIDI_Sender::FlushExpired(std::chrono::steady_clock::time_point now) {
+    std::lock_guard lock(m_send_mutex);
+
+    if (m_send_length == 0) {
+        return std::nullopt;
+    }
+
+    if (now < m_batch_deadline) {
+        return m_batch_deadline;
     }
+
+    FlushLocked();
     return std::nullopt;
 }
 
-std::vector<uint8_t> NDI_MIDI_Manager::ParseMIDIMessage(const std::string_view& message) const {
-    auto data = std::vector<uint8_t>();
+void MIDI_Sender::PollConnections() {
+    // counted under the lock, SendMIDI may have counted a newer connection in between
+    std::lock_guard lock(m_send_mutex);
 
-    if (message.length() < 13) {
-        return data;
+    const int connections = m_p_sender->GetConnectionCount(0);
+    const int previous    = m_stats.connections;
+    m_stats.connections   = connections;
+
+    if (connections > previous) {
+        SendStateLocked(previous == 0);
     }
+}
 
-    if (message.substr(0, 6).compare("<MIDI>") != 0 || message.substr(message.size() - 8, 7).compare("</MIDI>") != 0) {
-        return data;
+Sender_Stats MIDI_Sender::GetStats() const {
+    std::lock_guard lock(m_send_mutex);
+    return m_stats;
+}
+
+void MIDI_Sender::SendStateLocked(bool include_notes) {
+    // whatever is pending was already sent to the receivers connected before
+    FlushLocked();
+
+    m_state.ForEachMessage(include_notes, [this](std::span<const uint8_t> message) { AppendMIDIElement(message); });
+
+    if (m_send_length == 0) {
+        return;
     }
 
-    auto midi_hex_message = message.substr(6, message.size() - 14);
+    m_send_timecode = TIMECODE_SYNTHESIZE;
+    FlushLocked();
+    m_stats.resyncs++;
+}
+
+void MIDI_Sender::AppendMIDIElement(std::span<const uint8_t> data) {
+    const size_t element_size = MIDI_OPEN_TAG.size() + EncodedHexSize(data.size()) + MIDI_CLOSE_TAG.size();
 
-    for (size_t i = 0; i < midi_hex_message.size(); i += 2) {
-        data.push_back(
-            (uint8_t)(std::stoi(
-                          std::string(midi_hex_message.substr(i, 2)),
-                          nullptr, 16) &
-                      0xFF));
+    // + 1 for the null terminator NDI expects
+    if (m_send_buffer.size() < m_send_length + element_size + 1) {
+        m_send_buffer.resize(m_send_length + element_size + 1);
     }
 
-    return data;
+    char* p_out = m_send_buffer.data() + m_send_length;
+
+    p_out = std::copy(MIDI_OPEN_TAG.begin(), MIDI_OPEN_TAG.end(), p_out);
+    p_out += EncodeHex(data, p_out);
+    p_out  = std::copy(MIDI_CLOSE_TAG.begin(), MIDI_CLOSE_TAG.end(), p_out);
+    *p_out = '\0';
+
+    m_send_length += element_size;
+}
+
+void MIDI_Sender::FlushLocked() {
+    if (m_send_length == 0 || !m_p_sender) {
+        return;
+    }
+
+    m_p_sender->Send(std::string_view(m_send_buffer.data(), m_send_length), m_send_timecode);
+
+    m_send_length = 0;
+}
+
+void MIDI_Sender::BatchLoop(std::stop_token stop_token) {
+    ApplyThreadPolicy(Thread_Role::Send, "NDI batch");
+
+    std::unique_lock lock(m_send_mutex);
+
+    while (!stop_token.stop_requested()) {
+        // sleep until the first message of a batch arrives
+        if (!m_batch_cv.wait(lock, stop_token, [this] { return m_send_length > 0; })) {
+            break;
+        }
+
+        // then until its latency window has passed, unless SendMIDI flushed a full frame meanwhile
+        const auto deadline = m_batch_deadline;
+        m_batch_cv.wait_until(lock, stop_token, deadline, [this, deadline] {
+            return m_send_length == 0 || m_batch_deadline != deadline;
+        });
+
+        if (m_send_length > 0 && std::chrono::steady_clock::now() >= m_batch_deadline) {
+            FlushLocked();
+        }
+    }
+}
+
+MIDI_Parse_Status NDI_MIDI_Manager::ParseMIDIMessage(std::string_view message, MIDI_Frame& frame) {
+    frame.Clear();
+
+    const auto is_padding = [](char c) {
+        return c == '\0' || std::isspace(static_cast<unsigned char>(c));
+    };
+
+    // elements may be separated by whitespace and the frame length may include the null terminator
+    while (true) {
+        while (!message.empty() && is_padding(message.front())) {
+            message.remove_prefix(1);
+        }
+
+        if (message.empty()) {
+            break;
+        }
+
+        if (!message.starts_with(MIDI_OPEN_TAG)) {
+            frame.Clear();
+            return MIDI_Parse_Status::InvalidFrame;
+        }
+
+        message.remove_prefix(MIDI_OPEN_TAG.size());
+
+        const auto close = message.find(MIDI_CLOSE_TAG);
+
+        if (close == std::string_view::npos || close == 0) {
+            frame.Clear();
+            return MIDI_Parse_Status::InvalidFrame;
+        }
+
+        const auto   midi_hex_message = message.substr(0, close);
+        const size_t offset           = frame.bytes.size();
+
+        frame.bytes.resize(offset + midi_hex_message.size() / 2);
+
+        if (!DecodeHex(midi_hex_message, frame.bytes.data() + offset)) {
+            frame.Clear();
+            return MIDI_Parse_Status::InvalidHex;
+        }
+
+        frame.ends.push_back(static_cast<uint32_t>(frame.bytes.size()));
+
+        message.remove_prefix(close + MIDI_CLOSE_TAG.size());
+    }
+
+    return frame.Count() > 0 ? MIDI_Parse_Status::Ok : MIDI_Parse_Status::InvalidFrame;
 }
 
 MIDI_IO_MANAGER::MIDI_IO_MANAGER(const std::string_view& port_name)
     : MIDI_IO_MANAGER(std::wstring(port_name.begin(), port_name.end())) {}
 
-MIDI_IO_MANAGER::MIDI_IO_MANAGER(const std::wstring_view& port_name) {
+MIDI_IO_MANAGER::MIDI_IO_MANAGER(const std::wstring_view& port_name)
+    : m_virtual_port_name(port_name) {}
+
+bool MIDI_IO_MANAGER::OpenVirtualPort() {
+    if (m_p_port) {
+        return true;
+    }
+
+    Startup_Phase phase("virtual MIDI port");
 
+#ifdef _WIN32
     // MIDI Output via virtualMIDI
 
     WORD major, minor, release, build;
@@ -192,29 +509,71 @@ MIDI_IO_MANAGER::MIDI_IO_MANAGER(const std::wstring_view& port_name) {
 #endif
 
     m_p_port = virtualMIDICreatePortEx2(
-        port_name.data(),
+        m_virtual_port_name.c_str(),
         [](LPVM_MIDI_PORT midiPort,
            LPBYTE         midiDataBytes,
            DWORD          length,
            DWORD_PTR      dwCallbackInstance) {
+            // driver thread: only binary log records, formatting and printing happen on the log thread
             if ((NULL == midiDataBytes) || (0 == length)) {
-                std::println("empty command - driver was probably shut down!");
+                Log(Log_Level::Warning, Log_Event::VirtualPortShutdown);
                 return;
             }
 
             if (!virtualMIDISendData(midiPort, midiDataBytes, length)) {
-                std::println("error sending data: {}", GetLastError());
+                Log(Log_Level::Error, Log_Event::VirtualPortError, {}, GetLastError());
                 return;
             }
 
-            std::println("command: {}", binToStr(midiDataBytes, length));
+            Log(Log_Level::Debug, Log_Event::VirtualPortRX, std::span<const uint8_t>(midiDataBytes, length), length);
         },
         0, MAX_SYSEX_BUFFER, TE_VM_FLAGS_PARSE_RX);
 
     if (!m_p_port) {
         std::println("could not create port: {}", GetLastError());
+        return false;
+    }
+#else
+    // MIDI Output via a virtual RtMidi port, other clients connect to it like to a device
+    // names are widened byte by byte from the UTF-8 command line, so narrowing them again is lossless
+    std::string port_name;
+    port_name.reserve(m_virtual_port_name.size());
+    for (const wchar_t c : m_virtual_port_name) {
+        port_name.push_back(static_cast<char>(c));
     }
 
+    try {
+        auto midi_out = std::make_unique<RtMidiOut>(RtMidi::Api::UNSPECIFIED, "RtMidi Output Client");
+        midi_out->openVirtualPort(port_name);
+
+        // a failed send is reported through the log instead of an exception on the output thread
+        midi_out->setErrorCallback(
+            [](RtMidiError::Type type, const std::string&, void*) {
+                Log(Log_Level::Error, Log_Event::VirtualPortError, {}, static_cast<int64_t>(type));
+            },
+            nullptr);
+
+        if (midi_out->getCurrentApi() == RtMidi::RTMIDI_DUMMY) {
+            std::println("this build has no MIDI API, everything sent to {} is discarded", port_name);
+        }
+
+        m_p_port = std::move(midi_out);
+    } catch (RtMidiError& error) {
+        std::println("could not create port: {}", error.getMessage());
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+RtMidiIn* MIDI_IO_MANAGER::GetMIDIIn() {
+    if (m_p_midi_in) {
+        return m_p_midi_in.get();
+    }
+
+    Startup_Phase phase("RtMidi input");
+
     // MIDI Input via RtMidi
 
     std::vector<RtMidi::Api> apis;
@@ -234,46 +593,49 @@ MIDI_IO_MANAGER::MIDI_IO_MANAGER(const std::wstring_view& port_name) {
             1000);
     } catch (RtMidiError& error) {
         std::println("error creating RtMidiIn: {}", error.getMessage());
-        exit(EXIT_FAILURE);
-        return;
+        return nullptr;
     }
+
+    return m_p_midi_in.get();
 }
 
 MIDI_IO_MANAGER::~MIDI_IO_MANAGER() {
+#ifdef _WIN32
     if (m_p_port) {
         virtualMIDIClosePort(m_p_port);
     }
+#endif
 
     if (m_p_midi_in && m_p_midi_in->isPortOpen()) {
         m_p_midi_in->closePort();
     }
-}
 
-std::string MIDI_IO_MANAGER::binToStr(const uint8_t* data, DWORD length) {
-    std::string dumpBuffer;
-    dumpBuffer.reserve(MAX_SYSEX_BUFFER * 3);
-    for (DWORD i = 0; i < length; i++) {
-        dumpBuffer += std::format("{:02x}", data[i]);
-        if (i < length - 1) {
-            dumpBuffer += ":";
-        }
+#ifdef __linux__
+    // the input thread that writes it is gone once the input is
+    m_p_midi_in.reset();
+
+    if (m_ready_fd >= 0) {
+        close(m_ready_fd);
     }
-    return dumpBuffer;
+#endif
 }
 
 void MIDI_IO_MANAGER::UpdateMIDIPorts() {
+    m_port_names.clear();
+    m_n_ports = 0;
 
-    if (!m_p_midi_in) {
+    // without an input there are no ports to choose from
+    auto* midi_in = GetMIDIIn();
+    if (!midi_in) {
         return;
     }
 
-    m_port_names.clear();
-    m_n_ports = m_p_midi_in->getPortCount();
+    m_n_ports = midi_in->getPortCount();
 
     for (unsigned int i = 0; i < m_n_ports; i++) {
         std::string port_name("unknown");
         try {
-            port_name = m_p_midi_in->getPortName(i);
+            port_name = midi_in->getPortName(i);
         } catch (RtMidiError& error) {
             std::println("error getting port name: {}", error.getMessage());
         }
@@ -283,41 +645,127 @@ void MIDI_IO_MANAGER::UpdateMIDIPorts() {
 }
 
 bool MIDI_IO_MANAGER::OpenMIDIPort(uint32_t port_number) {
+    Startup_Phase phase("MIDI input port");
+
+    auto* p_midi_in = GetMIDIIn();
+    if (!p_midi_in) {
+        return false;
+    }
+    auto& midi_in = *p_midi_in;
+
+    RequestMIDIInputPolicy(midi_in);
+    midi_in.setOverflowCallback(LogQueueOverflow);
+
     try {
-        m_p_midi_in->openPort(port_number);
+        midi_in.openPort(port_number);
     } catch (RtMidiError& error) {
         error.printMessage();
         return false;
     }
 
-    m_p_midi_in->ignoreTypes(false, false, false);
+    midi_in.ignoreTypes(false, false, false);
+
+    RecordMIDIInputPolicy(midi_in, midi_in.getPortName(port_number));
 
     std::println("Reading MIDI from API {}, port {}",
-                 m_p_midi_in->getApiDisplayName(m_p_midi_in->getCurrentApi()),
-                 m_p_midi_in->getPortName(port_number));
+                 midi_in.getApiDisplayName(midi_in.getCurrentApi()),
+                 midi_in.getPortName(port_number));
 
     return true;
 }
 
-std::vector<uint8_t> MIDI_IO_MANAGER::ReceiveMIDI() {
-    if (!m_p_midi_in->isPortOpen()) {
-        return std::vector<uint8_t>();
+void MIDI_IO_MANAGER::CloseMIDIPort() {
+    if (!m_p_midi_in) {
+        return;
+    }
+
+    // closing the port joins the RtMidi input thread, so nothing is queued after this returns
+    if (m_p_midi_in->isPortOpen()) {
+        m_p_midi_in->closePort();
+    }
+}
+
+size_t MIDI_IO_MANAGER::ReceiveMIDI(MIDI_Batch& batch) {
+    if (!m_p_midi_in || !m_p_midi_in->isPortOpen()) {
+        batch.bytes.clear();
+        batch.infos.clear();
+        return 0;
     }
 
-    std::vector<unsigned char> message;
-    double                     timestamp = 0.0;
+    return m_p_midi_in->getMessages(&batch.bytes, &batch.infos);
+}
+
+bool MIDI_IO_MANAGER::WaitForMIDI(std::chrono::milliseconds timeout) {
+    if (!m_p_midi_in || !m_p_midi_in->isPortOpen()) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+
+    return m_p_midi_in->waitForMessage(static_cast<unsigned int>(timeout.count()));
+}
+
+#ifdef __linux__
+int MIDI_IO_MANAGER::GetReadyFd() {
+    if (m_ready_fd >= 0) {
+        return m_ready_fd;
+    }
+
+    auto* midi_in = GetMIDIIn();
+    if (!midi_in) {
+        return -1;
+    }
 
-    timestamp = m_p_midi_in->getMessage(&message);
+    m_ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_ready_fd < 0) {
+        std::println("cannot create the MIDI input eventfd: {}", std::strerror(errno));
+        return -1;
+    }
 
-    return message;
+    midi_in->setQueueNotifier(NotifyReady, this);
+    return m_ready_fd;
 }
 
+std::chrono::steady_clock::time_point MIDI_IO_MANAGER::ClearReady() {
+    if (m_ready_fd < 0) {
+        return {};
+    }
+
+    uint64_t   count = 0;
+    const auto res   = read(m_ready_fd, &count, sizeof(count));
+    (void)res;
+
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_ready_time.exchange(0, std::memory_order_relaxed)));
+}
+
+void MIDI_IO_MANAGER::NotifyReady(void* user_data) {
+    auto* self = static_cast<MIDI_IO_MANAGER*>(user_data);
+
+    // only the first notification before ClearReady stamps the time, so the wake latency covers the longest wait
+    int64_t expected = 0;
+    self->m_ready_time.compare_exchange_strong(expected, std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+    const uint64_t one = 1;
+    const auto     res = write(self->m_ready_fd, &one, sizeof(one));
+    (void)res;
+}
+#endif
+
 bool MIDI_IO_MANAGER::SendMIDI(const std::span<uint8_t>& data) const {
+    if (!m_p_port) {
+        return false;
+    }
+
+#ifdef _WIN32
     bool res = virtualMIDISendData(m_p_port, data.data(), (DWORD)data.size());
 
     if (!res) {
-        std::println("error sending data: {}", GetLastError());
+        Log(Log_Level::Error, Log_Event::VirtualPortError, {}, GetLastError());
     }
 
     return res;
+#else
+    // errors end up in the callback set by OpenVirtualPort
+    m_p_port->sendMessage(data.data(), data.size());
+    return true;
+#endif
 }
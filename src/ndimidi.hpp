@@ -1,8 +1,155 @@
+#pragma once
+
 #include "pch.hpp"
+#include "midi_state.hpp"
+#include "source_discovery.hpp"
+#include "transport.hpp"
+
+// a single MIDI message is sent as <MIDI>hex bytes</MIDI>, batched frames contain several of these elements
+constexpr std::string_view MIDI_OPEN_TAG  = "<MIDI>";
+constexpr std::string_view MIDI_CLOSE_TAG = "</MIDI>";
+
+enum class MIDI_Parse_Status : uint8_t {
+    Ok,
+    NoFrame,      // nothing (or no metadata) was received
+    InvalidFrame, // not a <MIDI></MIDI> element
+    InvalidHex,   // odd number of digits or a non hex character
+};
+
+// all MIDI messages of one metadata frame, stored back to back in a reusable buffer
+struct MIDI_Frame {
+    std::vector<uint8_t>  bytes;
+    std::vector<uint32_t> ends; // end offset of every message in bytes
+
+    // capture time of the first message on the sender, see SteadyToTimecode
+    int64_t timecode = 0;
+
+    void Clear() {
+        bytes.clear();
+        ends.clear();
+        timecode = 0;
+    }
+
+    [[nodiscard]]
+    size_t Count() const {
+        return ends.size();
+    }
+
+    [[nodiscard]]
+    std::span<uint8_t> Message(size_t index) {
+        const uint32_t begin = index == 0 ? 0 : ends[index - 1];
+        return std::span<uint8_t>(bytes.data() + begin, ends[index] - begin);
+    }
+};
+
+// one receive connection, decodes the metadata frames of a single source
+class MIDI_Receiver {
+public:
+    explicit MIDI_Receiver(std::unique_ptr<Metadata_Receiver> receiver);
+    ~MIDI_Receiver();
+
+    MIDI_Receiver(const MIDI_Receiver&)            = delete;
+    MIDI_Receiver& operator=(const MIDI_Receiver&) = delete;
+
+    // nullptr disconnects
+    void Connect(const MIDI_Source* source) const;
+
+    // waits up to wait_time_ms for a metadata frame and decodes all its messages into frame
+    // the buffers of frame are reused across calls
+    [[nodiscard]]
+    MIDI_Parse_Status ReceiveMIDI(uint32_t wait_time_ms, MIDI_Frame& frame) const;
+
+    [[nodiscard]]
+    uint64_t GetDroppedFrames() const;
+
+    // see Metadata_Receiver::GetReadyFd
+    [[nodiscard]]
+    int GetReadyFd() const;
+
+    // see Metadata_Receiver::GetConnectionCount
+    [[nodiscard]]
+    int GetConnectionCount() const;
+
+    // invoked by ReceiveMIDI on its thread whenever the transport reports a status change of the connection,
+    // e.g. the source went away; to be set while nothing receives
+    void SetStatusCallback(std::function<void()> callback);
+
+private:
+    std::unique_ptr<Metadata_Receiver> m_p_receiver;
+    std::function<void()>              m_status_callback;
+};
+
+struct Sender_Stats {
+    int      connections = 0; // receivers as of the last poll
+    uint64_t skipped     = 0; // messages not encoded because nobody was listening
+    uint64_t resyncs     = 0; // state snapshots sent to receivers that connected
+};
+
+// one send endpoint, encodes MIDI messages into metadata frames and optionally batches them
+// only encodes while a receiver is connected, otherwise it just tracks the MIDI state and sends that
+// as a single frame once a receiver connects, see PollConnections
+class MIDI_Sender {
+public:
+    explicit MIDI_Sender(std::unique_ptr<Metadata_Sender> sender);
+    ~MIDI_Sender();
+
+    MIDI_Sender(const MIDI_Sender&)            = delete;
+    MIDI_Sender& operator=(const MIDI_Sender&) = delete;
+
+    // timecode is the capture time of the message, a batched frame carries the one of its first message
+    void SendMIDI(const std::span<uint8_t>& data, int64_t timecode = TIMECODE_SYNTHESIZE);
+
+    // coalesces messages into one metadata frame until max_latency has passed since the first
+    // pending message or the frame would grow beyond max_frame_size, a zero latency disables batching
+    // without own_thread nothing sends an expired batch but FlushExpired, for owners that already run a loop
+    void SetBatching(std::chrono::microseconds max_latency, size_t max_frame_size, bool own_thread = true);
+
+    // sends the pending batch right away
+    void FlushMIDI();
+
+    // sends the pending batch if its latency window has passed by now, returns the deadline of the batch still pending
+    std::optional<std::chrono::steady_clock::time_point> FlushExpired(std::chrono::steady_clock::time_point now);
+
+    // updates the connection count and resyncs receivers that connected since the last poll, called by a
+    // thread shared by every sender of the process
+    // the held notes are only part of the resync when nobody was listening before, the receivers already
+    // connected would play them again: a receiver that joins while another one listens does not get the notes
+    // held at that moment, it misses their sound and later sees note offs for notes it never saw start
+    void PollConnections();
+
+    [[nodiscard]]
+    Sender_Stats GetStats() const;
+
+private:
+    std::unique_ptr<Metadata_Sender> m_p_sender;
+
+    // guarded by m_send_mutex
+    MIDI_State_Snapshot m_state;
+    Sender_Stats        m_stats;
+
+    // encoded metadata frame, reused across SendMIDI calls and only ever grown
+    std::vector<char> m_send_buffer;
+    size_t            m_send_length   = 0;
+    int64_t           m_send_timecode = TIMECODE_SYNTHESIZE;
 
+    mutable std::mutex                    m_send_mutex;
+    std::condition_variable_any           m_batch_cv;
+    std::chrono::microseconds             m_batch_max_latency{0};
+    size_t                                m_batch_max_frame_size = 0;
+    std::chrono::steady_clock::time_point m_batch_deadline;
+    std::jthread                          m_batch_thread;
+
+    void AppendMIDIElement(std::span<const uint8_t> data);
+    void FlushLocked();
+    void SendStateLocked(bool include_notes);
+    void BatchLoop(std::stop_token stop_token);
+};
+
+// the discovery, the sender and the receiver are each created on first use, so a mode only pays for what it uses
+// and e.g. listing sources does not announce a sender on the network
 class NDI_MIDI_Manager {
 public:
-    NDI_MIDI_Manager(const std::string_view& send_name = "NDI MIDI");
+    NDI_MIDI_Manager(std::shared_ptr<MIDI_Transport> transport, const std::string_view& send_name = "NDI MIDI");
     ~NDI_MIDI_Manager();
 
     // delete copy constructor and assignment operator
@@ -14,37 +161,106 @@ public:
     NDI_MIDI_Manager& operator=(NDI_MIDI_Manager&&) = delete;
 
 public:
+    // waits until discovery settled and copies the sources it found, sorted by name
     void UpdateSources();
 
+    // runs from the first call for as long as the manager lives
     [[nodiscard]]
-    const std::vector<NDIlib_source_t>& GetSources() const {
-        return m_p_sources;
+    MIDI_Source_Discovery& GetDiscovery() const;
+
+    [[nodiscard]]
+    const std::vector<MIDI_Source>& GetSources() const {
+        return m_sources;
     }
 
-    void ConnectToSource(const NDIlib_source_t* source) const;
+    void ConnectToSource(const MIDI_Source* source) const;
 
     void DisconnectFromSource() const;
 
-    void SendMIDI(const std::span<uint8_t>& data) const;
+    // see MIDI_Sender
+    void SendMIDI(const std::span<uint8_t>& data, int64_t timecode = TIMECODE_SYNTHESIZE);
+
+    void SetBatching(std::chrono::microseconds max_latency, size_t max_frame_size, bool own_thread = true);
+
+    void FlushMIDI();
+
+    [[nodiscard]]
+    std::optional<std::chrono::steady_clock::time_point> FlushExpired(std::chrono::steady_clock::time_point now);
+
+    // empty if the sender was never used, only once nothing sends anymore
+    [[nodiscard]]
+    Sender_Stats GetSenderStats() const;
+
+    // receives from the source of ConnectToSource, see MIDI_Receiver::ReceiveMIDI
+    [[nodiscard]]
+    MIDI_Parse_Status ReceiveMIDI(uint32_t wait_time_ms, MIDI_Frame& frame) const;
+
+    [[nodiscard]]
+    const MIDI_Receiver& GetReceiver() const;
 
+    // an additional receiver for listening to several sources at once
     [[nodiscard]]
-    const std::optional<std::string> ReceiveMIDI(uint32_t wait_time_ms) const;
+    std::unique_ptr<MIDI_Receiver> CreateReceiver(std::string_view name = "NDI MIDI") const;
 
     [[nodiscard]]
-    std::vector<uint8_t> ParseMIDIMessage(const std::string_view& message) const;
+    static MIDI_Parse_Status ParseMIDIMessage(std::string_view message, MIDI_Frame& frame);
 
 private:
-    NDIlib_find_instance_t       m_p_find    = nullptr;
-    uint32_t                     m_n_sources = 0;
-    std::vector<NDIlib_source_t> m_p_sources;
+    std::shared_ptr<MIDI_Transport> m_p_transport;
+    std::string                     m_send_name;
+
+    // created by the getters below, the once flags make that safe from any thread
+    mutable std::once_flag                         m_discovery_once;
+    mutable std::unique_ptr<MIDI_Source_Discovery> m_p_discovery;
+    std::vector<MIDI_Source>                       m_sources;
+
+    mutable std::once_flag               m_sender_once;
+    mutable std::unique_ptr<MIDI_Sender> m_p_sender;
+
+    mutable std::once_flag                 m_receiver_once;
+    mutable std::unique_ptr<MIDI_Receiver> m_p_receiver;
 
-    NDIlib_send_instance_t m_p_send = nullptr;
+    [[nodiscard]]
+    MIDI_Sender& GetSender() const;
 
-    NDIlib_recv_instance_t m_p_recv = nullptr;
+    [[nodiscard]]
+    MIDI_Receiver& GetOwnReceiver() const;
 };
 
 #define MAX_SYSEX_BUFFER 65535
 
+// all MIDI messages drained from the input queue in one call, packed back to back in a reusable buffer
+struct MIDI_Batch {
+    std::vector<uint8_t>               bytes;
+    std::vector<RtMidiIn::MessageInfo> infos;
+
+    [[nodiscard]]
+    size_t Count() const {
+        return infos.size();
+    }
+
+    [[nodiscard]]
+    std::span<uint8_t> Message(size_t index) {
+        return std::span<uint8_t>(bytes.data() + infos[index].offset, infos[index].size);
+    }
+
+    // delta time to the previous message in seconds
+    [[nodiscard]]
+    double Timestamp(size_t index) const {
+        return infos[index].timeStamp;
+    }
+
+    // time the message was taken off the MIDI driver, as an NDI timecode
+    [[nodiscard]]
+    int64_t Timecode(size_t index) const {
+        const std::chrono::steady_clock::time_point capture_time(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(infos[index].captureTime)));
+        return SteadyToTimecode(capture_time);
+    }
+};
+
+// the virtual output port and the RtMidi input, neither exists before it is used: the port is created by
+// OpenVirtualPort, the input by the first call that needs it
 class MIDI_IO_MANAGER {
 
 public:
@@ -52,18 +268,39 @@ public:
     MIDI_IO_MANAGER(const std::wstring_view& port_name);
     ~MIDI_IO_MANAGER();
 
+    // creates the virtual port under the name given to the constructor, false if the driver refused
+    // a teVirtualMIDI port on Windows, a virtual RtMidi output (an ALSA sequencer port) elsewhere
+    bool OpenVirtualPort();
+
+    // needs OpenVirtualPort
     bool SendMIDI(const std::span<uint8_t>& data) const;
 
 private:
-    [[nodiscard]]
-    static std::string binToStr(const uint8_t* data, DWORD length);
+    std::wstring m_virtual_port_name;
 
+#ifdef _WIN32
     LPVM_MIDI_PORT m_p_port = nullptr;
+#else
+    std::unique_ptr<RtMidiOut> m_p_port;
+#endif
 
     std::unique_ptr<RtMidiIn> m_p_midi_in = nullptr;
     uint32_t                  m_n_ports   = 0;
     std::vector<std::string>  m_port_names;
 
+#ifdef __linux__
+    int m_ready_fd = -1;
+
+    // steady clock ticks of when NotifyReady made the descriptor readable, 0 while it is not
+    std::atomic<int64_t> m_ready_time = 0;
+
+    static void NotifyReady(void* user_data);
+#endif
+
+    // creates the input on first use, nullptr if RtMidi could not, the error is printed
+    [[nodiscard]]
+    RtMidiIn* GetMIDIIn();
+
 public:
     void UpdateMIDIPorts();
 
@@ -74,7 +311,26 @@ public:
     [[nodiscard]]
     bool OpenMIDIPort(uint32_t port_number);
 
-    std::vector<uint8_t> ReceiveMIDI();
+    void CloseMIDIPort();
+
+    // replaces the contents of batch with every pending message, returns the number of messages
+    // the batch keeps its capacity across calls
+    size_t ReceiveMIDI(MIDI_Batch& batch);
+
+    // blocks until a message is pending or the timeout passed
+    [[nodiscard]]
+    bool WaitForMIDI(std::chrono::milliseconds timeout);
+
+#ifdef __linux__
+    // an eventfd the RtMidi input thread makes readable when a message arrives in the empty input queue, for
+    // event loops like Event_Reactor, -1 if it cannot be created; must be called before OpenMIDIPort
+    // after ClearReady, drain with ReceiveMIDI until WaitForMIDI(0) is false, see RtMidiIn::setQueueNotifier
+    [[nodiscard]]
+    int GetReadyFd();
+
+    // returns when the RtMidi input thread made the descriptor readable, the clock's epoch if it was not
+    std::chrono::steady_clock::time_point ClearReady();
+#endif
 
     const std::unordered_map<int, std::string> apiMap{
         { RtMidi::MACOSX_CORE,      "OS-X CoreMIDI"},
@@ -1,33 +1,53 @@
 #pragma once
 
+#ifdef _WIN32
 #include <teVirtualMIDI.h>
+#endif
 
+// defined by CMake when the NDI SDK was found, always on Windows
+#ifdef MIDI_TO_NDI_WITH_NDI
 #include <Processing.NDI.Lib.h>
+#endif
 
 #ifdef _DEBUG
 #define RTMIDI_DEBUG
 #endif
 
-#define __WINDOWS_MM__
-
+// the RtMidi API (__WINDOWS_MM__ or __LINUX_ALSA__) is selected by CMake, RtMidi falls back to its dummy API
 #include "RtMidi.h"
 
 #include <cstdlib>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <charconv>
+#include <bit>
 #include <print>
 #include <string>
 #include <format>
 #include <memory>
 #include <vector>
+#include <deque>
 #include <span>
 #include <optional>
 #include <string_view>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
+#include <functional>
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <filesystem>
 #include <csignal>
 
 #include <boost/program_options.hpp>
 
-#include <conio.h>
\ No newline at end of file
+#ifdef _WIN32
+#include <conio.h>
+#endif
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "playout.hpp"
+#include "thread_util.hpp"
+
+#ifdef _WIN32
+#include <mmsystem.h>
+#endif
+
+// messages held at most, a frame that does not fit is dropped except for what releases notes
+constexpr size_t PLAYOUT_QUEUE_LIMIT = 4096;
+
+// the last stretch before a playout time is spun instead of slept, OS timers are too coarse for MIDI timing
+constexpr auto PLAYOUT_SPIN_WINDOW = std::chrono::milliseconds(1);
+
+// the smallest transit time is forgotten after this long, so clock drift and route changes are followed
+constexpr int64_t PLAYOUT_BASE_WINDOW = Timecode_Duration(std::chrono::seconds(10)).count();
+
+// the delay grows to this multiple of the measured input jitter, up to the maximum
+constexpr double PLAYOUT_JITTER_HEADROOM = 3.0;
+constexpr auto   PLAYOUT_MAX_DELAY       = std::chrono::microseconds(500'000);
+
+[[nodiscard]]
+static bool HasTimecode(int64_t timecode) {
+    return timecode != 0 && timecode != TIMECODE_SYNTHESIZE;
+}
+
+// note offs, sustain, all sound off and all notes off (mode changes included), dropping them leaves notes hanging
+[[nodiscard]]
+static bool ReleasesNotes(std::span<const uint8_t> message) {
+    if (message.size() < 3) {
+        return false;
+    }
+
+    switch (message[0] & 0xF0) {
+    case 0x80:
+        return true;
+    case 0x90:
+        return message[2] == 0;
+    case 0xB0:
+        return message[1] == 64 || message[1] == 120 || message[1] >= 123;
+    default:
+        return false;
+    }
+}
+
+MIDI_Playout_Scheduler::MIDI_Playout_Scheduler(std::chrono::microseconds target_delay, Output output)
+    : m_output(std::move(output))
+    , m_target_delay(target_delay) {
+#ifdef _WIN32
+    // 1 ms scheduler ticks for the coarse part of the wait
+    timeBeginPeriod(1);
+#endif
+    m_stats.delay = m_target_delay;
+    m_thread      = std::jthread([this](std::stop_token stop_token) { PlayoutLoop(stop_token); });
+}
+
+MIDI_Playout_Scheduler::~MIDI_Playout_Scheduler() {
+    m_thread.request_stop();
+    m_thread.join();
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void MIDI_Playout_Scheduler::Schedule(MIDI_Frame& frame, std::chrono::steady_clock::time_point arrival) {
+    std::lock_guard lock(m_mutex);
+
+    const auto due = PlayoutTime(frame.timecode, arrival);
+
+    // a frame goes in whole or not at all, messages missing from the middle of one could leave its notes hanging
+    const bool fits = m_queue.size() + frame.Count() <= PLAYOUT_QUEUE_LIMIT;
+
+    for (size_t i = 0; i < frame.Count(); i++) {
+        const auto message = frame.Message(i);
+
+        if (!fits && !ReleasesNotes(message)) {
+            m_stats.dropped++;
+            continue;
+        }
+
+        Playout_Entry entry;
+        entry.due      = due;
+        entry.timecode = frame.timecode;
+
+        // reuse the buffers of messages that were played out already
+        if (!m_free_buffers.empty()) {
+            entry.bytes = std::move(m_free_buffers.back());
+            m_free_buffers.pop_back();
+        }
+
+        entry.bytes.assign(message.begin(), message.end());
+
+        m_queue.push_back(std::move(entry));
+    }
+
+    m_stats.max_depth = std::max(m_stats.max_depth, m_queue.size());
+
+    m_cv.notify_one();
+}
+
+Playout_Stats MIDI_Playout_Scheduler::GetStats() const {
+    std::lock_guard lock(m_mutex);
+
+    Playout_Stats stats = m_stats;
+    stats.input_jitter  = std::chrono::duration_cast<std::chrono::microseconds>(Timecode_Duration(static_cast<int64_t>(m_input_jitter)));
+    stats.output_jitter = std::chrono::duration_cast<std::chrono::microseconds>(Timecode_Duration(static_cast<int64_t>(m_output_jitter)));
+    return stats;
+}
+
+std::chrono::steady_clock::time_point MIDI_Playout_Scheduler::PlayoutTime(int64_t timecode, std::chrono::steady_clock::time_point arrival) {
+    // frames without a usable timecode go out right away
+    if (!HasTimecode(timecode)) {
+        return std::max(arrival, m_last_due);
+    }
+
+    const int64_t arrival_timecode = SteadyToTimecode(arrival);
+
+    // includes the clock offset between the hosts, which cancels out against the base transit
+    const int64_t transit = arrival_timecode - timecode;
+
+    if (!m_has_reference) {
+        m_has_reference  = true;
+        m_base_transit   = transit;
+        m_window_transit = transit;
+        m_last_transit   = transit;
+        m_window_start   = arrival_timecode;
+    }
+
+    // RFC 3550: J += (|D| - J) / 16 with D the change in transit time between frames
+    m_input_jitter += (std::abs(static_cast<double>(transit - m_last_transit)) - m_input_jitter) / 16.0;
+    m_last_transit = transit;
+
+    m_base_transit   = std::min(m_base_transit, transit);
+    m_window_transit = std::min(m_window_transit, transit);
+
+    if (arrival_timecode - m_window_start > PLAYOUT_BASE_WINDOW) {
+        m_base_transit   = m_window_transit;
+        m_window_transit = transit;
+        m_window_start   = arrival_timecode;
+    }
+
+    const auto jitter_delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        Timecode_Duration(static_cast<int64_t>(m_input_jitter * PLAYOUT_JITTER_HEADROOM)));
+
+    m_stats.delay = std::min(std::max(m_target_delay, jitter_delay), PLAYOUT_MAX_DELAY);
+
+    // frames that took longer than the fastest recent one are delayed that much less
+    const auto excess = std::chrono::duration_cast<std::chrono::steady_clock::duration>(Timecode_Duration(transit - m_base_transit));
+    auto       due    = arrival + m_stats.delay - excess;
+
+    if (due < arrival) {
+        m_stats.late++;
+        due = arrival;
+    }
+
+    // never reorder, even when the base transit just dropped
+    due        = std::max(due, m_last_due);
+    m_last_due = due;
+
+    return due;
+}
+
+void MIDI_Playout_Scheduler::PlayoutLoop(std::stop_token stop_token) {
+    ApplyThreadPolicy(Thread_Role::Output, "playout");
+
+    std::unique_lock lock(m_mutex);
+
+    while (!stop_token.stop_requested()) {
+        if (!m_cv.wait(lock, stop_token, [this] { return !m_queue.empty(); })) {
+            break;
+        }
+
+        // entries are only appended with non decreasing playout times, so the front stays the next one due
+        const auto due = m_queue.front().due;
+
+        if (std::chrono::steady_clock::now() < due - PLAYOUT_SPIN_WINDOW) {
+            m_cv.wait_until(lock, stop_token, due - PLAYOUT_SPIN_WINDOW, [] { return false; });
+            continue;
+        }
+
+        lock.unlock();
+        while (std::chrono::steady_clock::now() < due) {
+            std::this_thread::yield();
+        }
+        lock.lock();
+
+        // the lock is dropped while the output runs, so Schedule never waits for the MIDI driver
+        while (!m_queue.empty() && m_queue.front().due <= std::chrono::steady_clock::now()) {
+            Playout_Entry entry = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            lock.unlock();
+            const auto now = std::chrono::steady_clock::now();
+            m_output(entry.bytes);
+            lock.lock();
+
+            TrackOutput(entry, now);
+
+            entry.bytes.clear();
+            m_free_buffers.push_back(std::move(entry.bytes));
+        }
+    }
+}
+
+void MIDI_Playout_Scheduler::TrackOutput(const Playout_Entry& entry, std::chrono::steady_clock::time_point now) {
+    m_stats.messages++;
+    m_stats.max_lateness = std::max(m_stats.max_lateness, std::chrono::duration_cast<std::chrono::microseconds>(now - entry.due));
+
+    // jitter is measured per frame, the messages of one frame share its timecode
+    if (!HasTimecode(entry.timecode) || (m_has_output && entry.timecode == m_last_output_tc)) {
+        return;
+    }
+
+    const int64_t output_timecode = SteadyToTimecode(now);
+
+    if (m_has_output) {
+        const int64_t d = (output_timecode - m_last_output_time) - (entry.timecode - m_last_output_tc);
+        m_output_jitter += (std::abs(static_cast<double>(d)) - m_output_jitter) / 16.0;
+    }
+
+    m_has_output       = true;
+    m_last_output_time = output_timecode;
+    m_last_output_tc   = entry.timecode;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+
+struct Playout_Stats {
+    uint64_t messages = 0;
+    uint64_t late     = 0; // frames that arrived after their playout time and went out right away
+    uint64_t dropped  = 0; // messages of frames that found the buffer full, note offs always go in
+
+    // RFC 3550 interarrival jitter of the received frames against their timecodes
+    std::chrono::microseconds input_jitter{0};
+    // the same estimator applied to the actual output times
+    std::chrono::microseconds output_jitter{0};
+    // worst time an output went out behind its playout time
+    std::chrono::microseconds max_lateness{0};
+
+    std::chrono::microseconds delay{0};
+    size_t                    max_depth = 0;
+};
+
+// jitter buffer for received MIDI: every frame is delayed so that it goes out at its sender timecode
+// plus a fixed offset, which turns network bunching back into the original message spacing
+// the offset is the smallest transit time seen recently plus a delay that starts at the target and
+// grows when the measured input jitter needs more headroom
+class MIDI_Playout_Scheduler {
+public:
+    using Output = std::function<void(std::span<uint8_t> data)>;
+
+    // output is invoked on the playout thread
+    MIDI_Playout_Scheduler(std::chrono::microseconds target_delay, Output output);
+    ~MIDI_Playout_Scheduler();
+
+    MIDI_Playout_Scheduler(const MIDI_Playout_Scheduler&)            = delete;
+    MIDI_Playout_Scheduler& operator=(const MIDI_Playout_Scheduler&) = delete;
+
+    // queues all messages of frame, arrival is the time the frame was captured
+    void Schedule(MIDI_Frame& frame, std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now());
+
+    [[nodiscard]]
+    Playout_Stats GetStats() const;
+
+private:
+    struct Playout_Entry {
+        std::chrono::steady_clock::time_point due;
+        int64_t                               timecode = 0;
+        std::vector<uint8_t>                  bytes;
+    };
+
+    Output                    m_output;
+    std::chrono::microseconds m_target_delay;
+
+    mutable std::mutex                m_mutex;
+    std::condition_variable_any       m_cv;
+    std::deque<Playout_Entry>         m_queue;
+    std::vector<std::vector<uint8_t>> m_free_buffers;
+
+    // receive side state, in timecode units
+    bool                                  m_has_reference  = false;
+    int64_t                               m_base_transit   = 0;
+    int64_t                               m_window_transit = 0;
+    int64_t                               m_last_transit   = 0;
+    int64_t                               m_window_start   = 0;
+    double                                m_input_jitter   = 0.0;
+    std::chrono::steady_clock::time_point m_last_due;
+
+    // playout side state, in timecode units
+    bool    m_has_output       = false;
+    int64_t m_last_output_time = 0;
+    int64_t m_last_output_tc   = 0;
+    double  m_output_jitter    = 0.0;
+
+    Playout_Stats m_stats;
+
+    std::jthread m_thread;
+
+    [[nodiscard]]
+    std::chrono::steady_clock::time_point PlayoutTime(int64_t timecode, std::chrono::steady_clock::time_point arrival);
+    void PlayoutLoop(std::stop_token stop_token);
+    void TrackOutput(const Playout_Entry& entry, std::chrono::steady_clock::time_point now);
+};
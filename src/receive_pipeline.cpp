@@ -0,0 +1,170 @@
+#include "receive_pipeline.hpp"
+
+// frames buffered per source between the stages, NDI keeps queueing on its side while this is full
+constexpr size_t RECEIVE_QUEUE_FRAMES = 256;
+
+MIDI_Receive_Pipeline::Capture_Stage::Capture_Stage(const MIDI_Receiver* p_receiver)
+    : p_receiver(p_receiver)
+    , ring(RECEIVE_QUEUE_FRAMES) {}
+
+MIDI_Receive_Pipeline::MIDI_Receive_Pipeline(std::vector<const MIDI_Receiver*> receivers, Output output)
+    : m_output(std::move(output)) {
+    for (const auto* p_receiver : receivers) {
+        m_stages.push_back(std::make_unique<Capture_Stage>(p_receiver));
+    }
+
+    m_output_thread = std::jthread([this](std::stop_token stop_token) { OutputLoop(stop_token); });
+
+    for (auto& stage : m_stages) {
+        stage->thread = std::jthread([this, &stage = *stage](std::stop_token stop_token) { CaptureLoop(stop_token, stage); });
+    }
+}
+
+MIDI_Receive_Pipeline::~MIDI_Receive_Pipeline() {
+    for (auto& stage : m_stages) {
+        stage->thread.request_stop();
+    }
+    for (auto& stage : m_stages) {
+        stage->thread.join();
+    }
+    m_output_thread.request_stop();
+    m_output_thread.join();
+}
+
+std::vector<Receive_Stats> MIDI_Receive_Pipeline::GetStats() const {
+    std::vector<Receive_Stats> all_stats;
+    all_stats.reserve(m_stages.size());
+
+    for (const auto& stage : m_stages) {
+        Receive_Stats stats;
+        stats.frames             = stage->frames.load(std::memory_order_relaxed);
+        stats.messages           = stage->messages.load(std::memory_order_relaxed);
+        stats.bytes              = stage->bytes.load(std::memory_order_relaxed);
+        stats.invalid_frames     = stage->invalid_frames.load(std::memory_order_relaxed);
+        stats.dropped_frames     = stage->p_receiver->GetDroppedFrames();
+        stats.depth              = stage->ring.Size();
+        stats.max_depth          = stage->max_depth.load(std::memory_order_relaxed);
+        stats.capture_stalls     = stage->capture_stalls.load(std::memory_order_relaxed);
+        stats.capture_stall_time = std::chrono::microseconds(stage->capture_stall_us.load(std::memory_order_relaxed));
+        stats.max_capture_stall  = std::chrono::microseconds(stage->max_capture_stall_us.load(std::memory_order_relaxed));
+        stats.max_output_time    = std::chrono::microseconds(stage->max_output_us.load(std::memory_order_relaxed));
+        all_stats.push_back(stats);
+    }
+
+    return all_stats;
+}
+
+std::optional<std::chrono::steady_clock::time_point> MIDI_Receive_Pipeline::GetFirstFrameTime() const {
+    const auto ticks = m_first_frame_ticks.load(std::memory_order_relaxed);
+
+    if (ticks == 0) {
+        return std::nullopt;
+    }
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(ticks));
+}
+
+void MIDI_Receive_Pipeline::CaptureLoop(std::stop_token stop_token, Capture_Stage& stage) {
+    ApplyThreadPolicy(Thread_Role::Capture, "NDI capture");
+
+    std::stop_callback wake(stop_token, [&stage] {
+        stage.popped.fetch_add(1, std::memory_order_release);
+        stage.popped.notify_one();
+    });
+
+    while (!stop_token.stop_requested()) {
+        Captured_Frame* slot = stage.ring.BeginPush();
+
+        if (!slot) {
+            // the output stage is behind, wait for it rather than dropping MIDI
+            const auto stall_start = std::chrono::steady_clock::now();
+
+            while (!slot && !stop_token.stop_requested()) {
+                const uint32_t popped = stage.popped.load(std::memory_order_acquire);
+                slot                  = stage.ring.BeginPush();
+                if (!slot) {
+                    stage.popped.wait(popped, std::memory_order_acquire);
+                }
+            }
+
+            const int64_t stall_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stall_start).count();
+            stage.capture_stalls.fetch_add(1, std::memory_order_relaxed);
+            stage.capture_stall_us.fetch_add(stall_us, std::memory_order_relaxed);
+            stage.max_capture_stall_us.store(std::max(stage.max_capture_stall_us.load(std::memory_order_relaxed), stall_us), std::memory_order_relaxed);
+
+            if (!slot) {
+                break;
+            }
+        }
+
+        // decoded straight into the slot, whose buffers are reused once the output stage is done with them
+        const auto status = stage.p_receiver->ReceiveMIDI(100, slot->frame);
+        if (status != MIDI_Parse_Status::Ok) {
+            if (status != MIDI_Parse_Status::NoFrame) {
+                stage.invalid_frames.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+
+        slot->arrival = std::chrono::steady_clock::now();
+
+        // frames without a sender timecode are ordered by their arrival
+        const bool has_timecode = slot->frame.timecode != 0 && slot->frame.timecode != TIMECODE_SYNTHESIZE;
+        slot->order             = has_timecode ? slot->frame.timecode : SteadyToTimecode(slot->arrival);
+
+        stage.ring.CommitPush();
+        m_pushed.fetch_add(1, std::memory_order_release);
+        m_pushed.notify_one();
+
+        stage.max_depth.store(std::max(stage.max_depth.load(std::memory_order_relaxed), stage.ring.Size()), std::memory_order_relaxed);
+    }
+}
+
+void MIDI_Receive_Pipeline::OutputLoop(std::stop_token stop_token) {
+    ApplyThreadPolicy(Thread_Role::Output, "MIDI output");
+
+    std::stop_callback wake(stop_token, [this] {
+        m_pushed.fetch_add(1, std::memory_order_release);
+        m_pushed.notify_one();
+    });
+
+    while (!stop_token.stop_requested()) {
+        const uint32_t pushed = m_pushed.load(std::memory_order_acquire);
+
+        // merge: the earliest of the frames queued right now, a source that has nothing queued does not hold up the others
+        size_t          source = 0;
+        Captured_Frame* slot   = nullptr;
+
+        for (size_t i = 0; i < m_stages.size(); i++) {
+            Captured_Frame* front = m_stages[i]->ring.Front();
+            if (front && (!slot || front->order < slot->order)) {
+                source = i;
+                slot   = front;
+            }
+        }
+
+        if (!slot) {
+            m_pushed.wait(pushed, std::memory_order_acquire);
+            continue;
+        }
+
+        Capture_Stage& stage = *m_stages[source];
+
+        const auto output_start = std::chrono::steady_clock::now();
+        m_output(source, slot->frame, slot->arrival);
+        const auto    output_end = std::chrono::steady_clock::now();
+        const int64_t output_us  = std::chrono::duration_cast<std::chrono::microseconds>(output_end - output_start).count();
+
+        if (m_first_frame_ticks.load(std::memory_order_relaxed) == 0) {
+            m_first_frame_ticks.store(output_end.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+
+        stage.frames.fetch_add(1, std::memory_order_relaxed);
+        stage.messages.fetch_add(slot->frame.Count(), std::memory_order_relaxed);
+        stage.bytes.fetch_add(slot->frame.bytes.size(), std::memory_order_relaxed);
+        stage.max_output_us.store(std::max(stage.max_output_us.load(std::memory_order_relaxed), output_us), std::memory_order_relaxed);
+
+        stage.ring.Pop();
+        stage.popped.fetch_add(1, std::memory_order_release);
+        stage.popped.notify_one();
+    }
+}
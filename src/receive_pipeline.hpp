@@ -0,0 +1,99 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+#include "spsc_ring.hpp"
+#include "thread_util.hpp"
+
+// per source
+struct Receive_Stats {
+    uint64_t frames         = 0;
+    uint64_t messages       = 0;
+    uint64_t bytes          = 0;
+    uint64_t invalid_frames = 0; // metadata that was no valid <MIDI> frame
+    uint64_t dropped_frames = 0; // lost by the transport before capture
+
+    size_t depth     = 0; // frames waiting for the output stage right now
+    size_t max_depth = 0;
+
+    // times the capture stage found the queue full and had to wait for the output stage
+    uint64_t                  capture_stalls = 0;
+    std::chrono::microseconds capture_stall_time{0};
+    std::chrono::microseconds max_capture_stall{0};
+
+    // slowest single frame in the output stage
+    std::chrono::microseconds max_output_time{0};
+};
+
+// splits reception into one capture thread per source (NDI capture and parsing) and a single output thread,
+// joined by bounded lock-free queues, so a slow MIDI port write does not hold up NDI capture and vice versa
+// the output thread merges the sources, always taking the queued frame with the earliest timecode
+class MIDI_Receive_Pipeline {
+public:
+    // invoked on the output thread for every received frame together with the index of its source
+    // and the time it was captured
+    using Output = std::function<void(size_t source, MIDI_Frame& frame, std::chrono::steady_clock::time_point arrival)>;
+
+    // the receivers have to be connected and outlive the pipeline
+    // the threads run with the Capture and Output policies, see SetThreadPolicy
+    MIDI_Receive_Pipeline(std::vector<const MIDI_Receiver*> receivers, Output output);
+    ~MIDI_Receive_Pipeline();
+
+    MIDI_Receive_Pipeline(const MIDI_Receive_Pipeline&)            = delete;
+    MIDI_Receive_Pipeline& operator=(const MIDI_Receive_Pipeline&) = delete;
+
+    // in the order of the receivers
+    [[nodiscard]]
+    std::vector<Receive_Stats> GetStats() const;
+
+    // when the first frame of any source went out, nullopt before that
+    [[nodiscard]]
+    std::optional<std::chrono::steady_clock::time_point> GetFirstFrameTime() const;
+
+private:
+    struct Captured_Frame {
+        MIDI_Frame                            frame;
+        std::chrono::steady_clock::time_point arrival;
+        int64_t                               order = 0; // timecode the merge sorts by
+    };
+
+    struct Capture_Stage {
+        explicit Capture_Stage(const MIDI_Receiver* p_receiver);
+
+        const MIDI_Receiver*      p_receiver;
+        SPSC_Ring<Captured_Frame> ring;
+
+        // bumped after every pop, and on stop, so the capture thread can sleep on it while the ring is full
+        std::atomic<uint32_t> popped = 0;
+
+        // written by the capture thread
+        std::atomic<uint64_t> invalid_frames       = 0;
+        std::atomic<size_t>   max_depth            = 0;
+        std::atomic<uint64_t> capture_stalls       = 0;
+        std::atomic<int64_t>  capture_stall_us     = 0;
+        std::atomic<int64_t>  max_capture_stall_us = 0;
+
+        // written by the output thread
+        std::atomic<uint64_t> frames        = 0;
+        std::atomic<uint64_t> messages      = 0;
+        std::atomic<uint64_t> bytes         = 0;
+        std::atomic<int64_t>  max_output_us = 0;
+
+        std::jthread thread;
+    };
+
+    Output m_output;
+
+    std::vector<std::unique_ptr<Capture_Stage>> m_stages;
+
+    // bumped by every capture thread after a push, and on stop, so the output thread can sleep on it
+    std::atomic<uint32_t> m_pushed = 0;
+
+    // steady clock ticks of the first output, 0 until then, written by the output thread
+    std::atomic<std::chrono::steady_clock::rep> m_first_frame_ticks = 0;
+
+    std::jthread m_output_thread;
+
+    void CaptureLoop(std::stop_token stop_token, Capture_Stage& stage);
+    void OutputLoop(std::stop_token stop_token);
+};
@@ -0,0 +1,450 @@
+#include "routing.hpp"
+
+constexpr std::pair<std::string_view, uint16_t> ROUTE_TYPE_NAMES[] = {
+    {          "note-off",                             ROUTE_NOTE_OFF},
+    {           "note-on",                              ROUTE_NOTE_ON},
+    {              "note",               ROUTE_NOTE_OFF | ROUTE_NOTE_ON},
+    {   "poly-aftertouch",                      ROUTE_POLY_AFTERTOUCH},
+    {                "cc",                       ROUTE_CONTROL_CHANGE},
+    {           "program",                       ROUTE_PROGRAM_CHANGE},
+    {"channel-aftertouch",                   ROUTE_CHANNEL_AFTERTOUCH},
+    {         "pitchbend",                           ROUTE_PITCH_BEND},
+    {             "sysex",                                ROUTE_SYSEX},
+    {            "common",                        ROUTE_SYSTEM_COMMON},
+    {          "realtime",                             ROUTE_REALTIME},
+    {               "all",                            ROUTE_ALL_TYPES},
+};
+
+[[nodiscard]]
+static std::string_view Trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// the next whitespace separated token, removed from text
+[[nodiscard]]
+static std::string_view NextToken(std::string_view& text) {
+    text = Trim(text);
+
+    size_t end = 0;
+    while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))) {
+        end++;
+    }
+
+    const auto token = text.substr(0, end);
+    text.remove_prefix(end);
+    return token;
+}
+
+[[nodiscard]]
+static std::optional<uint32_t> ParseNumber(std::string_view text) {
+    uint32_t value = 0;
+    if (text.empty() || std::from_chars(text.data(), text.data() + text.size(), value).ptr != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// "1-4,10" with channels counted from 1
+[[nodiscard]]
+static std::optional<uint16_t> ParseChannels(std::string_view list) {
+    uint16_t channels = 0;
+
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        const auto item  = list.substr(0, comma);
+        list             = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        const auto dash  = item.find('-');
+        const auto first = ParseNumber(item.substr(0, dash));
+        const auto last  = dash == std::string_view::npos ? first : ParseNumber(item.substr(dash + 1));
+
+        if (!first || !last || *first < 1 || *last > 16 || *first > *last) {
+            return std::nullopt;
+        }
+
+        for (uint32_t channel = *first; channel <= *last; channel++) {
+            channels |= static_cast<uint16_t>(1 << (channel - 1));
+        }
+    }
+
+    return channels;
+}
+
+[[nodiscard]]
+static std::optional<uint16_t> ParseTypes(std::string_view list) {
+    uint16_t types = 0;
+
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        const auto item  = list.substr(0, comma);
+        list             = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        const auto it = std::find_if(std::begin(ROUTE_TYPE_NAMES), std::end(ROUTE_TYPE_NAMES), [item](const auto& entry) { return entry.first == item; });
+
+        if (it == std::end(ROUTE_TYPE_NAMES)) {
+            return std::nullopt;
+        }
+
+        types |= it->second;
+    }
+
+    return types;
+}
+
+[[nodiscard]]
+static std::optional<size_t> FindEndpoint(const std::vector<Route_Endpoint>& endpoints, std::string_view id) {
+    const auto it = std::find_if(endpoints.begin(), endpoints.end(), [id](const Route_Endpoint& endpoint) { return endpoint.id == id; });
+    if (it == endpoints.end()) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(it - endpoints.begin());
+}
+
+std::optional<Routing_Config> ParseRoutingConfig(std::istream& input, std::string& error) {
+    Routing_Config config;
+    std::string    line;
+    size_t         line_number = 0;
+
+    const auto fail = [&error, &line_number](std::string_view message) {
+        error = std::format("{}: {}", line_number, message);
+        return std::nullopt;
+    };
+
+    while (std::getline(input, line)) {
+        line_number++;
+
+        std::string_view text = line;
+        text                  = Trim(text.substr(0, text.find('#')));
+
+        if (text.empty()) {
+            continue;
+        }
+
+        const auto keyword = NextToken(text);
+
+        if (keyword == "input" || keyword == "output") {
+            const bool is_input  = keyword == "input";
+            auto&      endpoints = is_input ? config.inputs : config.outputs;
+
+            Route_Endpoint endpoint;
+            endpoint.id = NextToken(text);
+
+            text = Trim(text);
+            if (endpoint.id.empty() || !text.starts_with('=')) {
+                return fail("expected <id> = <kind>:<name>");
+            }
+            text.remove_prefix(1);
+
+            const auto colon = text.find(':');
+            if (colon == std::string_view::npos) {
+                return fail("expected <kind>:<name>");
+            }
+
+            const auto kind = Trim(text.substr(0, colon));
+            endpoint.name   = Trim(text.substr(colon + 1));
+
+            if (is_input && kind == "midi") {
+                endpoint.kind = Route_Endpoint_Kind::MIDIPort;
+            } else if (is_input && kind == "ndi") {
+                endpoint.kind = Route_Endpoint_Kind::NDISource;
+            } else if (!is_input && kind == "ndi") {
+                endpoint.kind = Route_Endpoint_Kind::NDISender;
+            } else if (!is_input && kind == "port") {
+                endpoint.kind = Route_Endpoint_Kind::VirtualPort;
+            } else {
+                return fail(is_input ? "inputs are midi:<port> or ndi:<source>" : "outputs are ndi:<name> or port:<name>");
+            }
+
+            if (endpoint.name.empty()) {
+                return fail("missing name");
+            }
+
+            if (FindEndpoint(endpoints, endpoint.id)) {
+                return fail(std::format("{} declared twice", endpoint.id));
+            }
+
+            endpoints.push_back(std::move(endpoint));
+            continue;
+        }
+
+        if (keyword == "route") {
+            const auto input_id  = NextToken(text);
+            const auto arrow     = NextToken(text);
+            const auto output_id = NextToken(text);
+
+            if (arrow != "->") {
+                return fail("expected <input> -> <output>");
+            }
+
+            const auto input  = FindEndpoint(config.inputs, input_id);
+            const auto output = FindEndpoint(config.outputs, output_id);
+
+            if (!input) {
+                return fail(std::format("unknown input {}", input_id));
+            }
+            if (!output) {
+                return fail(std::format("unknown output {}", output_id));
+            }
+
+            Route route;
+            route.input  = *input;
+            route.output = *output;
+
+            for (auto option = NextToken(text); !option.empty(); option = NextToken(text)) {
+                if (option.starts_with("channels=")) {
+                    const auto channels = ParseChannels(option.substr(9));
+                    if (!channels) {
+                        return fail("channels are 1 to 16, e.g. channels=1-4,10");
+                    }
+                    route.channels = *channels;
+                } else if (option.starts_with("types=")) {
+                    const auto types = ParseTypes(option.substr(6));
+                    if (!types) {
+                        return fail("unknown message type, e.g. types=note,cc,pitchbend");
+                    }
+                    route.types = *types;
+                } else {
+                    return fail(std::format("unknown route option {}", option));
+                }
+            }
+
+            config.routes.push_back(route);
+            continue;
+        }
+
+        return fail(std::format("unknown keyword {}", keyword));
+    }
+
+    if (config.outputs.size() > MAX_ROUTE_OUTPUTS) {
+        return fail(std::format("at most {} outputs", MAX_ROUTE_OUTPUTS));
+    }
+
+    return config;
+}
+
+std::optional<Routing_Config> LoadRoutingConfig(const std::filesystem::path& path) {
+    std::ifstream file(path);
+
+    if (!file) {
+        std::println("could not open routing config {}", path.string());
+        return std::nullopt;
+    }
+
+    std::string error;
+    auto        config = ParseRoutingConfig(file, error);
+
+    if (!config) {
+        std::println("{}:{}", path.string(), error);
+    }
+    return config;
+}
+
+uint16_t MIDIMessageType(uint8_t status) {
+    if (status < 0x80) {
+        return 0;
+    }
+    // channel messages, the high nibble 0x8 to 0xE selects the type
+    if (status < 0xF0) {
+        return static_cast<uint16_t>(1 << ((status >> 4) - 8));
+    }
+    if (status == 0xF0) {
+        return ROUTE_SYSEX;
+    }
+    if (status < 0xF8) {
+        return ROUTE_SYSTEM_COMMON;
+    }
+    return ROUTE_REALTIME;
+}
+
+MIDI_Route_Table::MIDI_Route_Table(const Routing_Config& config)
+    : m_table(config.inputs.size() * 256, 0) {
+    for (const auto& route : config.routes) {
+        for (uint32_t status = 0x80; status <= 0xFF; status++) {
+            if (!(route.types & MIDIMessageType(static_cast<uint8_t>(status)))) {
+                continue;
+            }
+
+            // the low nibble of a channel message is its channel
+            if (status < 0xF0 && !(route.channels & (1 << (status & 0x0F)))) {
+                continue;
+            }
+
+            m_table[route.input * 256 + status] |= uint64_t(1) << route.output;
+        }
+    }
+}
+
+MIDI_Router::MIDI_Router(std::shared_ptr<MIDI_Transport> transport, Routing_Config config, size_t worker_count,
+                         std::chrono::microseconds batch_window, size_t batch_max_bytes)
+    : m_p_transport(std::move(transport))
+    , m_config(std::move(config))
+    , m_table(m_config)
+    , m_worker_count(worker_count)
+    , m_batch_window(batch_window)
+    , m_batch_max_bytes(batch_max_bytes)
+    , m_route_messages(std::make_unique<std::atomic<uint64_t>[]>(m_config.inputs.size() * m_config.outputs.size()))
+    , m_unrouted(std::make_unique<std::atomic<uint64_t>[]>(m_config.inputs.size())) {}
+
+MIDI_Router::~MIDI_Router() {
+    // inputs first, nothing may dispatch into an output that is going away
+    m_p_pipeline.reset();
+    m_p_bridge_pool.reset();
+    m_receivers.clear();
+}
+
+bool MIDI_Router::Start() {
+    // outputs first, an input may deliver as soon as it is open
+    for (const auto& output : m_config.outputs) {
+        auto route_output = std::make_unique<Route_Output>();
+
+        if (output.kind == Route_Endpoint_Kind::NDISender) {
+            route_output->sender = std::make_unique<MIDI_Sender>(m_p_transport->CreateSender(output.name));
+            route_output->sender->SetBatching(m_batch_window, m_batch_max_bytes);
+        } else {
+            route_output->port = std::make_unique<MIDI_IO_MANAGER>(std::string_view(output.name));
+
+            if (!route_output->port->OpenVirtualPort()) {
+                return false;
+            }
+        }
+
+        m_outputs.push_back(std::move(route_output));
+    }
+
+    const bool has_ndi_inputs = std::any_of(m_config.inputs.begin(), m_config.inputs.end(), [](const Route_Endpoint& input) {
+        return input.kind == Route_Endpoint_Kind::NDISource;
+    });
+
+    std::shared_ptr<const Source_Snapshot> sources;
+
+    if (has_ndi_inputs) {
+        std::vector<std::string> names;
+        for (const auto& input : m_config.inputs) {
+            if (input.kind == Route_Endpoint_Kind::NDISource) {
+                names.push_back(input.name);
+            }
+        }
+
+        // done as soon as every source is found rather than once discovery went quiet
+        MIDI_Source_Discovery discovery(m_p_transport);
+        sources = discovery.WaitForSources(names);
+    }
+
+    m_p_bridge_pool = std::make_unique<MIDI_Bridge_Pool>(m_p_transport, m_worker_count, m_batch_window, m_batch_max_bytes);
+
+    std::vector<const MIDI_Receiver*> pipeline_receivers;
+    std::vector<size_t>               pipeline_inputs;
+
+    for (size_t input = 0; input < m_config.inputs.size(); input++) {
+        const auto& endpoint = m_config.inputs[input];
+
+        if (endpoint.kind == Route_Endpoint_Kind::MIDIPort) {
+            const bool added = m_p_bridge_pool->AddPort(endpoint.name, [this, input](std::span<uint8_t> data, int64_t timecode) {
+                Dispatch(input, data, timecode);
+            });
+
+            if (!added) {
+                return false;
+            }
+            continue;
+        }
+
+        const auto* discovered = sources->Find(endpoint.name);
+
+        if (!discovered) {
+            std::println("NDI source {} not found", endpoint.name);
+            return false;
+        }
+
+        const auto source = discovered->ToSource();
+
+        m_receivers.push_back(std::make_unique<MIDI_Receiver>(m_p_transport->CreateReceiver("NDI MIDI")));
+        m_receivers.back()->Connect(&source);
+
+        pipeline_receivers.push_back(m_receivers.back().get());
+        pipeline_inputs.push_back(input);
+    }
+
+    m_p_bridge_pool->Start();
+
+    if (!pipeline_receivers.empty()) {
+        m_p_pipeline = std::make_unique<MIDI_Receive_Pipeline>(
+            std::move(pipeline_receivers),
+            [this, pipeline_inputs](size_t source, MIDI_Frame& frame, std::chrono::steady_clock::time_point) {
+                for (size_t i = 0; i < frame.Count(); i++) {
+                    Dispatch(pipeline_inputs[source], frame.Message(i), frame.timecode);
+                }
+            });
+    }
+
+    return true;
+}
+
+std::vector<Route_Stats> MIDI_Router::GetStats() const {
+    std::vector<Route_Stats> stats;
+
+    for (size_t input = 0; input < m_config.inputs.size(); input++) {
+        for (size_t output = 0; output < m_config.outputs.size(); output++) {
+            const bool routed = std::any_of(m_config.routes.begin(), m_config.routes.end(), [input, output](const Route& route) {
+                return route.input == input && route.output == output;
+            });
+
+            if (!routed) {
+                continue;
+            }
+
+            Route_Stats route_stats;
+            route_stats.input    = input;
+            route_stats.output   = output;
+            route_stats.messages = m_route_messages[input * m_config.outputs.size() + output].load(std::memory_order_relaxed);
+            stats.push_back(route_stats);
+        }
+    }
+
+    return stats;
+}
+
+std::vector<uint64_t> MIDI_Router::GetUnrouted() const {
+    std::vector<uint64_t> unrouted(m_config.inputs.size());
+    for (size_t input = 0; input < unrouted.size(); input++) {
+        unrouted[input] = m_unrouted[input].load(std::memory_order_relaxed);
+    }
+    return unrouted;
+}
+
+void MIDI_Router::Dispatch(size_t input, std::span<uint8_t> data, int64_t timecode) {
+    if (data.empty()) {
+        return;
+    }
+
+    // every input is handled by one thread only, so its counters need no read-modify-write
+    uint64_t outputs = m_table.Outputs(input, data[0]);
+
+    if (outputs == 0) {
+        m_unrouted[input].store(m_unrouted[input].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    while (outputs != 0) {
+        const size_t output = std::countr_zero(outputs);
+        outputs &= outputs - 1;
+
+        Route_Output& target = *m_outputs[output];
+
+        if (target.sender) {
+            target.sender->SendMIDI(data, timecode);
+        } else {
+            std::lock_guard lock(target.port_mutex);
+            target.port->SendMIDI(data);
+        }
+
+        auto& counter = m_route_messages[input * m_outputs.size() + output];
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
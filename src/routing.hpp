@@ -0,0 +1,147 @@
+#pragma once
+
+#include "pch.hpp"
+#include "bridge_pool.hpp"
+#include "ndimidi.hpp"
+#include "receive_pipeline.hpp"
+
+enum class Route_Endpoint_Kind : uint8_t {
+    MIDIPort,    // input: an RtMidi input port
+    NDISource,   // input: an NDI source
+    NDISender,   // output: an NDI source published by this process
+    VirtualPort, // output: a teVirtualMIDI port
+};
+
+struct Route_Endpoint {
+    std::string         id; // name used by the routes of the config
+    Route_Endpoint_Kind kind = Route_Endpoint_Kind::MIDIPort;
+    std::string         name; // port or source name
+};
+
+// message type filter bits, see MIDIMessageType
+enum Route_Message_Type : uint16_t {
+    ROUTE_NOTE_OFF           = 1 << 0,
+    ROUTE_NOTE_ON            = 1 << 1,
+    ROUTE_POLY_AFTERTOUCH    = 1 << 2,
+    ROUTE_CONTROL_CHANGE     = 1 << 3,
+    ROUTE_PROGRAM_CHANGE     = 1 << 4,
+    ROUTE_CHANNEL_AFTERTOUCH = 1 << 5,
+    ROUTE_PITCH_BEND         = 1 << 6,
+    ROUTE_SYSEX              = 1 << 7,
+    ROUTE_SYSTEM_COMMON      = 1 << 8,
+    ROUTE_REALTIME           = 1 << 9,
+
+    ROUTE_ALL_TYPES = (1 << 10) - 1,
+};
+
+struct Route {
+    size_t   input    = 0; // index into Routing_Config::inputs
+    size_t   output   = 0; // index into Routing_Config::outputs
+    uint16_t channels = 0xFFFF; // bit n passes MIDI channel n + 1, system messages have no channel
+    uint16_t types    = ROUTE_ALL_TYPES;
+};
+
+// at most this many outputs, the lookup table keeps one bit per output
+constexpr size_t MAX_ROUTE_OUTPUTS = 64;
+
+struct Routing_Config {
+    std::vector<Route_Endpoint> inputs;
+    std::vector<Route_Endpoint> outputs;
+    std::vector<Route>          routes;
+};
+
+// reads a routing config, one declaration per line, # starts a comment:
+//   input  <id> = midi:<MIDI input port> | ndi:<NDI source>
+//   output <id> = ndi:<NDI send name> | port:<virtual MIDI port>
+//   route  <input id> -> <output id> [channels=1-4,10] [types=note,cc,...]
+// types: note-off, note-on, note (both), poly-aftertouch, cc, program, channel-aftertouch, pitchbend,
+// sysex, common, realtime, all
+// stops at the first error, which is returned in error as "<line>: <message>"
+[[nodiscard]]
+std::optional<Routing_Config> ParseRoutingConfig(std::istream& input, std::string& error);
+
+// reads the config file, see ParseRoutingConfig, prints the first error with the path and returns nullopt
+[[nodiscard]]
+std::optional<Routing_Config> LoadRoutingConfig(const std::filesystem::path& path);
+
+// the filter bit of a status byte, 0 for data bytes
+[[nodiscard]]
+uint16_t MIDIMessageType(uint8_t status);
+
+// every route compiled into one table per input indexed by the status byte, which already encodes both the
+// message type and the channel: the entry is the set of outputs that message goes to, so routing a message
+// is a single lookup whatever the number of routes and filters
+class MIDI_Route_Table {
+public:
+    explicit MIDI_Route_Table(const Routing_Config& config);
+
+    [[nodiscard]]
+    uint64_t Outputs(size_t input, uint8_t status) const {
+        return m_table[input * 256 + status];
+    }
+
+private:
+    std::vector<uint64_t> m_table;
+};
+
+struct Route_Stats {
+    size_t   input    = 0;
+    size_t   output   = 0;
+    uint64_t messages = 0;
+};
+
+// runs a routing config: MIDI inputs are read by a bridge pool, NDI sources by a receive pipeline, and every
+// message goes to the outputs the route table selects for it
+class MIDI_Router {
+public:
+    // batching applies to every NDI output, see MIDI_Sender::SetBatching
+    MIDI_Router(std::shared_ptr<MIDI_Transport> transport, Routing_Config config, size_t worker_count,
+                std::chrono::microseconds batch_window, size_t batch_max_bytes);
+    ~MIDI_Router();
+
+    MIDI_Router(const MIDI_Router&)            = delete;
+    MIDI_Router& operator=(const MIDI_Router&) = delete;
+
+    // opens every endpoint and starts routing, false if one of them is not available
+    [[nodiscard]]
+    bool Start();
+
+    // one entry per connected input and output pair
+    [[nodiscard]]
+    std::vector<Route_Stats> GetStats() const;
+
+    // messages of every input that no route took
+    [[nodiscard]]
+    std::vector<uint64_t> GetUnrouted() const;
+
+    [[nodiscard]]
+    const Routing_Config& GetConfig() const {
+        return m_config;
+    }
+
+private:
+    struct Route_Output {
+        std::unique_ptr<MIDI_Sender>     sender;
+        std::unique_ptr<MIDI_IO_MANAGER> port;
+        std::mutex                       port_mutex; // inputs run on different threads
+    };
+
+    std::shared_ptr<MIDI_Transport> m_p_transport;
+    Routing_Config                  m_config;
+    MIDI_Route_Table                m_table;
+    size_t                          m_worker_count;
+    std::chrono::microseconds       m_batch_window;
+    size_t                          m_batch_max_bytes;
+
+    std::vector<std::unique_ptr<Route_Output>> m_outputs;
+
+    // written by the one thread that handles the input
+    std::unique_ptr<std::atomic<uint64_t>[]> m_route_messages; // input * outputs + output
+    std::unique_ptr<std::atomic<uint64_t>[]> m_unrouted;
+
+    std::vector<std::unique_ptr<MIDI_Receiver>> m_receivers;
+    std::unique_ptr<MIDI_Bridge_Pool>           m_p_bridge_pool;
+    std::unique_ptr<MIDI_Receive_Pipeline>      m_p_pipeline;
+
+    void Dispatch(size_t input, std::span<uint8_t> data, int64_t timecode);
+};
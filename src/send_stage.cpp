@@ -0,0 +1,267 @@
+#include "send_stage.hpp"
+#include "thread_util.hpp"
+
+std::optional<Overflow_Policy> ParseOverflowPolicy(std::string_view name) {
+    if (name == "block") {
+        return Overflow_Policy::Block;
+    }
+    if (name == "drop-oldest") {
+        return Overflow_Policy::DropOldest;
+    }
+    if (name == "coalesce") {
+        return Overflow_Policy::Coalesce;
+    }
+    return std::nullopt;
+}
+
+void MIDI_Send_Stage::Queued_Message::Assign(std::span<const uint8_t> data) {
+    size = static_cast<uint32_t>(data.size());
+    if (size <= INLINE_BYTES) {
+        std::copy(data.begin(), data.end(), inline_bytes.begin());
+    } else {
+        sysex.assign(data.begin(), data.end());
+    }
+}
+
+void MIDI_Send_Stage::Queued_Message::MoveTo(Queued_Message& other) {
+    other.size     = size;
+    other.timecode = timecode;
+    if (size <= INLINE_BYTES) {
+        other.inline_bytes = inline_bytes;
+    } else {
+        // swapped rather than copied, both sides keep a buffer for the next sysex
+        other.sysex.swap(sysex);
+    }
+}
+
+MIDI_Send_Stage::MIDI_Send_Stage(NDI_MIDI_Manager& ndi_midi_manager, size_t capacity, Overflow_Policy policy)
+    : m_ndi_midi_manager(ndi_midi_manager)
+    , m_policy(policy)
+    , m_mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+    , m_cells(m_mask + 1) {
+    for (size_t i = 0; i < m_cells.size(); i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_thread = std::jthread([this](std::stop_token stop_token) { SendLoop(stop_token); });
+}
+
+MIDI_Send_Stage::~MIDI_Send_Stage() {
+    m_thread.request_stop();
+    m_thread.join();
+}
+
+void MIDI_Send_Stage::Push(std::span<const uint8_t> data, int64_t timecode) {
+    if (data.empty()) {
+        return;
+    }
+
+    if (m_policy == Overflow_Policy::Coalesce) {
+        const bool   controller = data.size() == 3 && (data[0] & 0xF0) == 0xB0;
+        const size_t index      = controller ? (data[0] & 0x0F) * 128 + (data[1] & 0x7F) : 0;
+
+        const uint64_t pending = m_pending_cc.load(std::memory_order_acquire);
+        if (pending & PENDING_CC_FLAG) {
+            // a newer value of the parked controller replaces it, anything else would overtake it
+            if (controller && ((pending >> PENDING_INDEX_SHIFT) & 0x7FF) == index) {
+                StoreControllerValue(index, data[2], timecode);
+                return;
+            }
+            WaitForPendingController();
+        }
+
+        if (controller) {
+            if (!TryPush(data, timecode)) {
+                StoreControllerValue(index, data[2], timecode);
+            }
+            return;
+        }
+    }
+
+    if (TryPush(data, timecode)) {
+        return;
+    }
+
+    if (m_policy == Overflow_Policy::DropOldest) {
+        if (TryPop(m_dropped_message)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // the send thread may still be reading the cell that frees up next, which only takes a moment
+        while (!TryPush(data, timecode)) {
+            std::this_thread::yield();
+        }
+        return;
+    }
+
+    PushBlocking(data, timecode);
+}
+
+Send_Stats MIDI_Send_Stage::GetStats() const {
+    Send_Stats stats;
+    stats.messages     = m_messages.load(std::memory_order_relaxed);
+    stats.high_water   = m_high_water.load(std::memory_order_relaxed);
+    stats.capacity     = m_cells.size();
+    stats.blocked      = m_blocked.load(std::memory_order_relaxed);
+    stats.dropped      = m_dropped.load(std::memory_order_relaxed);
+    stats.coalesced    = m_coalesced.load(std::memory_order_relaxed);
+    stats.blocked_time = std::chrono::microseconds(m_blocked_us.load(std::memory_order_relaxed));
+    return stats;
+}
+
+bool MIDI_Send_Stage::TryPush(std::span<const uint8_t> data, int64_t timecode) {
+    Cell& cell = m_cells[m_tail & m_mask];
+
+    // the cell is free once its sequence has caught up with the tail
+    if (cell.sequence.load(std::memory_order_acquire) != m_tail) {
+        return false;
+    }
+
+    cell.message.Assign(data);
+    cell.message.timecode = timecode;
+    cell.sequence.store(m_tail + 1, std::memory_order_release);
+    m_tail++;
+
+    const size_t depth = m_tail - m_head.load(std::memory_order_relaxed);
+    if (depth > m_high_water.load(std::memory_order_relaxed)) {
+        m_high_water.store(depth, std::memory_order_relaxed);
+    }
+
+    m_pushed.fetch_add(1, std::memory_order_release);
+    m_pushed.notify_one();
+    return true;
+}
+
+bool MIDI_Send_Stage::TryPop(Queued_Message& message) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    while (true) {
+        Cell&        cell     = m_cells[head & m_mask];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (sequence == head + 1) {
+            // claim the cell, the send thread and a dropping producer may race for it
+            if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                cell.message.MoveTo(message);
+                cell.sequence.store(head + m_cells.size(), std::memory_order_release);
+
+                m_popped.fetch_add(1, std::memory_order_release);
+                m_popped.notify_one();
+                return true;
+            }
+        } else if (sequence < head + 1) {
+            return false;
+        } else {
+            head = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void MIDI_Send_Stage::PushBlocking(std::span<const uint8_t> data, int64_t timecode) {
+    const auto block_start = std::chrono::steady_clock::now();
+
+    while (true) {
+        const uint32_t popped = m_popped.load(std::memory_order_acquire);
+        if (TryPush(data, timecode)) {
+            break;
+        }
+        m_popped.wait(popped, std::memory_order_acquire);
+    }
+
+    CountBlocked(block_start);
+}
+
+void MIDI_Send_Stage::WaitForPendingController() {
+    const auto block_start = std::chrono::steady_clock::now();
+
+    while (true) {
+        const uint32_t popped = m_popped.load(std::memory_order_acquire);
+        if (!(m_pending_cc.load(std::memory_order_acquire) & PENDING_CC_FLAG)) {
+            break;
+        }
+        m_popped.wait(popped, std::memory_order_acquire);
+    }
+
+    CountBlocked(block_start);
+}
+
+void MIDI_Send_Stage::CountBlocked(std::chrono::steady_clock::time_point block_start) {
+    m_blocked.fetch_add(1, std::memory_order_relaxed);
+    m_blocked_us.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - block_start).count(),
+                           std::memory_order_relaxed);
+}
+
+void MIDI_Send_Stage::StoreControllerValue(size_t index, uint8_t value, int64_t timecode) {
+    // the capture time has to be known now, by the time the value goes out it is too late to synthesize it
+    if (timecode == TIMECODE_SYNTHESIZE) {
+        timecode = CurrentTimecode();
+    }
+
+    const uint64_t entry = (static_cast<uint64_t>(timecode) << PENDING_TIMECODE_SHIFT) | (static_cast<uint64_t>(index) << PENDING_INDEX_SHIFT) |
+                           PENDING_CC_FLAG | (value & 0x7F);
+    if (m_pending_cc.exchange(entry, std::memory_order_acq_rel) & PENDING_CC_FLAG) {
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_pushed.fetch_add(1, std::memory_order_release);
+    m_pushed.notify_one();
+}
+
+void MIDI_Send_Stage::SendPendingController() {
+    if (!(m_pending_cc.load(std::memory_order_relaxed) & PENDING_CC_FLAG)) {
+        return;
+    }
+
+    const uint64_t entry = m_pending_cc.exchange(0, std::memory_order_acq_rel);
+    if (!(entry & PENDING_CC_FLAG)) {
+        return;
+    }
+
+    // the entry holds the low 45 bits of the timecode, the high ones are those of the current time
+    constexpr int64_t TIMECODE_SPAN = int64_t(1) << (64 - PENDING_TIMECODE_SHIFT);
+    const int64_t     now           = CurrentTimecode();
+
+    int64_t timecode = (now & ~(TIMECODE_SPAN - 1)) | static_cast<int64_t>(entry >> PENDING_TIMECODE_SHIFT);
+    if (timecode > now + TIMECODE_SPAN / 2) {
+        timecode -= TIMECODE_SPAN;
+    }
+
+    const size_t index      = (entry >> PENDING_INDEX_SHIFT) & 0x7FF;
+    uint8_t      message[3] = {static_cast<uint8_t>(0xB0 | (index / 128)), static_cast<uint8_t>(index % 128), static_cast<uint8_t>(entry & 0x7F)};
+    m_ndi_midi_manager.SendMIDI(std::span<uint8_t>(message), timecode);
+    m_messages.fetch_add(1, std::memory_order_relaxed);
+
+    // whatever waits for the parked value to go out can be queued now
+    m_popped.fetch_add(1, std::memory_order_release);
+    m_popped.notify_one();
+}
+
+void MIDI_Send_Stage::SendLoop(std::stop_token stop_token) {
+    ApplyThreadPolicy(Thread_Role::Send, "NDI send");
+
+    std::stop_callback wake(stop_token, [this] {
+        m_pushed.fetch_add(1, std::memory_order_release);
+        m_pushed.notify_one();
+    });
+
+    while (!stop_token.stop_requested()) {
+        const uint32_t pushed = m_pushed.load(std::memory_order_acquire);
+
+        if (TryPop(m_send_message)) {
+            m_ndi_midi_manager.SendMIDI(m_send_message.Bytes(), m_send_message.timecode);
+            m_messages.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // the parked value only goes out once the queue is drained, until then an older one may be queued
+        SendPendingController();
+        m_pushed.wait(pushed, std::memory_order_acquire);
+    }
+
+    // whatever was queued before the stop still goes out
+    while (TryPop(m_send_message)) {
+        m_ndi_midi_manager.SendMIDI(m_send_message.Bytes(), m_send_message.timecode);
+        m_messages.fetch_add(1, std::memory_order_relaxed);
+    }
+    SendPendingController();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+
+// what Push does with a message while the send queue is full
+enum class Overflow_Policy : uint8_t {
+    Block,      // wait for the send thread, nothing is lost
+    DropOldest, // discard the oldest queued message to make room
+    Coalesce,   // keep only the latest value of a controller (CC) that keeps changing, everything else blocks
+};
+
+constexpr uint32_t DEFAULT_SEND_QUEUE_SIZE = 1024;
+
+// "block", "drop-oldest" or "coalesce"
+[[nodiscard]]
+std::optional<Overflow_Policy> ParseOverflowPolicy(std::string_view name);
+
+struct Send_Stats {
+    uint64_t messages   = 0; // handed to NDI
+    size_t   high_water = 0; // deepest the queue has been
+    size_t   capacity   = 0;
+
+    uint64_t blocked   = 0; // times Push had to wait
+    uint64_t dropped   = 0;
+    uint64_t coalesced = 0; // controller values replaced by a newer one before they were sent
+
+    std::chrono::microseconds blocked_time{0};
+};
+
+// moves NDI sends off the MIDI input thread: Push queues a message in a bounded queue and returns,
+// a dedicated thread hands the messages to NDI_MIDI_Manager::SendMIDI, so a send that blocks inside NDI
+// no longer backs up the RtMidi input queue
+class MIDI_Send_Stage {
+public:
+    // the manager has to outlive the stage
+    MIDI_Send_Stage(NDI_MIDI_Manager& ndi_midi_manager, size_t capacity, Overflow_Policy policy);
+    ~MIDI_Send_Stage();
+
+    MIDI_Send_Stage(const MIDI_Send_Stage&)            = delete;
+    MIDI_Send_Stage& operator=(const MIDI_Send_Stage&) = delete;
+
+    // single producer only
+    void Push(std::span<const uint8_t> data, int64_t timecode);
+
+    [[nodiscard]]
+    Send_Stats GetStats() const;
+
+private:
+    static constexpr size_t INLINE_BYTES = 16;
+
+    struct Queued_Message {
+        std::array<uint8_t, INLINE_BYTES> inline_bytes{};
+        std::vector<uint8_t>              sysex; // keeps its capacity across uses
+        uint32_t                          size     = 0;
+        int64_t                           timecode = 0;
+
+        void Assign(std::span<const uint8_t> data);
+        void MoveTo(Queued_Message& other);
+
+        [[nodiscard]]
+        std::span<uint8_t> Bytes() {
+            return std::span<uint8_t>(size <= INLINE_BYTES ? inline_bytes.data() : sysex.data(), size);
+        }
+    };
+
+    // bounded queue after Vyukov: every cell carries a sequence number telling whether it is free or full,
+    // which lets the producer claim the oldest cell for DropOldest the same way the send thread does
+    struct Cell {
+        std::atomic<size_t> sequence = 0;
+        Queued_Message      message;
+    };
+
+    NDI_MIDI_Manager& m_ndi_midi_manager;
+    Overflow_Policy   m_policy;
+
+    const size_t      m_mask;
+    std::vector<Cell> m_cells;
+
+    alignas(64) std::atomic<size_t> m_head = 0; // advanced by whoever takes a message
+    alignas(64) size_t              m_tail = 0; // producer only
+
+    // bumped after every push and pop, and on stop, so the other side can sleep on them with atomic::wait
+    std::atomic<uint32_t> m_pushed = 0;
+    std::atomic<uint32_t> m_popped = 0;
+
+    // Coalesce: the latest value of the one controller that found the queue full, bits 0-6 the value, PENDING_CC_FLAG
+    // marks an unsent one, bits 8-18 channel * 128 + controller, the bits above them the low 45 bits of its capture
+    // timecode. It only goes out once the queue is empty, so it never overtakes a queued older message, and until it
+    // has gone out anything but a newer value of the same controller waits, so nothing overtakes it either (a program
+    // change its bank select, a data entry its RPN select)
+    static constexpr uint64_t PENDING_CC_FLAG        = 0x80;
+    static constexpr int      PENDING_INDEX_SHIFT    = 8;
+    static constexpr int      PENDING_TIMECODE_SHIFT = 19;
+    std::atomic<uint64_t>     m_pending_cc           = 0;
+
+    // producer side metrics
+    std::atomic<size_t>   m_high_water = 0;
+    std::atomic<uint64_t> m_blocked    = 0;
+    std::atomic<int64_t>  m_blocked_us = 0;
+    std::atomic<uint64_t> m_dropped    = 0;
+    std::atomic<uint64_t> m_coalesced  = 0;
+
+    // send thread metrics
+    std::atomic<uint64_t> m_messages = 0;
+
+    Queued_Message m_dropped_message;
+    Queued_Message m_send_message;
+
+    std::jthread m_thread;
+
+    [[nodiscard]]
+    bool TryPush(std::span<const uint8_t> data, int64_t timecode);
+    [[nodiscard]]
+    bool TryPop(Queued_Message& message);
+    void PushBlocking(std::span<const uint8_t> data, int64_t timecode);
+    void WaitForPendingController();
+    void CountBlocked(std::chrono::steady_clock::time_point block_start);
+    void StoreControllerValue(size_t index, uint8_t value, int64_t timecode);
+    void SendPendingController();
+    void SendLoop(std::stop_token stop_token);
+};
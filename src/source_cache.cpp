@@ -0,0 +1,242 @@
+#include "source_cache.hpp"
+#include "startup_timing.hpp"
+
+// sources not seen by discovery for this long are dropped from the file
+constexpr auto SOURCE_CACHE_MAX_AGE = std::chrono::days(30);
+
+[[nodiscard]]
+static int64_t ToUnixSeconds(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+MIDI_Source_Cache::MIDI_Source_Cache(std::filesystem::path path)
+    : m_path(std::move(path)) {}
+
+void MIDI_Source_Cache::Load() {
+    m_sources.clear();
+
+    std::ifstream file(m_path);
+
+    if (!file) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        const auto first  = line.find('\t');
+        const auto second = first == std::string::npos ? std::string::npos : line.find('\t', first + 1);
+
+        if (second == std::string::npos) {
+            continue;
+        }
+
+        int64_t seconds = 0;
+        if (std::from_chars(line.data(), line.data() + first, seconds).ptr != line.data() + first) {
+            continue;
+        }
+
+        m_sources.push_back(Cached_Source{
+            line.substr(second + 1),
+            line.substr(first + 1, second - first - 1),
+            std::chrono::system_clock::time_point(std::chrono::seconds(seconds))});
+    }
+}
+
+bool MIDI_Source_Cache::Save() {
+    const auto oldest = std::chrono::system_clock::now() - SOURCE_CACHE_MAX_AGE;
+    std::erase_if(m_sources, [oldest](const Cached_Source& source) { return source.last_seen < oldest; });
+
+    std::error_code error;
+    if (m_path.has_parent_path()) {
+        std::filesystem::create_directories(m_path.parent_path(), error);
+    }
+
+    // written next to the cache and renamed over it, so a crash never leaves half a file behind
+    auto temp_path = m_path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+
+        if (!file) {
+            return false;
+        }
+
+        for (const auto& source : m_sources) {
+            file << ToUnixSeconds(source.last_seen) << '\t' << source.url << '\t' << source.name << '\n';
+        }
+
+        if (!file) {
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, m_path, error);
+    return !error;
+}
+
+std::optional<MIDI_Source> MIDI_Source_Cache::Find(std::string_view name) const {
+    for (const auto& source : m_sources) {
+        if (source.name == name) {
+            return MIDI_Source{source.name, source.url};
+        }
+    }
+    return std::nullopt;
+}
+
+void MIDI_Source_Cache::Update(const std::vector<MIDI_Source>& sources, std::chrono::system_clock::time_point now) {
+    for (const auto& source : sources) {
+        // names and URLs must stay on one line with the separators intact
+        if (source.name.find_first_of("\t\n") != std::string::npos || source.url.find_first_of("\t\n") != std::string::npos) {
+            continue;
+        }
+
+        auto it = std::find_if(m_sources.begin(), m_sources.end(), [&](const Cached_Source& cached) { return cached.name == source.name; });
+
+        if (it == m_sources.end()) {
+            m_sources.push_back(Cached_Source{source.name, source.url, now});
+            continue;
+        }
+
+        it->url       = source.url;
+        it->last_seen = now;
+    }
+}
+
+std::filesystem::path DefaultSourceCachePath() {
+    const std::filesystem::path file_name = "ndi_sources.txt";
+
+#ifdef _WIN32
+    if (const char* local_app_data = std::getenv("LOCALAPPDATA")) {
+        return std::filesystem::path(local_app_data) / "midi_to_ndi" / file_name;
+    }
+#else
+    if (const char* cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home) {
+        return std::filesystem::path(cache_home) / "midi_to_ndi" / file_name;
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::filesystem::path(home) / ".cache" / "midi_to_ndi" / file_name;
+    }
+#endif
+
+    return file_name;
+}
+
+MIDI_Source_Connector::MIDI_Source_Connector(std::shared_ptr<MIDI_Transport> transport, MIDI_Source_Discovery& discovery,
+                                             std::filesystem::path cache_path)
+    : m_p_transport(std::move(transport))
+    , m_discovery(discovery)
+    , m_use_cache(!cache_path.empty())
+    , m_cache(std::move(cache_path)) {
+    if (m_use_cache) {
+        m_cache.Load();
+    }
+
+    m_subscription = m_discovery.Subscribe([this](const Source_Snapshot& snapshot) { OnSourcesChanged(snapshot); });
+}
+
+MIDI_Source_Connector::~MIDI_Source_Connector() {
+    m_discovery.Unsubscribe(m_subscription);
+}
+
+bool MIDI_Source_Connector::Connect(const std::vector<std::string>& names, std::vector<std::unique_ptr<MIDI_Receiver>>& receivers) {
+    if (names.empty()) {
+        return true;
+    }
+
+    Startup_Phase phase("NDI sources connected");
+
+    std::vector<MIDI_Source> sources(names.size());
+    bool                     wait_for_discovery = false;
+
+    {
+        std::lock_guard lock(m_mutex);
+
+        const auto snapshot = m_discovery.GetSnapshot();
+
+        for (size_t i = 0; i < names.size(); i++) {
+            if (const auto* discovered = snapshot->Find(names[i])) {
+                sources[i] = discovered->ToSource();
+            } else if (auto cached = m_use_cache ? m_cache.Find(names[i]) : std::nullopt) {
+                sources[i] = std::move(*cached);
+                m_cached_count++;
+            } else {
+                wait_for_discovery = true;
+            }
+        }
+    }
+
+    if (wait_for_discovery) {
+        std::vector<std::string> unknown;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (sources[i].name.empty()) {
+                unknown.push_back(names[i]);
+            }
+        }
+
+        const auto snapshot = m_discovery.WaitForSources(unknown);
+
+        for (const auto& name : unknown) {
+            if (!snapshot->Find(name)) {
+                std::println("Invalid NDI source {}. Exiting...", name);
+                return false;
+            }
+        }
+
+        std::println("found {} sources", snapshot->sources.size());
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    // looked up again under the lock: a version published after this is delivered to OnSourcesChanged once the
+    // connections below are registered, so no move of a source can slip through in between
+    const auto snapshot = m_discovery.GetSnapshot();
+
+    for (size_t i = 0; i < names.size(); i++) {
+        if (const auto* discovered = snapshot->Find(names[i])) {
+            sources[i] = discovered->ToSource();
+        }
+
+        receivers.push_back(std::make_unique<MIDI_Receiver>(m_p_transport->CreateReceiver("NDI MIDI")));
+        receivers.back()->Connect(&sources[i]);
+
+        m_connections.push_back(Connection{sources[i].name, sources[i].url, receivers.back().get()});
+    }
+
+    if (!snapshot->sources.empty()) {
+        m_cache.Update(snapshot->GetSources());
+        SaveCache();
+    }
+
+    return true;
+}
+
+void MIDI_Source_Connector::SaveCache() {
+    if (m_use_cache && !m_cache.Save()) {
+        std::println("cannot write the NDI source cache {}", m_cache.GetPath().string());
+    }
+}
+
+void MIDI_Source_Connector::OnSourcesChanged(const Source_Snapshot& snapshot) {
+    std::lock_guard lock(m_mutex);
+
+    for (const auto& source : snapshot.added) {
+        for (auto& connection : m_connections) {
+            if (connection.name != source.name || connection.url == source.url) {
+                continue;
+            }
+
+            std::println("NDI source {} moved to {}, reconnecting", connection.name, source.url);
+            connection.url = source.url;
+
+            const auto moved = source.ToSource();
+            connection.receiver->Connect(&moved);
+        }
+    }
+
+    // only stamps what was seen, a source missing from the table just keeps its old time
+    if (!snapshot.added.empty()) {
+        m_cache.Update(snapshot.GetSources());
+        SaveCache();
+    }
+}
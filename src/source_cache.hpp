@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+#include "source_discovery.hpp"
+
+struct Cached_Source {
+    std::string                           name;
+    std::string                           url;
+    std::chrono::system_clock::time_point last_seen;
+};
+
+// the sources discovery found in earlier runs, kept in a small text file so a later start does not have to wait
+// for discovery before it can connect, one "<last seen unix time>\t<url>\t<name>" line per source
+class MIDI_Source_Cache {
+public:
+    explicit MIDI_Source_Cache(std::filesystem::path path);
+
+    // a missing or damaged file leaves the cache empty, it is only an optimization
+    void Load();
+
+    // drops sources not seen for a long time and replaces the file, false if it cannot be written
+    [[nodiscard]]
+    bool Save();
+
+    [[nodiscard]]
+    std::optional<MIDI_Source> Find(std::string_view name) const;
+
+    // stamps every discovered source as seen at now, adding the new ones
+    void Update(const std::vector<MIDI_Source>& sources, std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+    [[nodiscard]]
+    const std::filesystem::path& GetPath() const {
+        return m_path;
+    }
+
+private:
+    std::filesystem::path      m_path;
+    std::vector<Cached_Source> m_sources;
+};
+
+// per user: %LOCALAPPDATA%, $XDG_CACHE_HOME or ~/.cache, the working directory as a last resort
+[[nodiscard]]
+std::filesystem::path DefaultSourceCachePath();
+
+// connects receivers by source name without waiting for discovery: names the cache knows are connected at once
+// while discovery keeps running in the background, it updates the cache file and reconnects a receiver whose source
+// moved to another URL; only names neither discovery nor the cache know yet wait for discovery
+class MIDI_Source_Connector {
+public:
+    // the discovery has to outlive the connector, an empty cache_path disables the cache
+    MIDI_Source_Connector(std::shared_ptr<MIDI_Transport> transport, MIDI_Source_Discovery& discovery, std::filesystem::path cache_path);
+    ~MIDI_Source_Connector();
+
+    MIDI_Source_Connector(const MIDI_Source_Connector&)            = delete;
+    MIDI_Source_Connector& operator=(const MIDI_Source_Connector&) = delete;
+
+    // appends one connected receiver per name, false if a name is neither cached nor discovered
+    // the receivers have to outlive the connector
+    [[nodiscard]]
+    bool Connect(const std::vector<std::string>& names, std::vector<std::unique_ptr<MIDI_Receiver>>& receivers);
+
+    // names Connect took from the cache
+    [[nodiscard]]
+    size_t GetCachedCount() const {
+        return m_cached_count;
+    }
+
+private:
+    std::shared_ptr<MIDI_Transport> m_p_transport;
+    MIDI_Source_Discovery&          m_discovery;
+    bool                            m_use_cache;
+    size_t                          m_subscription = 0;
+
+    std::mutex        m_mutex; // cache and connections, shared with the discovery thread
+    MIDI_Source_Cache m_cache;
+
+    struct Connection {
+        std::string    name;
+        std::string    url;
+        MIDI_Receiver* receiver = nullptr;
+    };
+
+    std::vector<Connection> m_connections;
+    size_t                  m_cached_count = 0;
+
+    void SaveCache();
+
+    // on the discovery thread: reconnects receivers whose source moved, keeps the cache file current
+    void OnSourcesChanged(const Source_Snapshot& snapshot);
+};
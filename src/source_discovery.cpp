@@ -0,0 +1,191 @@
+#include "source_discovery.hpp"
+#include "startup_timing.hpp"
+
+// how long the finder is waited on at a time, bounds how late a stop is noticed
+constexpr uint32_t DISCOVERY_POLL_MS = 100;
+
+// discovery has settled once no source came or went for this long
+constexpr auto DISCOVERY_QUIET_TIME = std::chrono::milliseconds(1000);
+
+std::vector<MIDI_Source> Source_Snapshot::GetSources() const {
+    std::vector<MIDI_Source> result;
+    result.reserve(sources.size());
+
+    for (const auto& [name, source] : sources) {
+        result.push_back(source.ToSource());
+    }
+
+    std::sort(result.begin(), result.end(), [](const MIDI_Source& a, const MIDI_Source& b) { return a.name < b.name; });
+    return result;
+}
+
+MIDI_Source_Discovery::MIDI_Source_Discovery(std::shared_ptr<MIDI_Transport> transport)
+    : m_p_transport(std::move(transport))
+    , m_p_strings(std::make_shared<Source_Strings>()) {
+    auto snapshot     = std::make_shared<Source_Snapshot>();
+    snapshot->strings = m_p_strings;
+    m_snapshot.store(std::move(snapshot), std::memory_order_release);
+
+    m_thread = std::jthread([this](std::stop_token stop_token) { DiscoveryLoop(stop_token); });
+}
+
+MIDI_Source_Discovery::~MIDI_Source_Discovery() {
+    m_thread.request_stop();
+    m_thread.join();
+}
+
+std::shared_ptr<const Source_Snapshot> MIDI_Source_Discovery::WaitForSources(const std::vector<std::string>& names) const {
+    const auto has_all = [&names](const Source_Snapshot& snapshot) {
+        return !names.empty() && std::all_of(names.begin(), names.end(), [&snapshot](const std::string& name) { return snapshot.Find(name); });
+    };
+
+    std::unique_lock lock(m_wait_mutex);
+
+    std::shared_ptr<const Source_Snapshot> snapshot;
+    m_wait_cv.wait(lock, [&] {
+        snapshot = GetSnapshot();
+        return snapshot->settled || has_all(*snapshot);
+    });
+
+    return snapshot;
+}
+
+size_t MIDI_Source_Discovery::Subscribe(Subscriber subscriber) {
+    std::lock_guard lock(m_subscriber_mutex);
+    m_subscribers.emplace_back(m_next_subscriber_id, std::move(subscriber));
+    return m_next_subscriber_id++;
+}
+
+void MIDI_Source_Discovery::Unsubscribe(size_t id) {
+    std::lock_guard lock(m_subscriber_mutex);
+    std::erase_if(m_subscribers, [id](const auto& subscriber) { return subscriber.first == id; });
+}
+
+std::string_view MIDI_Source_Discovery::Intern(std::string_view text) {
+    auto it = m_p_strings->find(text);
+
+    if (it == m_p_strings->end()) {
+        it = m_p_strings->emplace(text).first;
+    }
+    return *it;
+}
+
+void MIDI_Source_Discovery::CompactStrings(Source_Snapshot& next) {
+    // at most, every source and every removed one with a name and a URL of its own
+    const size_t live = 2 * (next.sources.size() + next.removed.size());
+
+    if (m_p_strings->size() <= 2 * live) {
+        return;
+    }
+
+    // earlier snapshots keep the old set alive for as long as they are held
+    auto strings = std::make_shared<Source_Strings>();
+    strings->reserve(live);
+
+    const auto move_to_new_set = [&strings](Discovered_Source& source) {
+        source.name = *strings->emplace(source.name).first;
+        source.url  = *strings->emplace(source.url).first;
+    };
+
+    std::unordered_map<std::string_view, Discovered_Source> sources;
+    sources.reserve(next.sources.size());
+
+    for (auto [name, source] : next.sources) {
+        move_to_new_set(source);
+        sources.emplace(source.name, source);
+    }
+    for (auto& source : next.added) {
+        move_to_new_set(source);
+    }
+    for (auto& source : next.removed) {
+        move_to_new_set(source);
+    }
+
+    next.sources = std::move(sources);
+    next.strings = strings;
+    m_p_strings  = std::move(strings);
+}
+
+void MIDI_Source_Discovery::Publish(const std::vector<MIDI_Source>& sources, bool settled) {
+    const auto previous = GetSnapshot();
+
+    auto next     = std::make_shared<Source_Snapshot>();
+    next->version = previous->version + 1;
+    next->settled = settled;
+    next->strings = m_p_strings;
+    next->sources.reserve(sources.size());
+
+    for (const auto& source : sources) {
+        const Discovered_Source discovered{Intern(source.name), Intern(source.url)};
+
+        if (!next->sources.emplace(discovered.name, discovered).second) {
+            continue;
+        }
+
+        const auto* known = previous->Find(discovered.name);
+
+        // interned, so equal URLs share their characters
+        if (!known || known->url.data() != discovered.url.data()) {
+            next->added.push_back(discovered);
+            if (known) {
+                next->removed.push_back(*known);
+            }
+        }
+    }
+
+    for (const auto& [name, source] : previous->sources) {
+        if (!next->Find(name)) {
+            next->removed.push_back(source);
+        }
+    }
+
+    if (next->added.empty() && next->removed.empty() && settled == previous->settled) {
+        return;
+    }
+
+    // only once the delta is known, it compares the URLs of the previous version by address
+    CompactStrings(*next);
+
+    m_snapshot.store(next, std::memory_order_release);
+
+    {
+        std::lock_guard lock(m_subscriber_mutex);
+        for (const auto& [id, subscriber] : m_subscribers) {
+            subscriber(*next);
+        }
+    }
+
+    // the lock orders the store before a waiter's check, so no wake up is lost
+    {
+        std::lock_guard lock(m_wait_mutex);
+    }
+    m_wait_cv.notify_all();
+}
+
+void MIDI_Source_Discovery::DiscoveryLoop(std::stop_token stop_token) {
+    std::optional<Startup_Phase> settle_phase(std::in_place, "NDI discovery settled");
+
+    std::unique_ptr<Metadata_Finder> finder;
+    {
+        Startup_Phase phase("NDI finder");
+        finder = m_p_transport->CreateFinder();
+    }
+
+    auto last_change = std::chrono::steady_clock::now();
+    bool settled     = false;
+
+    while (!stop_token.stop_requested()) {
+        // returns as soon as a source comes or goes, the list is only read then
+        if (finder->WaitForSources(DISCOVERY_POLL_MS)) {
+            last_change = std::chrono::steady_clock::now();
+            Publish(finder->GetCurrentSources(), settled);
+            continue;
+        }
+
+        if (!settled && std::chrono::steady_clock::now() - last_change >= DISCOVERY_QUIET_TIME) {
+            settled = true;
+            settle_phase.reset();
+            Publish(finder->GetCurrentSources(), settled);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "pch.hpp"
+#include "transport.hpp"
+
+// hash and equality for looking up std::string keys by std::string_view without a temporary string
+struct String_Hash {
+    using is_transparent = void;
+
+    [[nodiscard]]
+    size_t operator()(std::string_view text) const {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
+// the names and URLs discovery saw, each stored once; entries are never erased or moved, so views of them stay
+// valid for as long as the set lives, which every snapshot holding them ensures. Once most of them are not used
+// anymore, e.g. after senders restarted on new URLs, the next snapshot starts a new set with only its own
+using Source_Strings = std::unordered_set<std::string, String_Hash, std::equal_to<>>;
+
+// a source of the table, both views point into the interned strings of the snapshot it came from
+struct Discovered_Source {
+    std::string_view name;
+    std::string_view url;
+
+    [[nodiscard]]
+    MIDI_Source ToSource() const {
+        return MIDI_Source{std::string(name), std::string(url)};
+    }
+};
+
+// the source table at one point in time, immutable once published
+struct Source_Snapshot {
+    uint64_t version = 0;
+
+    // discovery went quiet at least once since it started, a name missing now is most likely not on the network
+    bool settled = false;
+
+    std::unordered_map<std::string_view, Discovered_Source> sources;
+
+    // the delta to the previous version, a source whose URL changed is in both
+    std::vector<Discovered_Source> added;
+    std::vector<Discovered_Source> removed;
+
+    std::shared_ptr<const Source_Strings> strings;
+
+    [[nodiscard]]
+    const Discovered_Source* Find(std::string_view name) const {
+        const auto it = sources.find(name);
+        return it == sources.end() ? nullptr : &it->second;
+    }
+
+    // owned copies sorted by name, e.g. for listing
+    [[nodiscard]]
+    std::vector<MIDI_Source> GetSources() const;
+};
+
+// keeps discovering sources on a thread of its own for as long as it lives
+// readers get the latest table with one atomic load and never wait for discovery, changes are pushed to subscribers
+class MIDI_Source_Discovery {
+public:
+    // invoked on the discovery thread for every new version, must not subscribe or unsubscribe itself
+    using Subscriber = std::function<void(const Source_Snapshot& snapshot)>;
+
+    explicit MIDI_Source_Discovery(std::shared_ptr<MIDI_Transport> transport);
+    ~MIDI_Source_Discovery();
+
+    MIDI_Source_Discovery(const MIDI_Source_Discovery&)            = delete;
+    MIDI_Source_Discovery& operator=(const MIDI_Source_Discovery&) = delete;
+
+    // the latest table, version 0 and empty until discovery reported for the first time
+    [[nodiscard]]
+    std::shared_ptr<const Source_Snapshot> GetSnapshot() const {
+        return m_snapshot.load(std::memory_order_acquire);
+    }
+
+    // blocks until every name is in the table or discovery settled without some of them
+    // with no names it waits for discovery to settle, like a one-shot discovery did before
+    [[nodiscard]]
+    std::shared_ptr<const Source_Snapshot> WaitForSources(const std::vector<std::string>& names) const;
+
+    // returns an id for Unsubscribe, versions published before the call are not delivered
+    size_t Subscribe(Subscriber subscriber);
+
+    // once it returns the subscriber is not running and will not be invoked again
+    void Unsubscribe(size_t id);
+
+private:
+    std::shared_ptr<MIDI_Transport> m_p_transport;
+
+    // only the discovery thread inserts, published snapshots share it
+    std::shared_ptr<Source_Strings> m_p_strings;
+
+    std::atomic<std::shared_ptr<const Source_Snapshot>> m_snapshot;
+
+    std::mutex                                 m_subscriber_mutex;
+    std::vector<std::pair<size_t, Subscriber>> m_subscribers;
+    size_t                                     m_next_subscriber_id = 0;
+
+    mutable std::mutex              m_wait_mutex;
+    mutable std::condition_variable m_wait_cv;
+
+    std::jthread m_thread;
+
+    [[nodiscard]]
+    std::string_view Intern(std::string_view text);
+
+    // moves next onto a new set of strings if the current one is mostly strings no source uses anymore
+    void CompactStrings(Source_Snapshot& next);
+
+    // builds the next version from the sources the finder reports, publishes it if anything changed
+    void Publish(const std::vector<MIDI_Source>& sources, bool settled);
+
+    void DiscoveryLoop(std::stop_token stop_token);
+};
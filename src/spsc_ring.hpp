@@ -0,0 +1,70 @@
+#pragma once
+
+#include "pch.hpp"
+
+// bounded wait-free queue between exactly one producer and one consumer thread
+// the slots are allocated once and filled in place, so elements with their own buffers keep them across uses
+template <typename T>
+class SPSC_Ring {
+public:
+    // capacity is rounded up to a power of two
+    explicit SPSC_Ring(size_t capacity)
+        : m_mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+        , m_slots(m_mask + 1) {}
+
+    SPSC_Ring(const SPSC_Ring&)            = delete;
+    SPSC_Ring& operator=(const SPSC_Ring&) = delete;
+
+    // producer: the next free slot, nullptr if the ring is full
+    [[nodiscard]]
+    T* BeginPush() {
+        const size_t back = m_back.load(std::memory_order_relaxed);
+        if (back - m_front.load(std::memory_order_acquire) > m_mask) {
+            return nullptr;
+        }
+        return &m_slots[back & m_mask];
+    }
+
+    // producer: publishes the slot returned by BeginPush
+    void CommitPush() {
+        m_back.store(m_back.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer: the oldest element, nullptr if the ring is empty
+    [[nodiscard]]
+    T* Front() {
+        const size_t front = m_front.load(std::memory_order_relaxed);
+        if (front == m_back.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[front & m_mask];
+    }
+
+    // consumer: hands the slot returned by Front back to the producer
+    void Pop() {
+        m_front.store(m_front.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // approximate when called while the other side is active, from any thread
+    [[nodiscard]]
+    size_t Size() const {
+        // front first: back never falls behind a front that was already read, so this cannot underflow, and
+        // both sides moving on in between can only make it too large
+        const size_t front = m_front.load(std::memory_order_acquire);
+        const size_t back  = m_back.load(std::memory_order_acquire);
+        return std::min(back - front, Capacity());
+    }
+
+    [[nodiscard]]
+    size_t Capacity() const {
+        return m_mask + 1;
+    }
+
+private:
+    const size_t   m_mask;
+    std::vector<T> m_slots;
+
+    // on separate cache lines so both sides do not invalidate each other on every operation
+    alignas(64) std::atomic<size_t> m_front = 0;
+    alignas(64) std::atomic<size_t> m_back  = 0;
+};
@@ -0,0 +1,63 @@
+#include "startup_timing.hpp"
+
+namespace {
+
+const auto process_start_time = std::chrono::steady_clock::now();
+
+std::atomic<bool> timings_enabled = false;
+
+struct Recorded_Phase {
+    std::string_view                      name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration   duration;
+};
+
+// phases may end on other threads, e.g. the discovery thread
+std::mutex                  phase_mutex;
+std::vector<Recorded_Phase> recorded_phases;
+
+} // namespace
+
+std::chrono::steady_clock::time_point GetProcessStartTime() {
+    return process_start_time;
+}
+
+void EnableStartupTimings() {
+    timings_enabled.store(true, std::memory_order_relaxed);
+}
+
+Startup_Phase::Startup_Phase(std::string_view name)
+    : m_name(name) {
+    if (timings_enabled.load(std::memory_order_relaxed)) {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+Startup_Phase::~Startup_Phase() {
+    if (!timings_enabled.load(std::memory_order_relaxed) || m_start == std::chrono::steady_clock::time_point()) {
+        return;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(phase_mutex);
+    recorded_phases.push_back(Recorded_Phase{m_name, m_start, end - m_start});
+}
+
+void PrintStartupTimings() {
+    if (!timings_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard lock(phase_mutex);
+
+    const auto to_ms = [](std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    std::println("startup timings:");
+    for (const auto& phase : recorded_phases) {
+        std::println("\t{:<24} {:8.2f} ms at {:8.2f} ms", phase.name, to_ms(phase.duration), to_ms(phase.start - process_start_time));
+    }
+    std::println("\t{:<24} {:8.2f} ms", "ready", to_ms(std::chrono::steady_clock::now() - process_start_time));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "pch.hpp"
+
+// when the process started, taken during static initialization before main runs
+[[nodiscard]]
+std::chrono::steady_clock::time_point GetProcessStartTime();
+
+// startup phases are only recorded after this, a phase costs nothing but a flag check otherwise
+void EnableStartupTimings();
+
+// measures one startup phase from construction to destruction, e.g. creating the NDI sender
+class Startup_Phase {
+public:
+    explicit Startup_Phase(std::string_view name);
+    ~Startup_Phase();
+
+    Startup_Phase(const Startup_Phase&)            = delete;
+    Startup_Phase& operator=(const Startup_Phase&) = delete;
+
+private:
+    std::string_view                      m_name;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// every phase recorded so far with its start after process start and its duration, nothing if timings are disabled
+void PrintStartupTimings();
@@ -0,0 +1,176 @@
+#include "thread_util.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// written by main before any bridge thread starts, read only afterwards
+std::array<Thread_Policy, static_cast<size_t>(Thread_Role::Count)> thread_policies;
+
+std::mutex                 report_mutex;
+std::vector<Thread_Report> thread_reports;
+
+} // namespace
+
+bool PinCurrentThread(int core) {
+    if (core < 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    if (core >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+#elif defined(__linux__)
+    if (core >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// raises the calling thread to priority, returns the priority it runs at afterwards
+[[nodiscard]]
+static int RaiseCurrentThread(int priority) {
+    if (priority <= 0) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    // Windows has no SCHED_FIFO, the priority range is spread over the classes above normal
+    const int thread_priority = priority >= 90   ? THREAD_PRIORITY_TIME_CRITICAL
+                                : priority >= 50 ? THREAD_PRIORITY_HIGHEST
+                                                 : THREAD_PRIORITY_ABOVE_NORMAL;
+    return SetThreadPriority(GetCurrentThread(), thread_priority) ? priority : 0;
+#elif defined(__linux__)
+    sched_param param{};
+    param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+
+    // without CAP_SYS_NICE or an rtprio limit this fails with EPERM and the thread keeps SCHED_OTHER
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        return 0;
+    }
+
+    int policy = SCHED_OTHER;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 || policy != SCHED_FIFO) {
+        return 0;
+    }
+    return param.sched_priority;
+#else
+    return 0;
+#endif
+}
+
+std::string_view ThreadRoleName(Thread_Role role) {
+    switch (role) {
+    case Thread_Role::MIDIInput:
+        return "input";
+    case Thread_Role::Capture:
+        return "capture";
+    case Thread_Role::Send:
+        return "send";
+    case Thread_Role::Output:
+        return "output";
+    default:
+        return "unknown";
+    }
+}
+
+void SetThreadPolicy(Thread_Role role, const Thread_Policy& policy) {
+    thread_policies[static_cast<size_t>(role)] = policy;
+}
+
+const Thread_Policy& GetThreadPolicy(Thread_Role role) {
+    return thread_policies[static_cast<size_t>(role)];
+}
+
+Thread_Policy ApplyThreadPolicy(Thread_Role role, std::string_view name) {
+    const auto& requested = GetThreadPolicy(role);
+
+    Thread_Policy applied;
+
+    if (requested.core != NO_CORE && PinCurrentThread(requested.core)) {
+        applied.core = requested.core;
+    }
+
+    applied.priority = RaiseCurrentThread(requested.priority);
+
+    RecordThreadPolicy(role, name, applied);
+    return applied;
+}
+
+void RecordThreadPolicy(Thread_Role role, std::string_view name, const Thread_Policy& applied) {
+    std::lock_guard lock(report_mutex);
+    thread_reports.push_back(Thread_Report{role, std::string(name), GetThreadPolicy(role), applied});
+}
+
+void RequestMIDIInputPolicy(RtMidiIn& midi_in) {
+    const auto& policy = GetThreadPolicy(Thread_Role::MIDIInput);
+
+    if (policy.priority > 0 || policy.core != NO_CORE) {
+        midi_in.setInputThreadScheduling(policy.priority, policy.core);
+    }
+}
+
+void RecordMIDIInputPolicy(RtMidiIn& midi_in, std::string_view name) {
+    Thread_Policy applied;
+
+    // APIs without an input thread of their own deliver on a driver thread, which keeps its default
+    if (!midi_in.getInputThreadScheduling(&applied.priority, &applied.core)) {
+        applied = Thread_Policy();
+    }
+
+    RecordThreadPolicy(Thread_Role::MIDIInput, name, applied);
+}
+
+bool LockProcessMemory(std::string& error) {
+#ifdef __linux__
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        // EPERM without CAP_IPC_LOCK, ENOMEM when RLIMIT_MEMLOCK is too small
+        error = std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    error = "not supported on this platform";
+    return false;
+#endif
+}
+
+std::vector<Thread_Report> GetThreadReports() {
+    std::lock_guard lock(report_mutex);
+    return thread_reports;
+}
+
+// "FIFO 80 on core 2", "default"
+[[nodiscard]]
+static std::string FormatPolicy(const Thread_Policy& policy) {
+    std::string text = policy.priority > 0 ? std::format("FIFO {}", policy.priority) : std::string("default");
+    if (policy.core != NO_CORE) {
+        text += std::format(" on core {}", policy.core);
+    }
+    return text;
+}
+
+void PrintThreadReports() {
+    for (const auto& report : GetThreadReports()) {
+        if (report.requested.priority <= 0 && report.requested.core == NO_CORE) {
+            continue;
+        }
+
+        const bool fell_back = report.applied.priority != report.requested.priority || report.applied.core != report.requested.core;
+
+        std::println("{} thread {}: requested {}, applied {}{}", ThreadRoleName(report.role), report.name,
+                     FormatPolicy(report.requested), FormatPolicy(report.applied), fell_back ? " (refused by the OS)" : "");
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "pch.hpp"
+
+// sentinel for "do not pin"
+constexpr int NO_CORE = -1;
+
+// pins the calling thread to one CPU core, returns false if the core is invalid or the OS refused
+bool PinCurrentThread(int core);
+
+// the kinds of threads a bridge runs, each gets its own scheduling
+enum class Thread_Role : uint8_t {
+    MIDIInput, // RtMidi input threads, or the whole bridge in event loop mode
+    Capture,   // NDI capture threads of the receive pipeline
+    Send,      // send stage, batch and bridge worker threads
+    Output,    // MIDI output and playout threads
+    Count,
+};
+
+[[nodiscard]]
+std::string_view ThreadRoleName(Thread_Role role);
+
+struct Thread_Policy {
+    int core     = NO_CORE;
+    int priority = 0; // SCHED_FIFO priority (1-99), on Windows mapped onto the thread priority classes, 0 keeps the default
+};
+
+// what a thread asked for and what the OS actually gave it
+struct Thread_Report {
+    Thread_Role   role = Thread_Role::MIDIInput;
+    std::string   name;
+    Thread_Policy requested;
+    Thread_Policy applied;
+};
+
+// the policy every thread of a role applies when it starts, set once before any bridge thread runs
+void SetThreadPolicy(Thread_Role role, const Thread_Policy& policy);
+
+[[nodiscard]]
+const Thread_Policy& GetThreadPolicy(Thread_Role role);
+
+// applies the policy of role to the calling thread as far as the OS allows and records the outcome under name,
+// a refused priority or core leaves the thread running with the default instead
+Thread_Policy ApplyThreadPolicy(Thread_Role role, std::string_view name);
+
+// for threads started by a library, which applied the policy itself
+void RecordThreadPolicy(Thread_Role role, std::string_view name, const Thread_Policy& applied);
+
+// asks RtMidi to start the input thread of midi_in with the MIDIInput policy, before its port is opened
+void RequestMIDIInputPolicy(RtMidiIn& midi_in);
+
+// records what the input thread of the opened port of midi_in got
+void RecordMIDIInputPolicy(RtMidiIn& midi_in, std::string_view name);
+
+// locks all current and future pages of the process in memory so a page fault cannot stall a bridge thread
+// returns false with the reason in error if the OS refused
+[[nodiscard]]
+bool LockProcessMemory(std::string& error);
+
+// every thread that applied a policy so far, in start order
+[[nodiscard]]
+std::vector<Thread_Report> GetThreadReports();
+
+// prints the requested and applied scheduling of every thread that asked for more than the default
+void PrintThreadReports();
@@ -0,0 +1,618 @@
+#include "transport.hpp"
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NDI
+
+#ifdef MIDI_TO_NDI_WITH_NDI
+
+class NDI_Finder : public Metadata_Finder {
+public:
+    NDI_Finder() {
+        auto find_create_desc = NDIlib_find_create_t(
+            true, nullptr, nullptr);
+
+        m_p_find = NDIlib_find_create_v2(&find_create_desc);
+
+        if (!m_p_find) {
+            std::println("cannot create NDI find instance");
+        }
+    }
+
+    ~NDI_Finder() override {
+        if (m_p_find) {
+            NDIlib_find_destroy(m_p_find);
+        }
+    }
+
+    bool WaitForSources(uint32_t timeout_ms) override {
+        if (!m_p_find) {
+            return false;
+        }
+        return NDIlib_find_wait_for_sources(m_p_find, timeout_ms);
+    }
+
+    std::vector<MIDI_Source> GetCurrentSources() override {
+        std::vector<MIDI_Source> sources;
+
+        if (!m_p_find) {
+            return sources;
+        }
+
+        uint32_t   n_sources = 0;
+        const auto p_sources = NDIlib_find_get_current_sources(m_p_find, &n_sources);
+
+        if (!p_sources) {
+            return sources;
+        }
+
+        // copy the strings, they belong to the find instance and change with the next query
+        sources.reserve(n_sources);
+        for (uint32_t i = 0; i < n_sources; i++) {
+            sources.push_back(MIDI_Source{
+                p_sources[i].p_ndi_name ? p_sources[i].p_ndi_name : "",
+                p_sources[i].p_url_address ? p_sources[i].p_url_address : ""});
+        }
+
+        return sources;
+    }
+
+private:
+    NDIlib_find_instance_t m_p_find = nullptr;
+};
+
+class NDI_Sender : public Metadata_Sender {
+public:
+    NDI_Sender(std::string_view name)
+        : m_name(name) {
+        auto send_create_desc = NDIlib_send_create_t(
+            m_name.c_str(),
+            nullptr,
+            false,
+            false);
+
+        m_p_send = NDIlib_send_create(&send_create_desc);
+
+        if (!m_p_send) {
+            std::println("cannot create NDI send instance");
+        }
+    }
+
+    ~NDI_Sender() override {
+        if (m_p_send) {
+            NDIlib_send_destroy(m_p_send);
+        }
+    }
+
+    void Send(std::string_view payload, int64_t timecode) override {
+        if (!m_p_send) {
+            return;
+        }
+
+        // NDI expects the length to include the null terminator
+        const NDIlib_metadata_frame_t metadata_frame{
+            static_cast<int>(payload.size() + 1),
+            timecode,
+            const_cast<char*>(payload.data())};
+
+        NDIlib_send_send_metadata(m_p_send, &metadata_frame);
+    }
+
+    int GetConnectionCount(uint32_t timeout_ms) override {
+        if (!m_p_send) {
+            return 0;
+        }
+        return NDIlib_send_get_no_connections(m_p_send, timeout_ms);
+    }
+
+private:
+    std::string            m_name;
+    NDIlib_send_instance_t m_p_send = nullptr;
+};
+
+class NDI_Receiver : public Metadata_Receiver {
+public:
+    NDI_Receiver(std::string_view name)
+        : m_name(name) {
+        auto recv_create_desc            = NDIlib_recv_create_v3_t();
+        recv_create_desc.p_ndi_recv_name = m_name.c_str();
+
+        m_p_recv = NDIlib_recv_create_v3(&recv_create_desc);
+
+        if (!m_p_recv) {
+            std::println("cannot create NDI receive instance");
+        }
+    }
+
+    ~NDI_Receiver() override {
+        if (!m_p_recv) {
+            return;
+        }
+
+        if (m_holding_frame) {
+            NDIlib_recv_free_metadata(m_p_recv, &m_metadata_frame);
+        }
+
+        NDIlib_recv_connect(m_p_recv, nullptr);
+        NDIlib_recv_destroy(m_p_recv);
+    }
+
+    void Connect(const MIDI_Source* source) override {
+        if (!m_p_recv) {
+            return;
+        }
+
+        if (!source) {
+            NDIlib_recv_connect(m_p_recv, nullptr);
+            return;
+        }
+
+        // NDIlib_recv_connect copies the source strings
+        const NDIlib_source_t ndi_source(
+            source->name.c_str(),
+            source->url.empty() ? nullptr : source->url.c_str());
+
+        NDIlib_recv_connect(m_p_recv, &ndi_source);
+    }
+
+    Capture_Result Capture(uint32_t timeout_ms, Metadata_Frame& frame) override {
+        if (!m_p_recv || m_holding_frame) {
+            return Capture_Result::None;
+        }
+
+        switch (NDIlib_recv_capture_v3(
+            m_p_recv, nullptr, nullptr, &m_metadata_frame, timeout_ms)) {
+        case NDIlib_frame_type_metadata:
+            if (!m_metadata_frame.p_data || m_metadata_frame.length <= 0) {
+                NDIlib_recv_free_metadata(m_p_recv, &m_metadata_frame);
+                return Capture_Result::None;
+            }
+
+            m_holding_frame = true;
+            frame.data      = std::string_view(m_metadata_frame.p_data, m_metadata_frame.length);
+            frame.timecode  = m_metadata_frame.timecode;
+            return Capture_Result::Metadata;
+        // The device has changed status in some way (see notes below)
+        case NDIlib_frame_type_status_change:
+            return Capture_Result::StatusChange;
+        default:
+            return Capture_Result::None;
+        }
+    }
+
+    void FreeFrame(Metadata_Frame& frame) override {
+        if (!m_holding_frame) {
+            return;
+        }
+
+        NDIlib_recv_free_metadata(m_p_recv, &m_metadata_frame);
+
+        m_holding_frame = false;
+        frame.data      = {};
+    }
+
+    int GetConnectionCount() override {
+        if (!m_p_recv) {
+            return 0;
+        }
+        return NDIlib_recv_get_no_connections(m_p_recv);
+    }
+
+    uint64_t GetDroppedFrames() override {
+        if (!m_p_recv) {
+            return 0;
+        }
+        NDIlib_recv_performance_t total, dropped;
+        NDIlib_recv_get_performance(m_p_recv, &total, &dropped);
+        return static_cast<uint64_t>(dropped.metadata_frames);
+    }
+
+private:
+    std::string             m_name;
+    NDIlib_recv_instance_t  m_p_recv = nullptr;
+    NDIlib_metadata_frame_t m_metadata_frame;
+    bool                    m_holding_frame = false;
+};
+
+#endif // MIDI_TO_NDI_WITH_NDI
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Loopback
+
+// frames a receiver holds before the oldest are dropped, like a receiver that does not keep up with NDI
+constexpr size_t LOOPBACK_QUEUE_LIMIT = 1024;
+
+struct Loopback_Queued_Frame {
+    std::string payload;
+    int64_t     timecode = 0;
+};
+
+struct Loopback_Receiver_State {
+    std::mutex                        mutex;
+    std::condition_variable           cv;
+    std::deque<Loopback_Queued_Frame> frames;
+    std::vector<std::string>          free_payloads; // recycled payload buffers
+    bool                              status_changed = false;
+    uint64_t                          dropped        = 0;
+
+    // eventfd, readable while frames or a status change are pending, -1 without one
+    int ready_fd = -1;
+
+    // guarded by the bus mutex
+    std::string connected_name;
+
+    void SignalStatusChange() {
+        std::lock_guard lock(mutex);
+        status_changed = true;
+        cv.notify_one();
+        SetReady();
+    }
+
+    // SetReady and ClearReady are called with mutex held, so ready_fd always agrees with the queue
+    void SetReady() {
+#ifdef __linux__
+        if (ready_fd >= 0) {
+            const uint64_t one = 1;
+            const auto     res = write(ready_fd, &one, sizeof(one));
+            (void)res;
+        }
+#endif
+    }
+
+    void ClearReady() {
+#ifdef __linux__
+        if (ready_fd >= 0) {
+            uint64_t count = 0;
+            const auto res = read(ready_fd, &count, sizeof(count));
+            (void)res;
+        }
+#endif
+    }
+};
+
+} // namespace
+
+struct Loopback_Bus {
+    std::mutex               mutex;
+    std::condition_variable  changed_cv;
+    uint64_t                 version = 0;
+    std::vector<std::string> senders;
+
+    std::vector<Loopback_Receiver_State*> receivers;
+
+    [[nodiscard]]
+    bool HasSender(std::string_view name) const {
+        return std::find(senders.begin(), senders.end(), name) != senders.end();
+    }
+
+    // called with mutex held
+    void NotifyChanged(std::string_view name) {
+        version++;
+        changed_cv.notify_all();
+
+        for (auto* receiver : receivers) {
+            if (receiver->connected_name != name) {
+                continue;
+            }
+            receiver->SignalStatusChange();
+        }
+    }
+};
+
+namespace {
+
+class Loopback_Finder : public Metadata_Finder {
+public:
+    Loopback_Finder(std::shared_ptr<Loopback_Bus> p_bus)
+        : m_p_bus(std::move(p_bus)) {}
+
+    bool WaitForSources(uint32_t timeout_ms) override {
+        std::unique_lock lock(m_p_bus->mutex);
+
+        const bool changed = m_p_bus->changed_cv.wait_for(
+            lock, std::chrono::milliseconds(timeout_ms),
+            [this] { return m_p_bus->version != m_seen_version; });
+
+        m_seen_version = m_p_bus->version;
+        return changed;
+    }
+
+    std::vector<MIDI_Source> GetCurrentSources() override {
+        std::lock_guard lock(m_p_bus->mutex);
+
+        std::vector<MIDI_Source> sources;
+        sources.reserve(m_p_bus->senders.size());
+
+        for (const auto& name : m_p_bus->senders) {
+            sources.push_back(MIDI_Source{name, std::format("loopback://{}", name)});
+        }
+
+        return sources;
+    }
+
+private:
+    std::shared_ptr<Loopback_Bus> m_p_bus;
+    // anything already on the bus counts as new for the first wait
+    uint64_t m_seen_version = UINT64_MAX;
+};
+
+class Loopback_Sender : public Metadata_Sender {
+public:
+    Loopback_Sender(std::shared_ptr<Loopback_Bus> p_bus, std::string_view name)
+        : m_p_bus(std::move(p_bus))
+        , m_name(name) {
+        std::lock_guard lock(m_p_bus->mutex);
+        m_p_bus->senders.push_back(m_name);
+        m_p_bus->NotifyChanged(m_name);
+    }
+
+    ~Loopback_Sender() override {
+        std::lock_guard lock(m_p_bus->mutex);
+        auto            it = std::find(m_p_bus->senders.begin(), m_p_bus->senders.end(), m_name);
+        if (it != m_p_bus->senders.end()) {
+            m_p_bus->senders.erase(it);
+        }
+        m_p_bus->NotifyChanged(m_name);
+    }
+
+    void Send(std::string_view payload, int64_t timecode) override {
+        if (timecode == TIMECODE_SYNTHESIZE) {
+            timecode = CurrentTimecode();
+        }
+
+        std::lock_guard lock(m_p_bus->mutex);
+
+        for (auto* receiver : m_p_bus->receivers) {
+            if (receiver->connected_name != m_name) {
+                continue;
+            }
+
+            std::lock_guard receiver_lock(receiver->mutex);
+
+            if (receiver->frames.size() >= LOOPBACK_QUEUE_LIMIT) {
+                receiver->free_payloads.push_back(std::move(receiver->frames.front().payload));
+                receiver->frames.pop_front();
+                receiver->dropped++;
+            }
+
+            Loopback_Queued_Frame frame;
+            if (!receiver->free_payloads.empty()) {
+                frame.payload = std::move(receiver->free_payloads.back());
+                receiver->free_payloads.pop_back();
+            }
+            frame.payload.assign(payload);
+            frame.timecode = timecode;
+
+            receiver->frames.push_back(std::move(frame));
+            receiver->cv.notify_one();
+            receiver->SetReady();
+        }
+    }
+
+    int GetConnectionCount(uint32_t timeout_ms) override {
+        std::unique_lock lock(m_p_bus->mutex);
+
+        const auto count_connections = [this] {
+            return static_cast<int>(std::count_if(
+                m_p_bus->receivers.begin(), m_p_bus->receivers.end(),
+                [this](const Loopback_Receiver_State* receiver) { return receiver->connected_name == m_name; }));
+        };
+
+        m_p_bus->changed_cv.wait_for(
+            lock, std::chrono::milliseconds(timeout_ms),
+            [&] { return count_connections() > 0; });
+
+        return count_connections();
+    }
+
+private:
+    std::shared_ptr<Loopback_Bus> m_p_bus;
+    std::string                   m_name;
+};
+
+class Loopback_Receiver : public Metadata_Receiver {
+public:
+    Loopback_Receiver(std::shared_ptr<Loopback_Bus> p_bus)
+        : m_p_bus(std::move(p_bus)) {
+#ifdef __linux__
+        m_state.ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+        std::lock_guard lock(m_p_bus->mutex);
+        m_p_bus->receivers.push_back(&m_state);
+    }
+
+    ~Loopback_Receiver() override {
+        {
+            std::lock_guard lock(m_p_bus->mutex);
+            std::erase(m_p_bus->receivers, &m_state);
+            m_p_bus->version++;
+            m_p_bus->changed_cv.notify_all();
+        }
+#ifdef __linux__
+        if (m_state.ready_fd >= 0) {
+            close(m_state.ready_fd);
+        }
+#endif
+    }
+
+    void Connect(const MIDI_Source* source) override {
+        std::lock_guard lock(m_p_bus->mutex);
+
+        m_state.connected_name = source ? source->name : std::string();
+
+        // wakes senders waiting for a connection
+        m_p_bus->version++;
+        m_p_bus->changed_cv.notify_all();
+
+        std::lock_guard receiver_lock(m_state.mutex);
+        m_state.frames.clear();
+        m_state.status_changed = true;
+        m_state.SetReady();
+    }
+
+    Capture_Result Capture(uint32_t timeout_ms, Metadata_Frame& frame) override {
+        std::unique_lock lock(m_state.mutex);
+
+        m_state.cv.wait_for(
+            lock, std::chrono::milliseconds(timeout_ms),
+            [this] { return m_state.status_changed || !m_state.frames.empty(); });
+
+        if (m_state.status_changed) {
+            m_state.status_changed = false;
+            if (m_state.frames.empty()) {
+                m_state.ClearReady();
+            }
+            return Capture_Result::StatusChange;
+        }
+
+        if (m_state.frames.empty()) {
+            m_state.ClearReady();
+            return Capture_Result::None;
+        }
+
+        // hand out the payload buffer, it goes back to the free list in FreeFrame
+        m_current = std::move(m_state.frames.front());
+        m_state.frames.pop_front();
+
+        if (m_state.frames.empty()) {
+            m_state.ClearReady();
+        }
+
+        frame.data     = m_current.payload;
+        frame.timecode = m_current.timecode;
+        return Capture_Result::Metadata;
+    }
+
+    void FreeFrame(Metadata_Frame& frame) override {
+        frame.data = {};
+
+        std::lock_guard lock(m_state.mutex);
+        m_state.free_payloads.push_back(std::move(m_current.payload));
+        m_current.payload.clear();
+    }
+
+    int GetConnectionCount() override {
+        std::lock_guard lock(m_p_bus->mutex);
+        return !m_state.connected_name.empty() && m_p_bus->HasSender(m_state.connected_name) ? 1 : 0;
+    }
+
+    uint64_t GetDroppedFrames() override {
+        std::lock_guard lock(m_state.mutex);
+        return m_state.dropped;
+    }
+
+    int GetReadyFd() override {
+        return m_state.ready_fd;
+    }
+
+private:
+    std::shared_ptr<Loopback_Bus> m_p_bus;
+    Loopback_Receiver_State       m_state;
+    Loopback_Queued_Frame         m_current;
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifdef MIDI_TO_NDI_WITH_NDI
+
+NDI_Transport::NDI_Transport() {
+    m_initialized = NDIlib_initialize();
+
+    if (!m_initialized) {
+        std::println("cannot initialize NDI, the CPU may not be supported");
+    }
+}
+
+NDI_Transport::~NDI_Transport() {
+    if (m_initialized) {
+        NDIlib_destroy();
+    }
+}
+
+std::unique_ptr<Metadata_Finder> NDI_Transport::CreateFinder() {
+    return std::make_unique<NDI_Finder>();
+}
+
+std::unique_ptr<Metadata_Sender> NDI_Transport::CreateSender(std::string_view name) {
+    return std::make_unique<NDI_Sender>(name);
+}
+
+std::unique_ptr<Metadata_Receiver> NDI_Transport::CreateReceiver(std::string_view name) {
+    return std::make_unique<NDI_Receiver>(name);
+}
+
+#endif // MIDI_TO_NDI_WITH_NDI
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Timecode
+
+namespace {
+
+struct Timecode_Anchor {
+    std::chrono::steady_clock::time_point steady   = std::chrono::steady_clock::now();
+    int64_t                               timecode = std::chrono::duration_cast<Timecode_Duration>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+};
+
+const Timecode_Anchor& GetTimecodeAnchor() {
+    static const Timecode_Anchor anchor;
+    return anchor;
+}
+
+} // namespace
+
+int64_t SteadyToTimecode(std::chrono::steady_clock::time_point time) {
+    const auto& anchor = GetTimecodeAnchor();
+    return anchor.timecode + std::chrono::duration_cast<Timecode_Duration>(time - anchor.steady).count();
+}
+
+std::chrono::steady_clock::time_point TimecodeToSteady(int64_t timecode) {
+    const auto& anchor = GetTimecodeAnchor();
+    return anchor.steady + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               Timecode_Duration(timecode - anchor.timecode));
+}
+
+int64_t CurrentTimecode() {
+    return SteadyToTimecode(std::chrono::steady_clock::now());
+}
+
+Loopback_Transport::Loopback_Transport()
+    : m_p_bus(std::make_shared<Loopback_Bus>()) {}
+
+Loopback_Transport::~Loopback_Transport() = default;
+
+std::unique_ptr<Metadata_Finder> Loopback_Transport::CreateFinder() {
+    return std::make_unique<Loopback_Finder>(m_p_bus);
+}
+
+std::unique_ptr<Metadata_Sender> Loopback_Transport::CreateSender(std::string_view name) {
+    return std::make_unique<Loopback_Sender>(m_p_bus, name);
+}
+
+std::unique_ptr<Metadata_Receiver> Loopback_Transport::CreateReceiver(std::string_view) {
+    return std::make_unique<Loopback_Receiver>(m_p_bus);
+}
+
+std::shared_ptr<MIDI_Transport> CreateTransport(std::string_view name) {
+    if (name == "ndi") {
+#ifdef MIDI_TO_NDI_WITH_NDI
+        return std::make_shared<NDI_Transport>();
+#else
+        std::println("this build has no NDI support, the NDI SDK was not found when it was configured");
+        return nullptr;
+#endif
+    }
+    if (name == "loopback") {
+        return std::make_shared<Loopback_Transport>();
+    }
+    return nullptr;
+}
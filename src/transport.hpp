@@ -0,0 +1,146 @@
+#pragma once
+
+#include "pch.hpp"
+
+// lets the transport pick the timecode, same value as NDIlib_send_timecode_synthesize
+constexpr int64_t TIMECODE_SYNTHESIZE = INT64_MAX;
+
+// NDI timecodes count 100 ns units
+using Timecode_Duration = std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>;
+
+// maps steady_clock onto the timecode timeline, anchored to UTC once per process
+// like synthesized NDI timecodes, so the result is monotonic and comparable across hosts with synced clocks
+[[nodiscard]]
+int64_t SteadyToTimecode(std::chrono::steady_clock::time_point time);
+
+[[nodiscard]]
+std::chrono::steady_clock::time_point TimecodeToSteady(int64_t timecode);
+
+[[nodiscard]]
+int64_t CurrentTimecode();
+
+// a discovered source, owns its strings unlike NDIlib_source_t
+struct MIDI_Source {
+    std::string name;
+    std::string url;
+};
+
+// a captured metadata frame, data stays valid until Metadata_Receiver::FreeFrame
+struct Metadata_Frame {
+    std::string_view data;
+    int64_t          timecode = 0;
+};
+
+enum class Capture_Result : uint8_t {
+    None,
+    Metadata,
+    StatusChange,
+};
+
+class Metadata_Finder {
+public:
+    virtual ~Metadata_Finder() = default;
+
+    // returns true if the source list changed within timeout_ms
+    virtual bool WaitForSources(uint32_t timeout_ms) = 0;
+
+    [[nodiscard]]
+    virtual std::vector<MIDI_Source> GetCurrentSources() = 0;
+};
+
+class Metadata_Sender {
+public:
+    virtual ~Metadata_Sender() = default;
+
+    // payload has to be null terminated, the terminator is not part of payload.size()
+    virtual void Send(std::string_view payload, int64_t timecode) = 0;
+
+    [[nodiscard]]
+    virtual int GetConnectionCount(uint32_t timeout_ms) = 0;
+};
+
+class Metadata_Receiver {
+public:
+    virtual ~Metadata_Receiver() = default;
+
+    // nullptr disconnects
+    virtual void Connect(const MIDI_Source* source) = 0;
+
+    // at most one frame may be held at a time
+    [[nodiscard]]
+    virtual Capture_Result Capture(uint32_t timeout_ms, Metadata_Frame& frame) = 0;
+
+    virtual void FreeFrame(Metadata_Frame& frame) = 0;
+
+    [[nodiscard]]
+    virtual int GetConnectionCount() = 0;
+
+    // metadata frames lost before they were captured, e.g. because capture did not keep up
+    [[nodiscard]]
+    virtual uint64_t GetDroppedFrames() = 0;
+
+    // a descriptor that is readable while Capture(0) may return something, for event loops like
+    // Event_Reactor, -1 if the transport has none and has to be polled
+    [[nodiscard]]
+    virtual int GetReadyFd() {
+        return -1;
+    }
+};
+
+// creates the discovery, send and receive endpoints of one transport
+// the transport has to outlive everything it created
+class MIDI_Transport {
+public:
+    virtual ~MIDI_Transport() = default;
+
+    [[nodiscard]]
+    virtual std::unique_ptr<Metadata_Finder> CreateFinder() = 0;
+
+    [[nodiscard]]
+    virtual std::unique_ptr<Metadata_Sender> CreateSender(std::string_view name) = 0;
+
+    [[nodiscard]]
+    virtual std::unique_ptr<Metadata_Receiver> CreateReceiver(std::string_view name) = 0;
+};
+
+#ifdef MIDI_TO_NDI_WITH_NDI
+
+// the NDI runtime, initialized once for everything created from it
+class NDI_Transport : public MIDI_Transport {
+public:
+    NDI_Transport();
+    ~NDI_Transport() override;
+
+    NDI_Transport(const NDI_Transport&)            = delete;
+    NDI_Transport& operator=(const NDI_Transport&) = delete;
+
+    std::unique_ptr<Metadata_Finder>   CreateFinder() override;
+    std::unique_ptr<Metadata_Sender>   CreateSender(std::string_view name) override;
+    std::unique_ptr<Metadata_Receiver> CreateReceiver(std::string_view name) override;
+
+private:
+    bool m_initialized = false;
+};
+
+#endif // MIDI_TO_NDI_WITH_NDI
+
+struct Loopback_Bus;
+
+// in-process stand-in for NDI: senders and receivers created from the same instance
+// exchange the same metadata payloads without any network or NDI runtime
+class Loopback_Transport : public MIDI_Transport {
+public:
+    Loopback_Transport();
+    ~Loopback_Transport() override;
+
+    std::unique_ptr<Metadata_Finder>   CreateFinder() override;
+    std::unique_ptr<Metadata_Sender>   CreateSender(std::string_view name) override;
+    std::unique_ptr<Metadata_Receiver> CreateReceiver(std::string_view name) override;
+
+private:
+    std::shared_ptr<Loopback_Bus> m_p_bus;
+};
+
+// "ndi" or "loopback", nullptr for anything else and for "ndi" in a build without the NDI SDK
+[[nodiscard]]
+std::shared_ptr<MIDI_Transport> CreateTransport(std::string_view name);
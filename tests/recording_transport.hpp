@@ -0,0 +1,90 @@
+#pragma once
+
+#include "pch.hpp"
+#include "ndimidi.hpp"
+#include "transport.hpp"
+
+// a transport whose senders keep every payload they are given instead of delivering it, optionally taking their
+// time like a congested NDI sender, and report whatever connection count the test sets
+class Recording_Transport : public MIDI_Transport {
+public:
+    struct Sent_Frame {
+        std::string payload;
+        int64_t     timecode = 0;
+    };
+
+    std::unique_ptr<Metadata_Finder> CreateFinder() override {
+        return nullptr;
+    }
+
+    std::unique_ptr<Metadata_Sender> CreateSender(std::string_view name) override {
+        return std::make_unique<Recording_Sender>(m_p_state);
+    }
+
+    std::unique_ptr<Metadata_Receiver> CreateReceiver(std::string_view name) override {
+        return nullptr;
+    }
+
+    void SetSendDelay(std::chrono::microseconds delay) {
+        m_p_state->send_delay_us = delay.count();
+    }
+
+    void SetConnections(int connections) {
+        m_p_state->connections = connections;
+    }
+
+    [[nodiscard]]
+    std::vector<Sent_Frame> GetSent() const {
+        std::lock_guard lock(m_p_state->mutex);
+        return m_p_state->sent;
+    }
+
+    // every message of every frame sent so far, in order, each with the timecode of its frame
+    [[nodiscard]]
+    std::vector<std::pair<std::vector<uint8_t>, int64_t>> GetSentMessages() const {
+        std::vector<std::pair<std::vector<uint8_t>, int64_t>> messages;
+
+        MIDI_Frame frame;
+        for (const auto& sent : GetSent()) {
+            if (NDI_MIDI_Manager::ParseMIDIMessage(sent.payload, frame) != MIDI_Parse_Status::Ok) {
+                continue;
+            }
+            for (size_t i = 0; i < frame.Count(); i++) {
+                const auto message = frame.Message(i);
+                messages.emplace_back(std::vector<uint8_t>(message.begin(), message.end()), sent.timecode);
+            }
+        }
+        return messages;
+    }
+
+private:
+    struct State {
+        std::mutex              mutex;
+        std::vector<Sent_Frame> sent;
+        std::atomic<int64_t>    send_delay_us = 0;
+        std::atomic<int>        connections   = 1;
+    };
+
+    class Recording_Sender : public Metadata_Sender {
+    public:
+        explicit Recording_Sender(std::shared_ptr<State> p_state) : m_p_state(std::move(p_state)) {}
+
+        void Send(std::string_view payload, int64_t timecode) override {
+            if (const int64_t delay_us = m_p_state->send_delay_us.load()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+            }
+
+            std::lock_guard lock(m_p_state->mutex);
+            m_p_state->sent.push_back(Sent_Frame{std::string(payload), timecode});
+        }
+
+        int GetConnectionCount(uint32_t timeout_ms) override {
+            return m_p_state->connections.load();
+        }
+
+    private:
+        std::shared_ptr<State> m_p_state;
+    };
+
+    std::shared_ptr<State> m_p_state = std::make_shared<State>();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pch.hpp"
+
+// a minimal test runner: every TEST_CASE registers itself before main runs, a failed CHECK is reported with
+// its location and the test goes on, so one run shows every failure
+
+using Test_Function = void (*)();
+
+struct Test_Case {
+    std::string_view name;
+    Test_Function    function;
+};
+
+[[nodiscard]]
+std::vector<Test_Case>& GetTestCases();
+
+void ReportFailure(std::string_view file, int line, std::string_view expression);
+
+struct Test_Registration {
+    Test_Registration(std::string_view name, Test_Function function) {
+        GetTestCases().push_back(Test_Case{name, function});
+    }
+};
+
+#define TEST_CASE(name)                                                    \
+    static void              name();                                       \
+    static Test_Registration name##_registration(#name, name);             \
+    static void              name()
+
+#define CHECK(expression) ((expression) ? void(0) : ReportFailure(__FILE__, __LINE__, #expression))
+
+// polls condition until it holds or timeout passed, for results that arrive on another thread
+template <typename Condition>
+[[nodiscard]]
+bool WaitUntil(Condition&& condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000)) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
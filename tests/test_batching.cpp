@@ -0,0 +1,78 @@
+#include "recording_transport.hpp"
+#include "test.hpp"
+
+TEST_CASE(batching_puts_several_elements_in_one_frame) {
+    auto transport = std::make_shared<Recording_Transport>();
+
+    MIDI_Sender sender(transport->CreateSender("Stage"));
+    // flushed by hand, like the event loop does
+    sender.SetBatching(std::chrono::microseconds(100'000), 1024, false);
+
+    uint8_t messages[3][3] = {{0xB0, 7, 64}, {0xB0, 7, 65}, {0x90, 60, 100}};
+    sender.SendMIDI(messages[0], 100);
+    sender.SendMIDI(messages[1], 200);
+    sender.SendMIDI(messages[2], 300);
+    CHECK(transport->GetSent().empty());
+
+    sender.FlushMIDI();
+
+    const auto sent = transport->GetSent();
+    CHECK(sent.size() == 1);
+    if (sent.size() == 1) {
+        CHECK(sent[0].payload == "<MIDI>B00740</MIDI><MIDI>B00741</MIDI><MIDI>903C64</MIDI>");
+        // the capture time of the first message
+        CHECK(sent[0].timecode == 100);
+    }
+
+    MIDI_Frame frame;
+    CHECK(NDI_MIDI_Manager::ParseMIDIMessage(sent.front().payload, frame) == MIDI_Parse_Status::Ok);
+    CHECK(frame.Count() == 3);
+}
+
+TEST_CASE(batching_starts_a_new_frame_at_the_size_limit) {
+    auto transport = std::make_shared<Recording_Transport>();
+
+    // room for two 19 character elements per frame
+    MIDI_Sender sender(transport->CreateSender("Stage"));
+    sender.SetBatching(std::chrono::microseconds(100'000), 40, false);
+
+    for (uint8_t value = 0; value < 5; value++) {
+        uint8_t message[3] = {0xB0, 1, value};
+        sender.SendMIDI(message, value + 1);
+    }
+    sender.FlushMIDI();
+
+    const auto sent = transport->GetSent();
+    CHECK(sent.size() == 3);
+    for (const auto& frame : sent) {
+        CHECK(frame.payload.size() <= 40);
+    }
+
+    // nothing lost or reordered across the frames
+    const auto messages = transport->GetSentMessages();
+    CHECK(messages.size() == 5);
+    for (size_t i = 0; i < messages.size(); i++) {
+        CHECK(messages[i].first[2] == i);
+    }
+
+    // a sysex larger than the limit goes out on its own
+    std::vector<uint8_t> sysex(64, 0x10);
+    sysex.front() = 0xF0;
+    sysex.back()  = 0xF7;
+    sender.SendMIDI(sysex);
+    CHECK(transport->GetSent().size() == 4);
+}
+
+TEST_CASE(batching_flushes_when_the_window_expires) {
+    auto transport = std::make_shared<Recording_Transport>();
+
+    MIDI_Sender sender(transport->CreateSender("Stage"));
+    sender.SetBatching(std::chrono::microseconds(2000), 1024);
+
+    uint8_t messages[2][3] = {{0x90, 60, 100}, {0x80, 60, 0}};
+    sender.SendMIDI(messages[0]);
+    sender.SendMIDI(messages[1]);
+
+    CHECK(WaitUntil([&] { return transport->GetSent().size() == 1; }));
+    CHECK(transport->GetSentMessages().size() == 2);
+}
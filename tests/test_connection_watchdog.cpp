@@ -0,0 +1,117 @@
+#include "connection_watchdog.hpp"
+#include "test.hpp"
+
+// the loopback transport, except that a receiver only reaches the sender that existed when it last connected:
+// after the sender restarted it has to connect again, like an NDI receiver whose source came back on a new URL
+class Restarting_Transport : public MIDI_Transport {
+public:
+    std::unique_ptr<Metadata_Finder> CreateFinder() override {
+        return m_loopback.CreateFinder();
+    }
+
+    std::unique_ptr<Metadata_Sender> CreateSender(std::string_view name) override {
+        // before the sender shows up, a receiver connecting because of it already gets the new generation
+        m_p_generation->fetch_add(1);
+        return m_loopback.CreateSender(name);
+    }
+
+    std::unique_ptr<Metadata_Receiver> CreateReceiver(std::string_view name) override {
+        return std::make_unique<Restarting_Receiver>(m_loopback.CreateReceiver(name), m_p_generation);
+    }
+
+private:
+    class Restarting_Receiver : public Metadata_Receiver {
+    public:
+        Restarting_Receiver(std::unique_ptr<Metadata_Receiver> p_receiver, std::shared_ptr<std::atomic<uint64_t>> p_generation)
+            : m_p_receiver(std::move(p_receiver))
+            , m_p_generation(std::move(p_generation)) {}
+
+        void Connect(const MIDI_Source* source) override {
+            m_connected_generation = m_p_generation->load();
+            m_p_receiver->Connect(source);
+        }
+
+        Capture_Result Capture(uint32_t timeout_ms, Metadata_Frame& frame) override {
+            return m_p_receiver->Capture(timeout_ms, frame);
+        }
+
+        void FreeFrame(Metadata_Frame& frame) override {
+            m_p_receiver->FreeFrame(frame);
+        }
+
+        int GetConnectionCount() override {
+            return m_connected_generation == m_p_generation->load() ? m_p_receiver->GetConnectionCount() : 0;
+        }
+
+        uint64_t GetDroppedFrames() override {
+            return m_p_receiver->GetDroppedFrames();
+        }
+
+    private:
+        std::unique_ptr<Metadata_Receiver>     m_p_receiver;
+        std::shared_ptr<std::atomic<uint64_t>> m_p_generation;
+        std::atomic<uint64_t>                  m_connected_generation = 0;
+    };
+
+    Loopback_Transport                     m_loopback;
+    std::shared_ptr<std::atomic<uint64_t>> m_p_generation = std::make_shared<std::atomic<uint64_t>>(0);
+};
+
+TEST_CASE(watchdog_reconnects_a_restarted_sender) {
+    auto transport = std::make_shared<Restarting_Transport>();
+
+    MIDI_Source_Discovery discovery(transport);
+
+    auto sender = transport->CreateSender("Stage");
+
+    std::vector<std::unique_ptr<MIDI_Receiver>> receivers;
+    receivers.push_back(std::make_unique<MIDI_Receiver>(transport->CreateReceiver("Monitor")));
+
+    const MIDI_Source source{"Stage", ""};
+    receivers[0]->Connect(&source);
+
+    MIDI_Connection_Watchdog watchdog(discovery, {"Stage"}, receivers);
+
+    const auto connected = [&watchdog] { return watchdog.GetStats()[0].connected; };
+
+    CHECK(WaitUntil(connected));
+    CHECK(watchdog.GetStats()[0].outages == 0);
+
+    // gone long enough for the reconnect attempts to back off to a second: 500 ms grace, then after 250 and 500 ms
+    sender.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    auto stats = watchdog.GetStats()[0];
+    CHECK(!stats.connected);
+    CHECK(stats.outages == 1);
+    CHECK(stats.reconnect_attempts >= 2);
+
+    const auto restart = std::chrono::steady_clock::now();
+    sender             = transport->CreateSender("Stage");
+
+    CHECK(WaitUntil(connected));
+    const auto reconnected_after = std::chrono::steady_clock::now() - restart;
+
+    // the next attempt of the backoff was more than 500 ms away, discovery seeing the source skips it
+    stats = watchdog.GetStats()[0];
+    CHECK(stats.outages == 1);
+    CHECK(reconnected_after < std::chrono::milliseconds(400));
+    CHECK(stats.last_reconnect_time < std::chrono::milliseconds(300));
+    CHECK(stats.last_outage >= std::chrono::milliseconds(1400));
+    CHECK(stats.max_outage == stats.last_outage);
+
+    // a second restart is a second outage, the attempt at the end of the grace period and the one for discovery
+    const auto attempts_before = stats.reconnect_attempts;
+
+    sender.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    sender = transport->CreateSender("Stage");
+
+    CHECK(WaitUntil(connected));
+
+    stats = watchdog.GetStats()[0];
+    CHECK(stats.outages == 2);
+    CHECK(stats.reconnect_attempts - attempts_before <= 3);
+    CHECK(stats.last_reconnect_time < std::chrono::milliseconds(300));
+    CHECK(stats.total_outage >= stats.max_outage + stats.last_outage);
+}
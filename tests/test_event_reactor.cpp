@@ -0,0 +1,60 @@
+#include "event_reactor.hpp"
+#include "test.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+
+// what the event loop does with stdin: at the end of a pipe the read end stays readable, so its handler takes
+// itself out of the loop instead of being woken over and over
+TEST_CASE(event_reactor_handler_can_remove_itself) {
+    int pipe_fds[2];
+    CHECK(pipe(pipe_fds) == 0);
+
+    Event_Reactor reactor;
+    CHECK(reactor.IsValid());
+
+    int  reads  = 0;
+    bool at_end = false;
+
+    const bool added = reactor.Add(pipe_fds[0], [&] {
+        char       buffer[16];
+        const auto length = read(pipe_fds[0], buffer, sizeof(buffer));
+        reads++;
+
+        if (length <= 0) {
+            at_end = true;
+            reactor.Remove(pipe_fds[0]);
+        }
+    });
+    CHECK(added);
+
+    CHECK(write(pipe_fds[1], "x", 1) == 1);
+    close(pipe_fds[1]);
+
+    // runs for a while after the end of the pipe, a handler still registered would be run on every wake up
+    const auto stop_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    reactor.Run([&](std::chrono::steady_clock::time_point now) -> std::optional<std::chrono::steady_clock::time_point> {
+        if (now >= stop_time) {
+            reactor.Stop();
+        }
+        return stop_time;
+    });
+
+    CHECK(at_end);
+    CHECK(reads == 2);
+
+    close(pipe_fds[0]);
+}
+
+// stdin redirected from /dev/null or a file cannot be watched, the event loop then runs without a console
+TEST_CASE(event_reactor_refuses_what_epoll_cannot_watch) {
+    const int fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+
+    Event_Reactor reactor;
+    CHECK(!reactor.Add(fd, [] {}));
+
+    close(fd);
+}
+#endif
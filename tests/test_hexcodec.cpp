@@ -0,0 +1,172 @@
+#include "hexcodec.hpp"
+#include "ndimidi.hpp"
+#include "test.hpp"
+
+#include <numeric>
+#include <random>
+
+// one table lookup per byte, what EncodeHex does without SSE2 and for the tail after the vector loop
+[[nodiscard]]
+static std::string EncodeHexScalar(std::span<const uint8_t> data) {
+    std::string hex;
+    for (const uint8_t byte : data) {
+        hex += HEX_ENCODE_TABLE[byte][0];
+        hex += HEX_ENCODE_TABLE[byte][1];
+    }
+    return hex;
+}
+
+[[nodiscard]]
+static std::vector<uint8_t> RandomBytes(size_t count, uint32_t seed) {
+    std::mt19937         random(seed);
+    std::vector<uint8_t> bytes(count);
+    for (auto& byte : bytes) {
+        byte = static_cast<uint8_t>(random());
+    }
+    return bytes;
+}
+
+TEST_CASE(hex_encode_table_is_uppercase_hex) {
+    CHECK(std::string_view(HEX_ENCODE_TABLE[0x00].data(), 2) == "00");
+    CHECK(std::string_view(HEX_ENCODE_TABLE[0x9F].data(), 2) == "9F");
+    CHECK(std::string_view(HEX_ENCODE_TABLE[0xAB].data(), 2) == "AB");
+    CHECK(std::string_view(HEX_ENCODE_TABLE[0xFF].data(), 2) == "FF");
+}
+
+TEST_CASE(hex_encode_matches_the_scalar_table_for_lengths_0_to_64) {
+    for (size_t length = 0; length <= 64; length++) {
+        const auto bytes = RandomBytes(length + 1, static_cast<uint32_t>(length));
+
+        // from an unaligned source too, the vector loop loads unaligned
+        for (size_t offset = 0; offset < 2; offset++) {
+            const std::span<const uint8_t> data(bytes.data() + offset, length);
+
+            // guard characters after the output must stay untouched
+            std::string out(EncodedHexSize(length) + 4, '#');
+            const size_t written = EncodeHex(data, out.data());
+
+            CHECK(written == EncodedHexSize(length));
+            CHECK(out.substr(0, written) == EncodeHexScalar(data));
+            CHECK(out.substr(written) == "####");
+        }
+    }
+}
+
+TEST_CASE(hex_encode_covers_every_byte_value) {
+    std::vector<uint8_t> bytes(256);
+    std::iota(bytes.begin(), bytes.end(), 0);
+
+    std::string out(EncodedHexSize(bytes.size()), '\0');
+    CHECK(EncodeHex(bytes, out.data()) == out.size());
+    CHECK(out == EncodeHexScalar(bytes));
+}
+
+// the reverse of EncodeHexScalar, one table lookup per character
+[[nodiscard]]
+static std::optional<std::vector<uint8_t>> DecodeHexScalar(std::string_view hex) {
+    if (hex.size() % 2 != 0) {
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        const uint8_t hi = HEX_DECODE_TABLE[static_cast<uint8_t>(hex[i])];
+        const uint8_t lo = HEX_DECODE_TABLE[static_cast<uint8_t>(hex[i + 1])];
+        if ((hi | lo) & 0xF0) {
+            return std::nullopt;
+        }
+        bytes.push_back(static_cast<uint8_t>((hi << 4) | lo));
+    }
+    return bytes;
+}
+
+TEST_CASE(hex_decode_round_trips_for_lengths_0_to_64) {
+    for (size_t length = 0; length <= 64; length++) {
+        const auto bytes = RandomBytes(length, static_cast<uint32_t>(length) + 100);
+
+        std::string hex(EncodedHexSize(length), '\0');
+        EncodeHex(bytes, hex.data());
+
+        // lowercase digits are accepted as well
+        std::string lower = hex;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+
+        for (const std::string& input : {hex, lower}) {
+            std::vector<uint8_t> out(length + 1, 0xEE);
+
+            CHECK(DecodeHex(input, out.data()));
+            CHECK(std::equal(bytes.begin(), bytes.end(), out.begin()));
+            CHECK(out[length] == 0xEE);
+            CHECK(DecodeHexScalar(input) == bytes);
+        }
+    }
+}
+
+TEST_CASE(hex_decode_rejects_odd_lengths) {
+    uint8_t out[40];
+    for (size_t length = 1; length <= 65; length += 2) {
+        CHECK(!DecodeHex(std::string(length, 'A'), out));
+    }
+}
+
+TEST_CASE(hex_decode_rejects_a_non_hex_character_anywhere) {
+    // characters next to the digit and letter ranges, and bytes that are negative as signed char
+    constexpr char invalid[] = {'/', ':', '@', 'G', '`', 'g', ' ', '\0', '\x80', '\xFF'};
+
+    for (const size_t length : {2, 30, 32, 34, 64}) {
+        for (size_t position = 0; position < length; position++) {
+            for (const char c : invalid) {
+                std::string hex(length, '7');
+                hex[position] = c;
+
+                std::vector<uint8_t> out(length / 2);
+                CHECK(!DecodeHex(hex, out.data()));
+                CHECK(!DecodeHexScalar(hex));
+            }
+        }
+    }
+}
+
+TEST_CASE(parse_midi_message_decodes_one_or_more_elements) {
+    MIDI_Frame frame;
+
+    CHECK(NDI_MIDI_Manager::ParseMIDIMessage("<MIDI>903C64</MIDI>", frame) == MIDI_Parse_Status::Ok);
+    CHECK(frame.Count() == 1);
+    CHECK((std::vector<uint8_t>(frame.bytes) == std::vector<uint8_t>{0x90, 0x3C, 0x64}));
+
+    // whitespace between the elements and the null terminator counted into the length
+    constexpr std::string_view batched("<MIDI>903c64</MIDI>\n<MIDI>F07E7F0601F7</MIDI> <MIDI>C005</MIDI>\0", 64);
+    CHECK(NDI_MIDI_Manager::ParseMIDIMessage(batched, frame) == MIDI_Parse_Status::Ok);
+    CHECK(frame.Count() == 3);
+    if (frame.Count() == 3) {
+        CHECK(frame.Message(0).size() == 3);
+        CHECK(frame.Message(1).size() == 6);
+        CHECK(frame.Message(1)[0] == 0xF0);
+        CHECK(frame.Message(2)[1] == 0x05);
+    }
+}
+
+TEST_CASE(parse_midi_message_rejects_malformed_frames) {
+    MIDI_Frame frame;
+
+    const std::pair<std::string_view, MIDI_Parse_Status> cases[] = {
+        {"",                                     MIDI_Parse_Status::InvalidFrame},
+        {"   ",                                  MIDI_Parse_Status::InvalidFrame},
+        {"<MIDI>903C64",                         MIDI_Parse_Status::InvalidFrame}, // unterminated
+        {"<MIDI>903C64</MIDI><MIDI>803C",        MIDI_Parse_Status::InvalidFrame}, // second one unterminated
+        {"<MIDI></MIDI>",                        MIDI_Parse_Status::InvalidFrame}, // empty
+        {"<midi>903C64</midi>",                  MIDI_Parse_Status::InvalidFrame},
+        {"<ndi_tally/>",                         MIDI_Parse_Status::InvalidFrame},
+        {"<MIDI>903C64</MIDI>junk",              MIDI_Parse_Status::InvalidFrame},
+        {"<MIDI>903C6</MIDI>",                   MIDI_Parse_Status::InvalidHex},   // odd length
+        {"<MIDI>903G64</MIDI>",                  MIDI_Parse_Status::InvalidHex},
+        {"<MIDI>90 3C 64</MIDI>",                MIDI_Parse_Status::InvalidHex},
+        {"<MIDI>903C64</MIDI><MIDI>80XX</MIDI>", MIDI_Parse_Status::InvalidHex},
+    };
+
+    for (const auto& [message, status] : cases) {
+        CHECK(NDI_MIDI_Manager::ParseMIDIMessage(message, frame) == status);
+        // nothing of a rejected frame is left behind
+        CHECK(frame.Count() == 0);
+    }
+}
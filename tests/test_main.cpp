@@ -0,0 +1,44 @@
+#include "test.hpp"
+
+namespace {
+
+size_t failures = 0;
+
+} // namespace
+
+std::vector<Test_Case>& GetTestCases() {
+    static std::vector<Test_Case> test_cases;
+    return test_cases;
+}
+
+void ReportFailure(std::string_view file, int line, std::string_view expression) {
+    std::println("\t{}:{}: CHECK({}) failed", file, line, expression);
+    failures++;
+}
+
+// runs every test, or only those whose name contains the first argument
+int main(int argc, char** argv) {
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+
+    size_t failed_tests = 0;
+    size_t run_tests    = 0;
+
+    for (const auto& test_case : GetTestCases()) {
+        if (!filter.empty() && test_case.name.find(filter) == std::string_view::npos) {
+            continue;
+        }
+
+        std::println("{}", test_case.name);
+
+        const size_t failures_before = failures;
+        test_case.function();
+
+        run_tests++;
+        if (failures > failures_before) {
+            failed_tests++;
+        }
+    }
+
+    std::println("{} of {} tests failed", failed_tests, run_tests);
+    return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+#include "test.hpp"
+
+// every operator new of the test binary goes through here, only the thread that set g_count_allocations is counted
+static thread_local bool   g_count_allocations = false;
+static thread_local size_t g_allocations       = 0;
+
+void* operator new(std::size_t size) {
+    if (g_count_allocations) {
+        g_allocations++;
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// the bytes of message number index: a note on, or every 61st a sysex of 17 to 400 bytes that spills out of
+// the inline storage, both carry the index so the consumer can check order and content
+static void MakeMessage(uint32_t index, MidiInApi::MidiMessage& message) {
+    message.bytes.clear();
+    message.timeStamp = index;
+
+    if (index % 61 != 0) {
+        message.bytes.push_back(static_cast<unsigned char>(0x90 | (index & 0x0F)));
+        message.bytes.push_back(static_cast<unsigned char>((index >> 4) & 0x7F));
+        message.bytes.push_back(static_cast<unsigned char>((index >> 11) & 0x7F));
+        return;
+    }
+
+    const size_t size = 17 + index % 384;
+    message.bytes.push_back(0xF0);
+    while (message.bytes.size() < size - 1) {
+        message.bytes.push_back(static_cast<unsigned char>((index + message.bytes.size()) & 0x7F));
+    }
+    message.bytes.push_back(0xF7);
+}
+
+[[nodiscard]]
+static bool IsMessage(uint32_t index, std::span<const unsigned char> bytes) {
+    MidiInApi::MidiMessage expected;
+    MakeMessage(index, expected);
+    return std::equal(bytes.begin(), bytes.end(), expected.bytes.begin(), expected.bytes.end());
+}
+
+TEST_CASE(midi_queue_keeps_order_and_content_under_contention) {
+    constexpr uint32_t MESSAGES = 200000;
+
+    // small enough that the producer keeps running into a full ring and the sysex pool runs dry
+    MidiInApi::MidiQueue queue;
+    queue.allocate(16, 2, 64);
+
+    std::atomic<uint32_t> refused = 0;
+
+    std::jthread producer([&] {
+        MidiInApi::MidiMessage message;
+        for (uint32_t index = 0; index < MESSAGES; index++) {
+            MakeMessage(index, message);
+            while (!queue.push(message)) {
+                refused.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::vector<unsigned char>          bytes;
+    std::vector<RtMidiIn::MessageInfo> info;
+    uint32_t                            received = 0;
+    bool                                in_order = true;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+
+    while (received < MESSAGES && std::chrono::steady_clock::now() < deadline) {
+        // alternate between the batch and the single message path, both recycle the sysex buffers
+        if (received % 2 == 0) {
+            if (!queue.wait(10)) {
+                continue;
+            }
+
+            bytes.clear();
+            info.clear();
+            queue.drain(&bytes, &info, 0);
+
+            for (const auto& entry : info) {
+                const std::span<const unsigned char> message(bytes.data() + entry.offset, entry.size);
+                if (entry.timeStamp != received || !IsMessage(received, message)) {
+                    in_order = false;
+                }
+                received++;
+            }
+        } else {
+            std::vector<unsigned char> message;
+            double                     time_stamp = 0.0;
+            if (!queue.pop(&message, &time_stamp)) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (time_stamp != received || !IsMessage(received, message)) {
+                in_order = false;
+            }
+            received++;
+        }
+    }
+
+    producer.join();
+
+    CHECK(received == MESSAGES);
+    CHECK(in_order);
+    CHECK(refused.load() > 0);
+    CHECK(queue.size() == 0);
+
+    queue.release();
+}
+
+// an input backend without a device, events go through the decode steps of the ALSA and JACK input handlers
+// and are pushed into the queue the way those handlers do it
+class Test_Input_Api : public MidiInApi {
+public:
+    // the handlers only deliver sysex, clock and active sensing when they are not ignored
+    Test_Input_Api() : MidiInApi(100) {
+        ignoreTypes(false, false, false);
+    }
+
+    RtMidi::Api getCurrentApi() override {
+        return RtMidi::RTMIDI_DUMMY;
+    }
+    void openPort(unsigned int, const std::string&) override {}
+    void openVirtualPort(const std::string&) override {}
+    void closePort() override {}
+    void setClientName(const std::string&) override {}
+    void setPortName(const std::string&) override {}
+    unsigned int getPortCount() override {
+        return 0;
+    }
+    std::string getPortName(unsigned int) override {
+        return "";
+    }
+
+    // alsaMidiHandler: the sequencer hands out sysex in chunks of up to 256 bytes
+    void DecodeAlsa(std::span<const unsigned char> event) {
+        bool continueSysex = false;
+
+        for (size_t offset = 0; offset < event.size(); offset += 256) {
+            const auto chunk = event.subspan(offset, std::min<size_t>(256, event.size() - offset));
+            if (MidiInApi::decodeAlsaEvent(inputData_.message, continueSysex, chunk.data(), chunk.size(), event[0] == 0xF0)) {
+                Push();
+            }
+        }
+    }
+
+    // jackProcessIn: one event of the port buffer
+    void DecodeJack(std::span<const unsigned char> event) {
+        if (MidiInApi::decodeJackEvent(inputData_.message, inputData_.continueSysex, inputData_.ignoreFlags, event.data(), event.size())) {
+            Push();
+        }
+    }
+
+    [[nodiscard]]
+    unsigned int Drain(std::vector<unsigned char>& bytes, std::vector<RtMidiIn::MessageInfo>& info) {
+        return inputData_.queue.drain(&bytes, &info, 0);
+    }
+
+    [[nodiscard]]
+    unsigned int GetSysexBuffers() const {
+        return inputData_.queue.poolSize - 1;
+    }
+
+    [[nodiscard]]
+    size_t GetSysexBufferCapacity() const {
+        return inputData_.queue.pool[inputData_.queue.poolFront.load()].capacity();
+    }
+
+protected:
+    void initialize(const std::string&) override {}
+
+private:
+    void Push() {
+        if (!inputData_.queue.push(inputData_.message)) {
+            inputData_.queueOverflow("Test_Input_Api");
+        }
+    }
+};
+
+[[nodiscard]]
+static std::vector<unsigned char> MakeSysex(size_t size) {
+    std::vector<unsigned char> sysex(size, 0x42);
+    sysex.front() = 0xF0;
+    sysex.back()  = 0xF7;
+    return sysex;
+}
+
+// decodes channel, realtime and sysex messages on both paths and reads them back, returns the allocations the
+// rounds after the first one made
+[[nodiscard]]
+static size_t CountInputAllocations(Test_Input_Api& input, size_t sysex_size) {
+    const std::vector<unsigned char> note_on = {0x90, 60, 100};
+    const std::vector<unsigned char> clock   = {0xF8};
+    const std::vector<unsigned char> sysex   = MakeSysex(sysex_size);
+
+    std::vector<unsigned char>         bytes;
+    std::vector<RtMidiIn::MessageInfo> info;
+    bytes.reserve(64 * 1024);
+    info.reserve(64);
+
+    bool   all_received = true;
+    size_t allocations  = 0;
+
+    for (int round = 0; round < 1000; round++) {
+        // the first round finds the slots without a sysex buffer yet
+        g_allocations       = 0;
+        g_count_allocations = round > 0;
+
+        input.DecodeAlsa(note_on);
+        input.DecodeAlsa(clock);
+        input.DecodeAlsa(sysex);
+        input.DecodeJack(note_on);
+        input.DecodeJack(clock);
+        input.DecodeJack(sysex);
+
+        bytes.clear();
+        info.clear();
+        all_received = all_received && input.Drain(bytes, info) == 6 && info[2].size == sysex_size && info[5].size == sysex_size;
+
+        g_count_allocations  = false;
+        allocations         += g_allocations;
+    }
+
+    CHECK(all_received);
+    return allocations;
+}
+
+TEST_CASE(midi_input_decode_does_not_allocate) {
+    Test_Input_Api input;
+    CHECK(CountInputAllocations(input, 600) == 0);
+}
+
+TEST_CASE(midi_input_set_buffer_size_resizes_the_sysex_pool) {
+    Test_Input_Api input;
+    input.setBufferSize(4096, 8);
+
+    CHECK(input.GetSysexBuffers() == 8);
+    CHECK(input.GetSysexBufferCapacity() >= 4096);
+
+    // larger than the default buffers, would grow them on every round if only the defaults were pooled
+    CHECK(CountInputAllocations(input, 3000) == 0);
+}
@@ -0,0 +1,116 @@
+#include "midi_state.hpp"
+#include "recording_transport.hpp"
+#include "test.hpp"
+
+using Messages = std::vector<std::vector<uint8_t>>;
+
+[[nodiscard]]
+static Messages CollectState(const MIDI_State_Snapshot& state, bool include_notes) {
+    Messages messages;
+    state.ForEachMessage(include_notes, [&](std::span<const uint8_t> message) { messages.emplace_back(message.begin(), message.end()); });
+    return messages;
+}
+
+static void Update(MIDI_State_Snapshot& state, std::initializer_list<uint8_t> message) {
+    const std::vector<uint8_t> bytes(message);
+    state.Update(bytes);
+}
+
+TEST_CASE(midi_state_restores_bank_program_and_notes_in_order) {
+    MIDI_State_Snapshot state;
+    Update(state, {0x90, 60, 100});
+    Update(state, {0xC0, 5});
+    Update(state, {0xB0, 7, 90});
+    Update(state, {0xB0, 32, 2});
+    Update(state, {0xB0, 0, 1});
+    Update(state, {0xE0, 0x00, 0x50});
+    Update(state, {0x90, 62, 80});
+    Update(state, {0x80, 62, 0});
+
+    CHECK((CollectState(state, true) == Messages{{0xB0, 0, 1}, {0xB0, 32, 2}, {0xC0, 5}, {0xB0, 7, 90}, {0xE0, 0x00, 0x50}, {0x90, 60, 100}}));
+    CHECK(CollectState(state, false).size() == 5);
+
+    // all notes off ends the note, reset all controllers only what RP-015 resets: bank select and volume stay,
+    // modulation, expression, the pedals, the parameter selection and the bend go back to their defaults
+    Update(state, {0xB0, 1, 30});
+    Update(state, {0xB0, 64, 127});
+    Update(state, {0xB0, 101, 0});
+    Update(state, {0xB0, 100, 0});
+    Update(state, {0xB0, 123, 0});
+    Update(state, {0xB0, 121, 0});
+    CHECK((CollectState(state, true) == Messages{{0xB0, 0, 1},
+                                                 {0xB0, 32, 2},
+                                                 {0xC0, 5},
+                                                 {0xB0, 1, 0},
+                                                 {0xB0, 7, 90},
+                                                 {0xB0, 11, 127},
+                                                 {0xB0, 64, 0},
+                                                 {0xB0, 65, 0},
+                                                 {0xB0, 66, 0},
+                                                 {0xB0, 67, 0},
+                                                 {0xB0, 99, 127},
+                                                 {0xB0, 98, 127},
+                                                 {0xB0, 101, 127},
+                                                 {0xB0, 100, 127},
+                                                 {0xE0, 0x00, 0x40}}));
+
+    Update(state, {0xFF});
+    CHECK(CollectState(state, true).empty());
+}
+
+TEST_CASE(midi_state_selects_the_parameter_before_data_entry) {
+    MIDI_State_Snapshot state;
+
+    // pitch bend range through RPN 0, the selection comes before the data, increments are never replayed
+    Update(state, {0xB1, 6, 12});
+    Update(state, {0xB1, 101, 0});
+    Update(state, {0xB1, 100, 0});
+    Update(state, {0xB1, 6, 2});
+    Update(state, {0xB1, 38, 0});
+    Update(state, {0xB1, 96, 1});
+    Update(state, {0xB1, 97, 1});
+    Update(state, {0xB1, 99, 1});
+    Update(state, {0xB1, 98, 8});
+    Update(state, {0xB1, 101, 0});
+    Update(state, {0xB1, 100, 0});
+    Update(state, {0xB1, 10, 64});
+
+    CHECK((CollectState(state, false) ==
+           Messages{{0xB1, 10, 64}, {0xB1, 99, 1}, {0xB1, 98, 8}, {0xB1, 101, 0}, {0xB1, 100, 0}, {0xB1, 6, 2}, {0xB1, 38, 0}}));
+
+    // with the NRPN selected last, it is the one data entry goes to
+    Update(state, {0xB1, 99, 1});
+    Update(state, {0xB1, 98, 8});
+
+    CHECK((CollectState(state, false) ==
+           Messages{{0xB1, 10, 64}, {0xB1, 101, 0}, {0xB1, 100, 0}, {0xB1, 99, 1}, {0xB1, 98, 8}, {0xB1, 6, 2}, {0xB1, 38, 0}}));
+}
+
+TEST_CASE(sender_resyncs_before_the_first_message_after_a_connect) {
+    auto transport = std::make_shared<Recording_Transport>();
+    transport->SetConnections(0);
+
+    MIDI_Sender sender(transport->CreateSender("Stage"));
+
+    uint8_t note_on[3] = {0x90, 60, 100};
+    sender.SendMIDI(note_on, 1);
+    CHECK(transport->GetSent().empty());
+
+    // sent right after the connect, before the connection poll could have seen it
+    transport->SetConnections(1);
+    uint8_t note_off[3] = {0x80, 60, 0};
+    sender.SendMIDI(note_off, 2);
+
+    const auto messages = transport->GetSentMessages();
+    CHECK(messages.size() == 2);
+    if (messages.size() == 2) {
+        CHECK((messages[0].first == std::vector<uint8_t>{0x90, 60, 100}));
+        CHECK((messages[1].first == std::vector<uint8_t>{0x80, 60, 0}));
+        CHECK(messages[1].second == 2);
+    }
+
+    const auto stats = sender.GetStats();
+    CHECK(stats.connections == 1);
+    CHECK(stats.skipped == 1);
+    CHECK(stats.resyncs == 1);
+}
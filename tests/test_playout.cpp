@@ -0,0 +1,72 @@
+#include "playout.hpp"
+#include "test.hpp"
+
+static void AppendMessage(MIDI_Frame& frame, std::initializer_list<uint8_t> message) {
+    frame.bytes.insert(frame.bytes.end(), message);
+    frame.ends.push_back(static_cast<uint32_t>(frame.bytes.size()));
+}
+
+TEST_CASE(playout_overflow_drops_whole_frames_but_never_note_offs) {
+    std::mutex                        mutex;
+    std::vector<std::vector<uint8_t>> played;
+
+    MIDI_Playout_Scheduler playout(std::chrono::microseconds(100'000), [&](std::span<uint8_t> data) {
+        std::lock_guard lock(mutex);
+        played.emplace_back(data.begin(), data.end());
+    });
+
+    // nearly fills the buffer while the delay holds everything back
+    MIDI_Frame frame;
+    for (int i = 0; i < 4000; i++) {
+        AppendMessage(frame, {0xB0, 1, static_cast<uint8_t>(i & 0x7F)});
+    }
+    frame.timecode = CurrentTimecode();
+    playout.Schedule(frame);
+
+    // does not fit anymore, only what releases notes goes in
+    frame.Clear();
+    for (uint8_t note = 0; note < 100; note++) {
+        AppendMessage(frame, {0x90, note, 100});
+        AppendMessage(frame, {0x80, note, 0});
+    }
+    AppendMessage(frame, {0x90, 100, 0});
+    AppendMessage(frame, {0xB0, 64, 0});
+    AppendMessage(frame, {0xB0, 123, 0});
+    AppendMessage(frame, {0xB0, 7, 100});
+    frame.timecode = CurrentTimecode();
+    playout.Schedule(frame);
+
+    CHECK(WaitUntil([&] { return playout.GetStats().messages == 4000 + 103; }));
+
+    const auto stats = playout.GetStats();
+    CHECK(stats.dropped == 101);
+
+    std::lock_guard lock(mutex);
+
+    size_t note_ons  = 0;
+    size_t releasing = 0;
+    for (size_t i = 4000; i < played.size(); i++) {
+        if (played[i][0] == 0x90 && played[i][2] != 0) {
+            note_ons++;
+        } else {
+            releasing++;
+        }
+    }
+    CHECK(note_ons == 0);
+    CHECK(releasing == 103);
+}
+
+TEST_CASE(playout_keeps_frames_that_fit) {
+    std::atomic<int> played = 0;
+
+    MIDI_Playout_Scheduler playout(std::chrono::microseconds(1000), [&](std::span<uint8_t>) { played++; });
+
+    MIDI_Frame frame;
+    AppendMessage(frame, {0x90, 60, 100});
+    AppendMessage(frame, {0x80, 60, 0});
+    frame.timecode = CurrentTimecode();
+    playout.Schedule(frame);
+
+    CHECK(WaitUntil([&] { return played == 2; }));
+    CHECK(playout.GetStats().dropped == 0);
+}
@@ -0,0 +1,175 @@
+#include "routing.hpp"
+#include "test.hpp"
+
+[[nodiscard]]
+static std::optional<Routing_Config> ParseConfig(std::string_view text, std::string& error) {
+    std::istringstream input{std::string(text)};
+    return ParseRoutingConfig(input, error);
+}
+
+// the error for text, empty if it parsed
+[[nodiscard]]
+static std::string ParseError(std::string_view text) {
+    std::string error;
+    if (ParseConfig(text, error)) {
+        return {};
+    }
+    return error;
+}
+
+TEST_CASE(routing_config_parses_endpoints_and_routes) {
+    std::string error;
+    const auto  config = ParseConfig(R"(
+# inputs
+input  keys  = midi:USB Keyboard   # trailing comment
+input  desk  = ndi:DESK (Lighting)
+
+output stage = ndi:Stage
+output local = port:Local Out
+
+route keys -> stage channels=1-4,10 types=note,cc
+route desk -> local
+)",
+                                    error);
+
+    CHECK(config.has_value());
+    CHECK(error.empty());
+    if (!config) {
+        return;
+    }
+
+    CHECK(config->inputs.size() == 2);
+    CHECK(config->inputs[0].id == "keys");
+    CHECK(config->inputs[0].kind == Route_Endpoint_Kind::MIDIPort);
+    CHECK(config->inputs[0].name == "USB Keyboard");
+    CHECK(config->inputs[1].kind == Route_Endpoint_Kind::NDISource);
+    CHECK(config->inputs[1].name == "DESK (Lighting)");
+
+    CHECK(config->outputs.size() == 2);
+    CHECK(config->outputs[0].kind == Route_Endpoint_Kind::NDISender);
+    CHECK(config->outputs[1].kind == Route_Endpoint_Kind::VirtualPort);
+    CHECK(config->outputs[1].name == "Local Out");
+
+    CHECK(config->routes.size() == 2);
+    CHECK(config->routes[0].input == 0);
+    CHECK(config->routes[0].output == 0);
+    CHECK(config->routes[0].channels == 0b0000'0010'0000'1111);
+    CHECK(config->routes[0].types == (ROUTE_NOTE_OFF | ROUTE_NOTE_ON | ROUTE_CONTROL_CHANGE));
+    CHECK(config->routes[1].input == 1);
+    CHECK(config->routes[1].output == 1);
+    CHECK(config->routes[1].channels == 0xFFFF);
+    CHECK(config->routes[1].types == ROUTE_ALL_TYPES);
+}
+
+TEST_CASE(routing_config_reports_the_line_of_the_first_error) {
+    CHECK(ParseError("input a = midi:In\noutput o = ndi:Out\nroute a -> o\n").empty());
+
+    CHECK(ParseError("input a = midi:In\n\n# comment\nroute a -> o\n") == "4: unknown output o");
+    CHECK(ParseError("output o = ndi:Out\nroute b -> o\n") == "2: unknown input b");
+    CHECK(ParseError("input a = midi:In\noutput o = ndi:Out\nroute a => o\n") == "3: expected <input> -> <output>");
+    CHECK(ParseError("input a midi:In\n") == "1: expected <id> = <kind>:<name>");
+    CHECK(ParseError("input a = In\n") == "1: expected <kind>:<name>");
+    CHECK(ParseError("input a = port:In\n") == "1: inputs are midi:<port> or ndi:<source>");
+    CHECK(ParseError("output o = midi:Out\n") == "1: outputs are ndi:<name> or port:<name>");
+    CHECK(ParseError("\noutput o = ndi:   # no name\n") == "2: missing name");
+    CHECK(ParseError("input a = midi:In\ninput a = ndi:Source\n") == "2: a declared twice");
+    CHECK(ParseError("input a = midi:In\nbridge a\n") == "2: unknown keyword bridge");
+
+    const std::string_view ROUTE_PREFIX = "input a = midi:In\noutput o = ndi:Out\n";
+    const auto             route_error  = [&](std::string_view route) { return ParseError(std::string(ROUTE_PREFIX) + std::string(route)); };
+
+    CHECK(route_error("route a -> o channels=0\n") == "3: channels are 1 to 16, e.g. channels=1-4,10");
+    CHECK(route_error("route a -> o channels=17\n") == "3: channels are 1 to 16, e.g. channels=1-4,10");
+    CHECK(route_error("route a -> o channels=4-2\n") == "3: channels are 1 to 16, e.g. channels=1-4,10");
+    CHECK(route_error("route a -> o channels=1,x\n") == "3: channels are 1 to 16, e.g. channels=1-4,10");
+    CHECK(route_error("route a -> o types=note,aftertouch\n") == "3: unknown message type, e.g. types=note,cc,pitchbend");
+    CHECK(route_error("route a -> o velocity=1\n") == "3: unknown route option velocity=1");
+
+    // the output limit is checked once the whole file is read
+    std::string too_many = "input a = midi:In\n";
+    for (size_t output = 0; output <= MAX_ROUTE_OUTPUTS; output++) {
+        too_many += std::format("output o{} = ndi:Out {}\n", output, output);
+    }
+    CHECK(ParseError(too_many) == std::format("{}: at most {} outputs", MAX_ROUTE_OUTPUTS + 2, MAX_ROUTE_OUTPUTS));
+}
+
+TEST_CASE(routing_message_types_follow_the_status_byte) {
+    CHECK(MIDIMessageType(0x00) == 0);
+    CHECK(MIDIMessageType(0x7F) == 0);
+    CHECK(MIDIMessageType(0x80) == ROUTE_NOTE_OFF);
+    CHECK(MIDIMessageType(0x9F) == ROUTE_NOTE_ON);
+    CHECK(MIDIMessageType(0xA3) == ROUTE_POLY_AFTERTOUCH);
+    CHECK(MIDIMessageType(0xB0) == ROUTE_CONTROL_CHANGE);
+    CHECK(MIDIMessageType(0xC5) == ROUTE_PROGRAM_CHANGE);
+    CHECK(MIDIMessageType(0xD9) == ROUTE_CHANNEL_AFTERTOUCH);
+    CHECK(MIDIMessageType(0xEF) == ROUTE_PITCH_BEND);
+    CHECK(MIDIMessageType(0xF0) == ROUTE_SYSEX);
+    CHECK(MIDIMessageType(0xF1) == ROUTE_SYSTEM_COMMON);
+    CHECK(MIDIMessageType(0xF2) == ROUTE_SYSTEM_COMMON);
+    CHECK(MIDIMessageType(0xF7) == ROUTE_SYSTEM_COMMON);
+    CHECK(MIDIMessageType(0xF8) == ROUTE_REALTIME);
+    CHECK(MIDIMessageType(0xFF) == ROUTE_REALTIME);
+}
+
+TEST_CASE(routing_table_applies_channel_and_type_filters) {
+    std::string error;
+    const auto  config = ParseConfig(R"(
+input keys = midi:Keys
+input desk = midi:Desk
+
+output notes  = ndi:Notes
+output drums  = ndi:Drums
+output clock  = ndi:Clock
+output all    = port:All
+
+route keys -> notes channels=1-8 types=note
+route keys -> drums channels=10
+route keys -> clock types=realtime,sysex
+route desk -> all
+)",
+                                    error);
+
+    CHECK(config.has_value());
+    if (!config) {
+        return;
+    }
+
+    const MIDI_Route_Table table(*config);
+
+    constexpr size_t   KEYS  = 0;
+    constexpr size_t   DESK  = 1;
+    constexpr uint64_t NOTES = 1 << 0;
+    constexpr uint64_t DRUMS = 1 << 1;
+    constexpr uint64_t CLOCK = 1 << 2;
+    constexpr uint64_t ALL   = 1 << 3;
+
+    // channels 1 to 8 and only notes
+    CHECK(table.Outputs(KEYS, 0x90) == NOTES);
+    CHECK(table.Outputs(KEYS, 0x87) == NOTES);
+    CHECK(table.Outputs(KEYS, 0x98) == 0);
+    CHECK(table.Outputs(KEYS, 0xB0) == 0);
+    CHECK(table.Outputs(KEYS, 0xE3) == 0);
+
+    // channel 10 with every type
+    CHECK(table.Outputs(KEYS, 0x99) == DRUMS);
+    CHECK(table.Outputs(KEYS, 0xB9) == DRUMS);
+    CHECK(table.Outputs(KEYS, 0xC9) == DRUMS);
+    CHECK(table.Outputs(KEYS, 0xBA) == 0);
+
+    // system messages have no channel, the channel filter of the drums route passes all of them
+    CHECK(table.Outputs(KEYS, 0xF8) == (CLOCK | DRUMS));
+    CHECK(table.Outputs(KEYS, 0xFA) == (CLOCK | DRUMS));
+    CHECK(table.Outputs(KEYS, 0xF0) == (CLOCK | DRUMS));
+    CHECK(table.Outputs(KEYS, 0xF2) == DRUMS);
+
+    // data bytes are never routed
+    CHECK(table.Outputs(KEYS, 0x40) == 0);
+
+    // the other input has its own table
+    bool desk_routes_everything = true;
+    for (uint32_t status = 0x80; status <= 0xFF; status++) {
+        desk_routes_everything = desk_routes_everything && table.Outputs(DESK, static_cast<uint8_t>(status)) == ALL;
+    }
+    CHECK(desk_routes_everything);
+    CHECK(table.Outputs(DESK, 0x7F) == 0);
+}
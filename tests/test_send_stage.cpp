@@ -0,0 +1,129 @@
+#include "recording_transport.hpp"
+#include "send_stage.hpp"
+#include "test.hpp"
+
+using Timed_Message = std::pair<std::vector<uint8_t>, int64_t>;
+
+// whether sent is pushed with some messages left out, every sent one in the order it was pushed and with its
+// capture time; whatever is left out of pushed is added to skipped
+[[nodiscard]]
+static bool IsSubsequence(const std::vector<Timed_Message>& sent, const std::vector<Timed_Message>& pushed, std::vector<Timed_Message>& skipped) {
+    size_t next = 0;
+    for (const auto& message : sent) {
+        while (next < pushed.size() && pushed[next] != message) {
+            skipped.push_back(pushed[next++]);
+        }
+        if (next == pushed.size()) {
+            return false;
+        }
+        next++;
+    }
+    skipped.insert(skipped.end(), pushed.begin() + static_cast<ptrdiff_t>(next), pushed.end());
+    return true;
+}
+
+// pushes every message with a capture time of its own and keeps what it pushed
+class Timed_Pusher {
+public:
+    explicit Timed_Pusher(MIDI_Send_Stage& stage) : m_stage(stage) {}
+
+    void Push(std::initializer_list<uint8_t> bytes) {
+        std::vector<uint8_t> message(bytes);
+        m_pushed.emplace_back(message, ++m_timecode);
+        m_stage.Push(message, m_timecode);
+    }
+
+    [[nodiscard]]
+    const std::vector<Timed_Message>& GetPushed() const {
+        return m_pushed;
+    }
+
+private:
+    MIDI_Send_Stage&           m_stage;
+    std::vector<Timed_Message> m_pushed;
+    int64_t                    m_timecode = CurrentTimecode();
+};
+
+TEST_CASE(send_stage_coalesce_keeps_the_latest_value_in_order) {
+    auto transport = std::make_shared<Recording_Transport>();
+    // slow enough that the four cells of the queue stay full
+    transport->SetSendDelay(std::chrono::microseconds(300));
+
+    NDI_MIDI_Manager manager(transport, "Stage");
+
+    Send_Stats                 stats;
+    std::vector<Timed_Message> pushed;
+    {
+        MIDI_Send_Stage stage(manager, 4, Overflow_Policy::Coalesce);
+        Timed_Pusher    pusher(stage);
+
+        // fader sweeps on two controllers, a note and a controller of another channel in between
+        for (uint8_t controller : {7, 74}) {
+            for (uint8_t value = 0; value < 128; value++) {
+                pusher.Push({0xB0, controller, value});
+
+                if (value % 32 == 31) {
+                    pusher.Push({0x90, 60, 100});
+                    pusher.Push({0xB1, 10, value});
+                }
+            }
+        }
+
+        stats  = stage.GetStats();
+        pushed = pusher.GetPushed();
+    }
+
+    CHECK(stats.coalesced > 0);
+
+    // only values of a sweep are ever left out, never its last one
+    std::vector<Timed_Message> skipped;
+    CHECK(IsSubsequence(transport->GetSentMessages(), pushed, skipped));
+    CHECK(!skipped.empty());
+
+    bool only_sweep_values = true;
+    for (const auto& [message, timecode] : skipped) {
+        only_sweep_values = only_sweep_values && message[0] == 0xB0 && message[2] != 127;
+    }
+    CHECK(only_sweep_values);
+}
+
+TEST_CASE(send_stage_coalesce_never_lets_a_message_overtake_a_parked_controller) {
+    auto transport = std::make_shared<Recording_Transport>();
+    // every send takes long enough that the queue is still full when the next message comes
+    transport->SetSendDelay(std::chrono::milliseconds(20));
+
+    NDI_MIDI_Manager manager(transport, "Stage");
+
+    Send_Stats                 stats;
+    std::vector<Timed_Message> pushed;
+    {
+        MIDI_Send_Stage stage(manager, 2, Overflow_Policy::Coalesce);
+        Timed_Pusher    pusher(stage);
+
+        // fill the queue, the send thread holds one more
+        for (int note = 0; note < 3; note++) {
+            pusher.Push({0x90, static_cast<uint8_t>(60 + note), 100});
+        }
+
+        // bank select is parked and replaced, the program change has to wait for it
+        pusher.Push({0xB0, 0, 1});
+        pusher.Push({0xB0, 0, 2});
+        pusher.Push({0xC0, 5});
+
+        // fill it again: an RPN select parked, then its data entry, a controller of its own
+        pusher.Push({0x90, 64, 100});
+        pusher.Push({0x90, 65, 100});
+        pusher.Push({0xB0, 101, 0});
+        pusher.Push({0xB0, 6, 2});
+
+        stats  = stage.GetStats();
+        pushed = pusher.GetPushed();
+    }
+
+    CHECK(stats.coalesced == 1);
+    CHECK(stats.blocked >= 2);
+
+    std::vector<Timed_Message> skipped;
+    CHECK(IsSubsequence(transport->GetSentMessages(), pushed, skipped));
+    CHECK(skipped.size() == 1 && skipped[0].first == std::vector<uint8_t>({0xB0, 0, 1}));
+}
@@ -0,0 +1,42 @@
+#include "source_discovery.hpp"
+#include "test.hpp"
+
+TEST_CASE(source_discovery_reclaims_strings_of_sources_that_left) {
+    auto transport = CreateTransport("loopback");
+
+    MIDI_Source_Discovery discovery(transport);
+
+    const auto stage = transport->CreateSender("Stage");
+    CHECK(WaitUntil([&discovery] { return discovery.GetSnapshot()->Find("Stage") != nullptr; }));
+
+    // a sender that keeps restarting under a new name, every one of them was interned once
+    constexpr int RESTARTS = 100;
+
+    bool deltas_match = true;
+
+    for (int restart = 0; restart < RESTARTS; restart++) {
+        const std::string name   = std::format("Stage {}", restart);
+        auto              sender = transport->CreateSender(name);
+
+        std::shared_ptr<const Source_Snapshot> snapshot;
+        CHECK(WaitUntil([&] {
+            snapshot = discovery.GetSnapshot();
+            return snapshot->Find(name) != nullptr;
+        }));
+
+        // the source that stayed is never reported again, whichever set its strings moved to
+        for (const auto& source : snapshot->added) {
+            deltas_match = deltas_match && source.name != "Stage";
+        }
+        for (const auto& source : snapshot->removed) {
+            deltas_match = deltas_match && source.name != "Stage";
+        }
+    }
+
+    const auto snapshot = discovery.GetSnapshot();
+
+    CHECK(deltas_match);
+    CHECK(snapshot->Find("Stage") != nullptr);
+    CHECK(snapshot->sources.size() == 2);
+    CHECK(snapshot->strings->size() <= 4 * (snapshot->sources.size() + snapshot->removed.size()));
+}
@@ -0,0 +1,51 @@
+#include "spsc_ring.hpp"
+#include "test.hpp"
+
+TEST_CASE(spsc_ring_size_stays_in_range_while_both_sides_run) {
+    SPSC_Ring<uint32_t> ring(8);
+
+    std::atomic<bool> stop     = false;
+    bool              in_order = true;
+
+    std::jthread producer([&] {
+        for (uint32_t i = 0; !stop.load(std::memory_order_relaxed); i++) {
+            uint32_t* slot = nullptr;
+            while (!(slot = ring.BeginPush())) {
+                if (stop.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+            *slot = i;
+            ring.CommitPush();
+        }
+    });
+
+    std::jthread consumer([&] {
+        for (uint32_t expected = 0; !stop.load(std::memory_order_relaxed);) {
+            const uint32_t* element = ring.Front();
+            if (!element) {
+                std::this_thread::yield();
+                continue;
+            }
+            in_order = in_order && *element == expected++;
+            ring.Pop();
+        }
+    });
+
+    // what the stats of the receive pipeline do from a third thread; it spins without yielding, so on a shared
+    // core it is preempted between the two loads now and then while both sides move on
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+
+    size_t max_size = 0;
+    for (uint32_t reads = 1; reads % 4096 != 0 || std::chrono::steady_clock::now() < deadline; reads++) {
+        max_size = std::max(max_size, ring.Size());
+    }
+
+    stop.store(true);
+    producer.join();
+    consumer.join();
+
+    CHECK(in_order);
+    CHECK(max_size <= ring.Capacity());
+}
@@ -0,0 +1,185 @@
+#include "test.hpp"
+#include "transport.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#endif
+
+// takes the next metadata frame, skipping status changes
+[[nodiscard]]
+static std::optional<std::string> CaptureMetadata(Metadata_Receiver& receiver, int64_t* p_timecode = nullptr) {
+    for (int i = 0; i < 10; i++) {
+        Metadata_Frame frame;
+
+        switch (receiver.Capture(100, frame)) {
+        case Capture_Result::Metadata: {
+            std::string payload(frame.data);
+            if (p_timecode) {
+                *p_timecode = frame.timecode;
+            }
+            receiver.FreeFrame(frame);
+            return payload;
+        }
+        case Capture_Result::StatusChange:
+            continue;
+        case Capture_Result::None:
+            return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+TEST_CASE(loopback_moves_payloads_to_connected_receivers) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+    auto other    = transport.CreateReceiver("Other");
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+
+    sender->Send("<MIDI>903C64</MIDI>", 1234);
+
+    int64_t timecode = 0;
+    CHECK(CaptureMetadata(*receiver, &timecode) == "<MIDI>903C64</MIDI>");
+    CHECK(timecode == 1234);
+
+    // not connected, gets nothing
+    Metadata_Frame frame;
+    CHECK(other->Capture(0, frame) == Capture_Result::None);
+}
+
+TEST_CASE(loopback_synthesizes_timecodes) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+
+    const int64_t before = CurrentTimecode();
+    sender->Send("<MIDI>F8</MIDI>", TIMECODE_SYNTHESIZE);
+
+    int64_t timecode = 0;
+    CHECK(CaptureMetadata(*receiver, &timecode).has_value());
+    CHECK(timecode >= before && timecode <= CurrentTimecode());
+}
+
+TEST_CASE(loopback_counts_connections) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+
+    CHECK(sender->GetConnectionCount(0) == 0);
+    CHECK(receiver->GetConnectionCount() == 0);
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+
+    CHECK(sender->GetConnectionCount(0) == 1);
+    CHECK(receiver->GetConnectionCount() == 1);
+
+    receiver->Connect(nullptr);
+    CHECK(sender->GetConnectionCount(0) == 0);
+
+    // a receiver may connect before its sender exists
+    auto late_receiver = transport.CreateReceiver("Late");
+    const MIDI_Source late_source{"Late Stage", ""};
+    late_receiver->Connect(&late_source);
+    CHECK(late_receiver->GetConnectionCount() == 0);
+
+    auto late_sender = transport.CreateSender("Late Stage");
+    CHECK(late_receiver->GetConnectionCount() == 1);
+    CHECK(late_sender->GetConnectionCount(0) == 1);
+}
+
+TEST_CASE(loopback_finder_sees_senders_come_and_go) {
+    Loopback_Transport transport;
+
+    auto finder = transport.CreateFinder();
+    CHECK(finder->GetCurrentSources().empty());
+
+    auto sender = transport.CreateSender("Stage");
+    CHECK(finder->WaitForSources(100));
+
+    const auto sources = finder->GetCurrentSources();
+    CHECK(sources.size() == 1);
+    CHECK(!sources.empty() && sources.front().name == "Stage");
+
+    sender.reset();
+    CHECK(finder->WaitForSources(100));
+    CHECK(finder->GetCurrentSources().empty());
+}
+
+TEST_CASE(loopback_drops_the_oldest_frames_of_a_slow_receiver) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+
+    // drains the status change of the connect
+    Metadata_Frame frame;
+    CHECK(receiver->Capture(0, frame) == Capture_Result::StatusChange);
+
+    for (int i = 0; i < 1100; i++) {
+        sender->Send(std::format("<MIDI>{:06X}</MIDI>", i), TIMECODE_SYNTHESIZE);
+    }
+
+    CHECK(receiver->GetDroppedFrames() == 1100 - 1024);
+    CHECK(CaptureMetadata(*receiver) == std::format("<MIDI>{:06X}</MIDI>", 1100 - 1024));
+}
+
+TEST_CASE(loopback_status_change_when_the_sender_goes_away) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+
+    Metadata_Frame frame;
+    CHECK(receiver->Capture(0, frame) == Capture_Result::StatusChange);
+    CHECK(receiver->Capture(0, frame) == Capture_Result::None);
+
+    sender.reset();
+    CHECK(receiver->Capture(0, frame) == Capture_Result::StatusChange);
+    CHECK(receiver->GetConnectionCount() == 0);
+}
+
+#ifdef __linux__
+TEST_CASE(loopback_ready_fd_follows_the_queue) {
+    Loopback_Transport transport;
+
+    auto sender   = transport.CreateSender("Stage");
+    auto receiver = transport.CreateReceiver("Monitor");
+
+    const int fd = receiver->GetReadyFd();
+    CHECK(fd >= 0);
+
+    const auto readable = [fd] {
+        pollfd poll_fd{fd, POLLIN, 0};
+        return poll(&poll_fd, 1, 0) > 0;
+    };
+
+    const MIDI_Source source{"Stage", ""};
+    receiver->Connect(&source);
+    CHECK(readable());
+
+    Metadata_Frame frame;
+    CHECK(receiver->Capture(0, frame) == Capture_Result::StatusChange);
+    CHECK(!readable());
+
+    sender->Send("<MIDI>F8</MIDI>", TIMECODE_SYNTHESIZE);
+    CHECK(readable());
+
+    CHECK(CaptureMetadata(*receiver).has_value());
+    CHECK(!readable());
+}
+#endif